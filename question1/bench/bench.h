@@ -0,0 +1,99 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Timing harness for bench_suite. Every case runs a few untimed warmup
+// rounds, then is timed over several repetitions and reported as the
+// median and p99 time per operation. Results go to stdout as CSV, or as
+// one JSON object per line with --json, so runs can be diffed and tracked.
+
+#define BENCH_MAX_REPS 1000
+
+typedef struct {
+    int json;
+    int warmup;
+    int reps;
+    long max_blocks;  // largest chain the chain-length sweeps build
+} BenchConfig;
+
+typedef void (*bench_fn)(void* context);
+
+static double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int bench_compare(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static void bench_usage(const char* program) {
+    fprintf(stderr, "usage: %s [--json] [--reps N] [--warmup N] [--max-blocks N]\n", program);
+    exit(2);
+}
+
+static BenchConfig bench_parse_args(int argc, char** argv) {
+    BenchConfig config = { 0, 2, 11, 1000000 };
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            config.json = 1;
+        } else if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc) {
+            config.reps = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+            config.warmup = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--max-blocks") == 0 && i + 1 < argc) {
+            config.max_blocks = atol(argv[++i]);
+        } else {
+            bench_usage(argv[0]);
+        }
+    }
+    if (config.reps < 1 || config.reps > BENCH_MAX_REPS || config.warmup < 0) bench_usage(argv[0]);
+    return config;
+}
+
+static void bench_header(const BenchConfig* config) {
+    if (!config->json)
+        printf("benchmark,param,reps,median_ns_per_op,p99_ns_per_op,ops_per_s,mb_per_s\n");
+}
+
+// Times reps runs of fn after the warmup; each run performs ops operations
+// touching bytes bytes (0 when throughput in bytes means nothing). reps of
+// 0 uses the configured count; expensive cases pass fewer.
+static void bench_run(const BenchConfig* config, const char* name, long param, int reps,
+                      bench_fn fn, void* context, double ops, double bytes) {
+    double samples[BENCH_MAX_REPS];
+
+    if (reps <= 0 || reps > config->reps) reps = config->reps;
+    for (int i = 0; i < config->warmup; i++) fn(context);
+    for (int i = 0; i < reps; i++) {
+        double start = bench_now();
+        fn(context);
+        samples[i] = bench_now() - start;
+    }
+    qsort(samples, (size_t)reps, sizeof(double), bench_compare);
+
+    // Nearest-rank percentiles; with few repetitions p99 is the slowest run
+    double median = samples[(reps - 1) / 2];
+    int p99_rank = (99 * reps + 99) / 100;
+    double p99 = samples[p99_rank - 1];
+    double mb_per_s = bytes > 0 ? bytes / median / 1e6 : 0;
+
+    if (config->json) {
+        printf("{\"benchmark\":\"%s\",\"param\":%ld,\"reps\":%d,\"median_ns_per_op\":%.2f,"
+               "\"p99_ns_per_op\":%.2f,\"ops_per_s\":%.1f,\"mb_per_s\":%.2f}\n",
+               name, param, reps, median / ops * 1e9, p99 / ops * 1e9, ops / median, mb_per_s);
+    } else {
+        printf("%s,%ld,%d,%.2f,%.2f,%.1f,%.2f\n", name, param, reps, median / ops * 1e9,
+               p99 / ops * 1e9, ops / median, mb_per_s);
+    }
+    fflush(stdout);
+}
+
+#endif // BENCH_H
@@ -0,0 +1,53 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "blockchain.h"
+
+// Bytes per block with the payload sized to each block, against the
+// original layout that stored a MAX_DATA_SIZE (1024) byte buffer inline.
+
+typedef struct LegacyBlock {
+    uint32_t index;
+    time_t timestamp;
+    char data[1024];
+    uint8_t previous_hash[SHA256_DIGEST_SIZE];
+    uint8_t hash[SHA256_DIGEST_SIZE];
+    struct LegacyBlock* next;
+} LegacyBlock;
+
+int main(void) {
+    const size_t payload_sizes[] = { 0, 16, 100, 1000, 10000 };
+    const int blocks = 1000;
+
+    printf("Memory per block (%d blocks, heap bytes excluding allocator overhead)\n", blocks);
+    printf("%10s %14s %14s %10s\n", "payload", "before B/blk", "after B/blk", "ratio");
+
+    for (size_t p = 0; p < sizeof(payload_sizes) / sizeof(payload_sizes[0]); p++) {
+        char* payload = (char*)malloc(payload_sizes[p] + 1);
+        Blockchain* chain = create_blockchain();
+        if (!payload || !chain) return 1;
+
+        memset(payload, 'x', payload_sizes[p]);
+        payload[payload_sizes[p]] = '\0';
+        for (int b = 0; b < blocks; b++)
+            add_block(chain, payload);
+
+        size_t total = 0, count = 0;
+        for (Block* block = chain->genesis->next; block; block = block->next) {
+            total += block_memory_usage(block);
+            count++;
+        }
+
+        double after = (double)total / count;
+        if (payload_sizes[p] < 1024) {
+            double before = (double)sizeof(LegacyBlock);
+            printf("%10zu %14.0f %14.0f %9.2fx\n", payload_sizes[p], before, after, before / after);
+        } else {
+            printf("%10zu %14s %14.0f %10s\n", payload_sizes[p], "truncated", after, "-");
+        }
+
+        free_blockchain(chain);
+        free(payload);
+    }
+    return 0;
+}
@@ -0,0 +1,70 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sha256.h"
+
+// Compares sha256_update against the original byte-at-a-time buffering
+// loop, which is reproduced here on top of sha256_transform.
+
+static void update_bytewise(SHA256_CTX *ctx, const uint8_t data[], size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+        ctx->data[ctx->datalen] = data[i];
+        ctx->datalen++;
+        if (ctx->datalen == 64) {
+            sha256_transform(ctx, ctx->data);
+            ctx->bitlen += 512;
+            ctx->datalen = 0;
+        }
+    }
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Hashes len bytes repeatedly for roughly 0.3 s and returns MB/s
+static double measure(const uint8_t *buf, size_t len, int bytewise) {
+    uint8_t hash[SHA256_DIGEST_SIZE];
+    size_t iterations = 0;
+    double start = now_seconds(), elapsed;
+
+    do {
+        for (int r = 0; r < 16; r++) {
+            SHA256_CTX ctx;
+            sha256_init(&ctx);
+            if (bytewise)
+                update_bytewise(&ctx, buf, len);
+            else
+                sha256_update(&ctx, buf, len);
+            sha256_final(&ctx, hash);
+        }
+        iterations += 16;
+        elapsed = now_seconds() - start;
+    } while (elapsed < 0.3);
+
+    return (double)len * iterations / elapsed / 1e6;
+}
+
+int main(void) {
+    const size_t sizes[] = { 32, 1024, 1024 * 1024 };
+    size_t max_len = sizes[sizeof(sizes) / sizeof(sizes[0]) - 1];
+    uint8_t *buf = malloc(max_len);
+    if (!buf) return 1;
+
+    for (size_t i = 0; i < max_len; i++) buf[i] = (uint8_t)(i * 131 + 7);
+
+    printf("sha256_update throughput (backend: %s)\n",
+           sha256_backend_name(sha256_get_backend()));
+    printf("%10s %14s %14s %8s\n", "size", "bytewise MB/s", "bulk MB/s", "speedup");
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        double before = measure(buf, sizes[i], 1);
+        double after = measure(buf, sizes[i], 0);
+        printf("%10zu %14.1f %14.1f %7.2fx\n", sizes[i], before, after, after / before);
+    }
+
+    free(buf);
+    return 0;
+}
@@ -0,0 +1,131 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "bench.h"
+#include "blockchain.h"
+
+// Regression suite: raw SHA-256 throughput, block hashing by payload size,
+// add_block and validation at 10^3 to 10^6 blocks. Pass --json for JSON
+// lines instead of CSV. This chain has no persistence to measure.
+
+typedef struct {
+    const uint8_t* data;
+    size_t size;
+    size_t iterations;
+} HashCase;
+
+static void run_sha256(void* context) {
+    HashCase* c = (HashCase*)context;
+    uint8_t hash[SHA256_DIGEST_SIZE];
+
+    for (size_t i = 0; i < c->iterations; i++)
+        sha256(c->data, c->size, hash);
+}
+
+typedef struct {
+    Block* block;
+    size_t iterations;
+} BlockCase;
+
+static void run_calculate_block_hash(void* context) {
+    BlockCase* c = (BlockCase*)context;
+
+    for (size_t i = 0; i < c->iterations; i++) {
+        c->block->index = (uint32_t)i;
+        calculate_block_hash(c->block);
+    }
+}
+
+typedef struct {
+    Blockchain* chain;
+    size_t blocks;
+} ChainCase;
+
+static void run_add_block(void* context) {
+    ChainCase* c = (ChainCase*)context;
+
+    for (size_t i = 0; i < c->blocks; i++)
+        add_block(c->chain, "Alice pays Bob 10");
+}
+
+static void run_validate_chain(void* context) {
+    ChainCase* c = (ChainCase*)context;
+
+    if (!validate_chain(c->chain)) fprintf(stderr, "validate_chain failed\n");
+}
+
+static void run_validate_chain_parallel(void* context) {
+    ChainCase* c = (ChainCase*)context;
+    ValidationOptions options = { (int)sysconf(_SC_NPROCESSORS_ONLN), 0 };
+
+    if (!validate_chain_parallel(c->chain, &options, NULL)) fprintf(stderr, "validate_chain_parallel failed\n");
+}
+
+static void bench_hashing(const BenchConfig* config) {
+    const size_t sizes[] = { 64, 1024, 65536, 1 << 20 };
+    const size_t total = 16 << 20;
+    uint8_t* data = (uint8_t*)malloc(sizes[3]);
+    if (!data) return;
+    for (size_t i = 0; i < sizes[3]; i++) data[i] = (uint8_t)(i * 31);
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        HashCase c = { data, sizes[s], total / sizes[s] };
+        bench_run(config, "sha256", (long)sizes[s], 0, run_sha256, &c, (double)c.iterations,
+                  (double)(c.iterations * c.size));
+    }
+    free(data);
+}
+
+static void bench_blocks(const BenchConfig* config) {
+    const size_t sizes[] = { 16, 256, 4096 };
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        char* data = (char*)malloc(sizes[i] + 1);
+        if (!data) return;
+        memset(data, 'x', sizes[i]);
+        data[sizes[i]] = '\0';
+
+        BlockCase c = { create_block(data), 100000 };
+        free(data);
+        if (!c.block) return;
+
+        bench_run(config, "calculate_block_hash", (long)sizes[i], 0, run_calculate_block_hash, &c,
+                  (double)c.iterations, (double)(c.iterations * sizes[i]));
+        free(c.block->data);
+        free(c.block);
+    }
+}
+
+static void bench_add_block(const BenchConfig* config) {
+    ChainCase c = { create_blockchain(), 10000 };
+    if (!c.chain) return;
+
+    bench_run(config, "add_block", 0, 0, run_add_block, &c, (double)c.blocks, 0);
+    free_blockchain(c.chain);
+}
+
+static void bench_validation(const BenchConfig* config) {
+    for (long n = 1000; n <= config->max_blocks; n *= 10) {
+        ChainCase c = { create_blockchain(), (size_t)n };
+        if (!c.chain) return;
+        for (long b = 1; b < n; b++) add_block(c.chain, "Alice pays Bob 10");
+
+        // Large chains take seconds per run, so they get fewer repetitions
+        int reps = n >= 1000000 ? 3 : 0;
+        bench_run(config, "validate_chain", n, reps, run_validate_chain, &c, (double)n, 0);
+        bench_run(config, "validate_chain_parallel", n, reps, run_validate_chain_parallel, &c, (double)n, 0);
+        free_blockchain(c.chain);
+    }
+}
+
+int main(int argc, char** argv) {
+    BenchConfig config = bench_parse_args(argc, argv);
+
+    bench_header(&config);
+    bench_hashing(&config);
+    bench_blocks(&config);
+    bench_add_block(&config);
+    bench_validation(&config);
+    return 0;
+}
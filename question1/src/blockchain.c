@@ -1,7 +1,10 @@
 #include "blockchain.h"
+#include "metrics.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
 
 Blockchain* create_blockchain() {
     Blockchain* chain = (Blockchain*)malloc(sizeof(Blockchain));
@@ -22,10 +25,16 @@ Block* create_block(const char* data) {
     Block* block = (Block*)malloc(sizeof(Block));
     if (!block) return NULL;
 
+    size_t data_size = strlen(data) + 1;
+    block->data = (char*)malloc(data_size);
+    if (!block->data) {
+        free(block);
+        return NULL;
+    }
+
     block->index = 0;
     block->timestamp = time(NULL);
-    strncpy(block->data, data, MAX_DATA_SIZE - 1);
-    block->data[MAX_DATA_SIZE - 1] = '\0';
+    memcpy(block->data, data, data_size);
     memset(block->previous_hash, 0, SHA256_DIGEST_SIZE);
     block->next = NULL;
 
@@ -33,23 +42,28 @@ Block* create_block(const char* data) {
     return block;
 }
 
-void calculate_block_hash(Block* block) {
+static void compute_block_hash(const Block* block, uint8_t hash[]) {
     SHA256_CTX ctx;
     sha256_init(&ctx);
     
     // Hash the block's data
-    sha256_update(&ctx, (uint8_t*)block->data, strlen(block->data));
+    sha256_update(&ctx, (const uint8_t*)block->data, strlen(block->data));
     
     // Hash the previous block's hash
     sha256_update(&ctx, block->previous_hash, SHA256_DIGEST_SIZE);
     
     // Hash the timestamp
-    sha256_update(&ctx, (uint8_t*)&block->timestamp, sizeof(block->timestamp));
+    sha256_update(&ctx, (const uint8_t*)&block->timestamp, sizeof(block->timestamp));
     
     // Hash the index
-    sha256_update(&ctx, (uint8_t*)&block->index, sizeof(block->index));
+    sha256_update(&ctx, (const uint8_t*)&block->index, sizeof(block->index));
     
-    sha256_final(&ctx, block->hash);
+    sha256_final(&ctx, hash);
+    METRIC_ADD(METRIC_BLOCK_HASHES, 1);
+}
+
+void calculate_block_hash(Block* block) {
+    compute_block_hash(block, block->hash);
 }
 
 void add_block(Blockchain* chain, const char* data) {
@@ -70,10 +84,14 @@ void add_block(Blockchain* chain, const char* data) {
 int validate_chain(Blockchain* chain) {
     if (!chain || !chain->genesis) return 0;
 
+    METRIC_TIMER_START(timer);
     Block* current = chain->genesis;
     uint8_t calculated_hash[SHA256_DIGEST_SIZE];
+    int valid = 1;
+
+    while (current && valid) {
+        METRIC_ADD(METRIC_BLOCKS_VALIDATED, 1);
 
-    while (current) {
         // Calculate hash of current block
         SHA256_CTX ctx;
         sha256_init(&ctx);
@@ -85,20 +103,157 @@ int validate_chain(Blockchain* chain) {
 
         // Compare calculated hash with stored hash
         if (memcmp(calculated_hash, current->hash, SHA256_DIGEST_SIZE) != 0) {
-            return 0;
+            valid = 0;
         }
 
         // If there's a next block, verify its previous hash matches current block's hash
         if (current->next && memcmp(current->hash, current->next->previous_hash, SHA256_DIGEST_SIZE) != 0) {
-            return 0;
+            valid = 0;
         }
 
         current = current->next;
     }
 
+    METRIC_TIMER_STOP(METRIC_VALIDATE_LATENCY, timer);
+    return valid;
+}
+
+// Shared state for the validation workers
+typedef struct {
+    Block** blocks;
+    size_t count;
+    size_t chunk_size;
+    atomic_size_t next_chunk;
+    atomic_size_t first_invalid;  // count while no bad block has been found
+} ValidationJob;
+
+// A block is bad if its stored hash does not match its contents or its
+// previous_hash does not match the block before it (NULL for the genesis)
+static int verify_linked_block(const Block* block, const Block* previous) {
+    uint8_t calculated_hash[SHA256_DIGEST_SIZE];
+
+    METRIC_ADD(METRIC_BLOCKS_VALIDATED, 1);
+    compute_block_hash(block, calculated_hash);
+    if (memcmp(calculated_hash, block->hash, SHA256_DIGEST_SIZE) != 0) return 0;
+    if (previous && memcmp(previous->hash, block->previous_hash, SHA256_DIGEST_SIZE) != 0) return 0;
     return 1;
 }
 
+// The first block of a chunk checks the link back into the previous chunk
+static int block_is_valid(ValidationJob* job, size_t i) {
+    return verify_linked_block(job->blocks[i], i > 0 ? job->blocks[i - 1] : NULL);
+}
+
+// Walks the list on the calling thread, for when the block array the
+// workers share cannot be allocated
+static int validate_serially(Blockchain* chain, long* first_invalid) {
+    const Block* previous = NULL;
+    long height = 0;
+
+    for (const Block* current = chain->genesis; current; current = current->next, height++) {
+        if (!verify_linked_block(current, previous)) {
+            if (first_invalid) *first_invalid = height;
+            return 0;
+        }
+        previous = current;
+    }
+    return 1;
+}
+
+static void* validation_worker(void* arg) {
+    ValidationJob* job = (ValidationJob*)arg;
+
+    for (;;) {
+        size_t start = atomic_fetch_add(&job->next_chunk, 1) * job->chunk_size;
+        // Chunks are claimed in order, so nothing later can beat a known failure
+        if (start >= job->count || start >= atomic_load(&job->first_invalid)) break;
+
+        size_t end = start + job->chunk_size;
+        if (end > job->count) end = job->count;
+
+        for (size_t i = start; i < end; i++) {
+            size_t known = atomic_load(&job->first_invalid);
+            if (i >= known) break;
+            if (!block_is_valid(job, i)) {
+                while (i < known && !atomic_compare_exchange_weak(&job->first_invalid, &known, i))
+                    ;
+                break;
+            }
+        }
+    }
+    return NULL;
+}
+
+int validate_chain_parallel(Blockchain* chain, const ValidationOptions* options, long* first_invalid) {
+    if (first_invalid) *first_invalid = -1;
+    if (!chain || !chain->genesis) {
+        if (first_invalid) *first_invalid = 0;
+        return 0;
+    }
+
+    METRIC_TIMER_START(timer);
+    int num_threads = options ? options->num_threads : 1;
+    size_t chunk_size = options ? options->chunk_size : 0;
+
+    ValidationJob job;
+    job.count = 0;
+    for (Block* current = chain->genesis; current; current = current->next)
+        job.count++;
+
+    // Out of memory says nothing about the chain, so check it here instead
+    job.blocks = (Block**)malloc(job.count * sizeof(Block*));
+    if (!job.blocks) {
+        int valid = validate_serially(chain, first_invalid);
+        METRIC_TIMER_STOP(METRIC_VALIDATE_LATENCY, timer);
+        return valid;
+    }
+
+    size_t n = 0;
+    for (Block* current = chain->genesis; current; current = current->next)
+        job.blocks[n++] = current;
+
+    if (num_threads < 1) num_threads = 1;
+    if (chunk_size == 0) {
+        // Several chunks per thread so a slow segment does not stall the rest
+        chunk_size = job.count / ((size_t)num_threads * 8);
+        if (chunk_size == 0) chunk_size = 1;
+    }
+    job.chunk_size = chunk_size;
+    atomic_init(&job.next_chunk, 0);
+    atomic_init(&job.first_invalid, job.count);
+
+    pthread_t* threads = NULL;
+    int started = 0;
+    if (num_threads > 1) {
+        threads = (pthread_t*)malloc((size_t)(num_threads - 1) * sizeof(pthread_t));
+        for (; threads && started < num_threads - 1; started++) {
+            if (pthread_create(&threads[started], NULL, validation_worker, &job) != 0) break;
+        }
+    }
+
+    // The calling thread works too
+    validation_worker(&job);
+
+    for (int i = 0; i < started; i++)
+        pthread_join(threads[i], NULL);
+    free(threads);
+    free(job.blocks);
+    METRIC_TIMER_STOP(METRIC_VALIDATE_LATENCY, timer);
+
+    size_t bad = atomic_load(&job.first_invalid);
+    if (bad < job.count) {
+        if (first_invalid) *first_invalid = (long)bad;
+        return 0;
+    }
+    return 1;
+}
+
+size_t block_memory_usage(const Block* block) {
+    if (!block) return 0;
+
+    return sizeof(Block) + strlen(block->data) + 1;
+}
+
 void print_block(Block* block) {
     if (!block) return;
 
@@ -132,6 +287,7 @@ void free_blockchain(Blockchain* chain) {
     Block* current = chain->genesis;
     while (current) {
         Block* next = current->next;
+        free(current->data);
         free(current);
         current = next;
     }
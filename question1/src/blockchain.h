@@ -5,12 +5,10 @@
 #include <stdint.h>
 #include "sha256.h"
 
-#define MAX_DATA_SIZE 1024
-
 typedef struct Block {
     uint32_t index;
     time_t timestamp;
-    char data[MAX_DATA_SIZE];
+    char* data;  // heap copy sized to the payload
     uint8_t previous_hash[SHA256_DIGEST_SIZE];
     uint8_t hash[SHA256_DIGEST_SIZE];
     struct Block* next;
@@ -21,12 +19,20 @@ typedef struct {
     Block* latest;
 } Blockchain;
 
+// Parallel validation settings
+typedef struct {
+    int num_threads;    // worker threads; 1 or less validates on the caller's thread
+    size_t chunk_size;  // blocks per work item; 0 picks one from the chain length
+} ValidationOptions;
+
 // Function declarations
 Blockchain* create_blockchain();
 Block* create_block(const char* data);
 void add_block(Blockchain* chain, const char* data);
 void calculate_block_hash(Block* block);
 int validate_chain(Blockchain* chain);
+int validate_chain_parallel(Blockchain* chain, const ValidationOptions* options, long* first_invalid);
+size_t block_memory_usage(const Block* block);
 void print_block(Block* block);
 void print_blockchain(Blockchain* chain);
 void free_blockchain(Blockchain* chain);
@@ -2,6 +2,7 @@
 #include <string.h>
 #include "sha256.h"
 #include "blockchain.h"
+#include "metrics.h"
 
 void print_hash(const uint8_t* hash) {
     for (int i = 0; i < SHA256_DIGEST_SIZE; i++) {
@@ -22,6 +23,8 @@ int main() {
     sha256((uint8_t*)input, strlen(input), hash);
     printf("SHA-256 Hash: ");
     print_hash(hash);
+    printf("Backend: %s\n", sha256_backend_name(sha256_get_backend()));
+    printf("Self-test: %s\n", sha256_self_test() ? "passed" : "FAILED");
     printf("\n");
 
     // Task 2: Simple Blockchain Simulation
@@ -52,7 +55,22 @@ int main() {
         printf("Blockchain is invalid!\n");
     }
 
+    // Validate again on worker threads
+    ValidationOptions options = { 4, 0 };
+    long first_invalid;
+    printf("Validating blockchain on %d threads...\n", options.num_threads);
+    if (validate_chain_parallel(chain, &options, &first_invalid)) {
+        printf("Blockchain is valid!\n");
+    } else {
+        printf("Blockchain is invalid at block %ld!\n", first_invalid);
+    }
+
     // Clean up
     free_blockchain(chain);
+
+    if (metrics_enabled()) {
+        printf("\nMetrics: ");
+        metrics_write_json(stdout);
+    }
     return 0;
 } 
\ No newline at end of file
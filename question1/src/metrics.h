@@ -0,0 +1,93 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdatomic.h>
+
+// Runtime counters and latency histograms. Build with -DBLOCKCHAIN_METRICS
+// (make METRICS=1) to enable them; otherwise every hook below expands to
+// nothing and only the dump functions remain, reporting zeros.
+//
+// Each thread updates its own shard with plain loads and stores, so a hook
+// costs a few instructions and no locked operations; a snapshot sums the
+// shards. A thread's counts are folded into a retired total when it exits,
+// and its shard is reused by the next thread to record anything. Hot
+// paths only count: timing is kept to coarse operations (validation, save,
+// load) where a clock read is noise.
+
+typedef enum {
+    METRIC_SHA256_HASHES,        // messages finished by sha256_final or sha256_batch
+    METRIC_SHA256_BYTES,         // message bytes those hashes covered
+    METRIC_SHA256_COMPRESSIONS,  // 64-byte blocks through the compression function
+    METRIC_BLOCK_HASHES,         // block header hashes computed
+    METRIC_NONCES_TRIED,         // mining attempts
+    METRIC_BLOCKS_VALIDATED,     // blocks checked against their contents
+    METRIC_SAVE_BYTES,
+    METRIC_LOAD_BYTES,
+    METRIC_COUNTER_COUNT
+} MetricCounter;
+
+typedef enum {
+    METRIC_VALIDATE_LATENCY,
+    METRIC_SAVE_LATENCY,
+    METRIC_LOAD_LATENCY,
+    METRIC_HISTOGRAM_COUNT
+} MetricHistogram;
+
+// Bucket b counts latencies below 2^(b+1) ns that did not fit bucket b-1;
+// the last one also takes everything longer (about 18 minutes and up)
+#define METRICS_BUCKETS 40
+
+typedef struct {
+    uint64_t counters[METRIC_COUNTER_COUNT];
+    uint64_t buckets[METRIC_HISTOGRAM_COUNT][METRICS_BUCKETS];
+    uint64_t count[METRIC_HISTOGRAM_COUNT];
+    uint64_t sum_ns[METRIC_HISTOGRAM_COUNT];
+} MetricsSnapshot;
+
+// Function declarations
+int metrics_enabled(void);
+void metrics_snapshot(MetricsSnapshot* snapshot);
+void metrics_reset(void);
+int metrics_write_json(FILE* out);
+int metrics_write_prometheus(FILE* out);
+
+#ifdef BLOCKCHAIN_METRICS
+
+typedef struct MetricsShard {
+    atomic_uint_least64_t counters[METRIC_COUNTER_COUNT];
+    atomic_uint_least64_t buckets[METRIC_HISTOGRAM_COUNT][METRICS_BUCKETS];
+    atomic_uint_least64_t count[METRIC_HISTOGRAM_COUNT];
+    atomic_uint_least64_t sum_ns[METRIC_HISTOGRAM_COUNT];
+    struct MetricsShard* next;
+} MetricsShard;
+
+extern _Thread_local MetricsShard* metrics_thread_shard;
+MetricsShard* metrics_register_thread(void);
+uint64_t metrics_now_ns(void);
+void metrics_observe(MetricHistogram histogram, uint64_t ns);
+
+// Only the owning thread writes a shard, so a relaxed load and store is
+// enough; readers may see a slightly stale value but never a torn one
+static inline void metrics_add(MetricCounter counter, uint64_t n) {
+    MetricsShard* shard = metrics_thread_shard;
+    if (!shard && !(shard = metrics_register_thread())) return;
+
+    atomic_uint_least64_t* slot = &shard->counters[counter];
+    atomic_store_explicit(slot, atomic_load_explicit(slot, memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+#define METRIC_ADD(counter, n) metrics_add((counter), (uint64_t)(n))
+#define METRIC_TIMER_START(name) uint64_t name = metrics_now_ns()
+#define METRIC_TIMER_STOP(histogram, name) metrics_observe((histogram), metrics_now_ns() - (name))
+
+#else
+
+#define METRIC_ADD(counter, n) ((void)0)
+#define METRIC_TIMER_START(name) ((void)0)
+#define METRIC_TIMER_STOP(histogram, name) ((void)0)
+
+#endif // BLOCKCHAIN_METRICS
+
+#endif // METRICS_H
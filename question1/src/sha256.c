@@ -1,4 +1,5 @@
 #include "sha256.h"
+#include "metrics.h"
 #include <stdio.h>
 
 // SHA-256 Constants
@@ -13,6 +14,18 @@ static const uint32_t k[64] = {
     0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
 };
 
+// Initial hash values
+static const uint32_t sha256_iv[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+// Big-endian 32-bit load; compiles to a single load plus bswap
+static inline uint32_t load_be32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+           ((uint32_t)p[2] << 8) | ((uint32_t)p[3]);
+}
+
 // Right rotation function
 #define ROTRIGHT(word, bits) (((word) >> (bits)) | ((word) << (32-(bits))))
 
@@ -37,58 +50,239 @@ void sha256_init(SHA256_CTX *ctx) {
     ctx->state[7] = 0x5be0cd19;
 }
 
+// Portable compression function; processes nblocks consecutive 64-byte blocks
+static void sha256_blocks_scalar(uint32_t state[8], const uint8_t *data, size_t nblocks) {
+    uint32_t a, b, c, d, e, f, g, h, i, t1, t2, m[64];
+
+    for (; nblocks > 0; --nblocks, data += 64) {
+        for (i = 0; i < 16; ++i)
+            m[i] = load_be32(data + i * 4);
+
+        for (; i < 64; ++i)
+            m[i] = SIG1(m[i - 2]) + m[i - 7] + SIG0(m[i - 15]) + m[i - 16];
+
+        a = state[0];
+        b = state[1];
+        c = state[2];
+        d = state[3];
+        e = state[4];
+        f = state[5];
+        g = state[6];
+        h = state[7];
+
+        for (i = 0; i < 64; ++i) {
+            t1 = h + EP1(e) + CH(e,f,g) + k[i] + m[i];
+            t2 = EP0(a) + MAJ(a,b,c);
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+
+#define SHA256_HAVE_SHANI 1
+
+// Four rounds using the SHA extensions; the message words are in msg
+#define SHANI_ROUNDS(msg, i) \
+    tmp = _mm_add_epi32(msg, _mm_loadu_si128((const __m128i*)&k[i])); \
+    state1 = _mm_sha256rnds2_epu32(state1, state0, tmp); \
+    tmp = _mm_shuffle_epi32(tmp, 0x0E); \
+    state0 = _mm_sha256rnds2_epu32(state0, state1, tmp)
+
+// Message schedule: next gets W[i+4..i+7] once prev has been through msg1
+#define SHANI_SCHEDULE(next, cur, prev) \
+    next = _mm_add_epi32(next, _mm_alignr_epi8(cur, prev, 4)); \
+    next = _mm_sha256msg2_epu32(next, cur)
+
+__attribute__((target("sha,sse4.1")))
+static void sha256_blocks_shani(uint32_t state[8], const uint8_t *data, size_t nblocks) {
+    const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    __m128i state0, state1, tmp, abef, cdgh;
+    __m128i m0, m1, m2, m3;
+
+    // Rearrange the state into the ABEF/CDGH layout the instructions expect
+    tmp = _mm_loadu_si128((const __m128i*)&state[0]);
+    state1 = _mm_loadu_si128((const __m128i*)&state[4]);
+    tmp = _mm_shuffle_epi32(tmp, 0xB1);
+    state1 = _mm_shuffle_epi32(state1, 0x1B);
+    state0 = _mm_alignr_epi8(tmp, state1, 8);
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+    for (; nblocks > 0; --nblocks, data += 64) {
+        abef = state0;
+        cdgh = state1;
+
+        m0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 0)), mask);
+        m1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 16)), mask);
+        m2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 32)), mask);
+        m3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 48)), mask);
+
+        SHANI_ROUNDS(m0, 0);
+        SHANI_ROUNDS(m1, 4);
+        m0 = _mm_sha256msg1_epu32(m0, m1);
+        SHANI_ROUNDS(m2, 8);
+        m1 = _mm_sha256msg1_epu32(m1, m2);
+
+        SHANI_ROUNDS(m3, 12); SHANI_SCHEDULE(m0, m3, m2); m2 = _mm_sha256msg1_epu32(m2, m3);
+        SHANI_ROUNDS(m0, 16); SHANI_SCHEDULE(m1, m0, m3); m3 = _mm_sha256msg1_epu32(m3, m0);
+        SHANI_ROUNDS(m1, 20); SHANI_SCHEDULE(m2, m1, m0); m0 = _mm_sha256msg1_epu32(m0, m1);
+        SHANI_ROUNDS(m2, 24); SHANI_SCHEDULE(m3, m2, m1); m1 = _mm_sha256msg1_epu32(m1, m2);
+        SHANI_ROUNDS(m3, 28); SHANI_SCHEDULE(m0, m3, m2); m2 = _mm_sha256msg1_epu32(m2, m3);
+        SHANI_ROUNDS(m0, 32); SHANI_SCHEDULE(m1, m0, m3); m3 = _mm_sha256msg1_epu32(m3, m0);
+        SHANI_ROUNDS(m1, 36); SHANI_SCHEDULE(m2, m1, m0); m0 = _mm_sha256msg1_epu32(m0, m1);
+        SHANI_ROUNDS(m2, 40); SHANI_SCHEDULE(m3, m2, m1); m1 = _mm_sha256msg1_epu32(m1, m2);
+        SHANI_ROUNDS(m3, 44); SHANI_SCHEDULE(m0, m3, m2); m2 = _mm_sha256msg1_epu32(m2, m3);
+        SHANI_ROUNDS(m0, 48); SHANI_SCHEDULE(m1, m0, m3); m3 = _mm_sha256msg1_epu32(m3, m0);
+        SHANI_ROUNDS(m1, 52); SHANI_SCHEDULE(m2, m1, m0);
+        SHANI_ROUNDS(m2, 56); SHANI_SCHEDULE(m3, m2, m1);
+        SHANI_ROUNDS(m3, 60);
+
+        state0 = _mm_add_epi32(state0, abef);
+        state1 = _mm_add_epi32(state1, cdgh);
+    }
+
+    // Back to the A..H word order
+    tmp = _mm_shuffle_epi32(state0, 0x1B);
+    state1 = _mm_shuffle_epi32(state1, 0xB1);
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);
+    state1 = _mm_alignr_epi8(state1, tmp, 8);
+    _mm_storeu_si128((__m128i*)&state[0], state0);
+    _mm_storeu_si128((__m128i*)&state[4], state1);
+}
+
+static int cpu_has_shani(void) {
+    unsigned int eax, ebx, ecx, edx;
+
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return 0;
+    // SSSE3 and SSE4.1 are used alongside the SHA instructions
+    if (!(ecx & bit_SSSE3) || !(ecx & bit_SSE4_1)) return 0;
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) return 0;
+    return (ebx & (1u << 29)) != 0;
+}
+#endif
+
+typedef void (*sha256_blocks_fn)(uint32_t state[8], const uint8_t *data, size_t nblocks);
+
+static sha256_blocks_fn sha256_blocks = sha256_blocks_scalar;
+static SHA256_BACKEND sha256_backend = SHA256_BACKEND_SCALAR;
+static int sha256_lanes = 4;
+static int sha256_have_avx2 = 0;
+
+int sha256_backend_supported(SHA256_BACKEND backend) {
+    switch (backend) {
+    case SHA256_BACKEND_SCALAR:
+        return 1;
+    case SHA256_BACKEND_SHANI:
+#ifdef SHA256_HAVE_SHANI
+        return cpu_has_shani();
+#else
+        return 0;
+#endif
+    }
+    return 0;
+}
+
+int sha256_set_backend(SHA256_BACKEND backend) {
+    if (!sha256_backend_supported(backend)) return 0;
+
+    switch (backend) {
+    case SHA256_BACKEND_SCALAR:
+        sha256_blocks = sha256_blocks_scalar;
+        break;
+    case SHA256_BACKEND_SHANI:
+#ifdef SHA256_HAVE_SHANI
+        sha256_blocks = sha256_blocks_shani;
+#endif
+        break;
+    }
+    sha256_backend = backend;
+    return 1;
+}
+
+SHA256_BACKEND sha256_get_backend(void) {
+    return sha256_backend;
+}
+
+const char* sha256_backend_name(SHA256_BACKEND backend) {
+    switch (backend) {
+    case SHA256_BACKEND_SCALAR:
+        return "scalar";
+    case SHA256_BACKEND_SHANI:
+        return "sha-ni";
+    }
+    return "unknown";
+}
+
+int sha256_batch_lanes(void) {
+    return sha256_lanes;
+}
+
+// Pick the fastest supported backend and the widest batch lanes before
+// main() runs
+__attribute__((constructor))
+static void sha256_select_backend(void) {
+    if (!sha256_set_backend(SHA256_BACKEND_SHANI))
+        sha256_set_backend(SHA256_BACKEND_SCALAR);
+#ifdef SHA256_HAVE_SHANI
+    sha256_have_avx2 = __builtin_cpu_supports("avx2");
+    if (__builtin_cpu_supports("avx512f"))
+        sha256_lanes = 16;
+    else if (sha256_have_avx2)
+        sha256_lanes = 8;
+#endif
+}
+
 void sha256_transform(SHA256_CTX *ctx, const uint8_t data[]) {
-    uint32_t a, b, c, d, e, f, g, h, i, j, t1, t2, m[64];
-
-    for (i = 0, j = 0; i < 16; ++i, j += 4)
-        m[i] = ((uint32_t)data[j] << 24) | ((uint32_t)data[j + 1] << 16) |
-               ((uint32_t)data[j + 2] << 8) | ((uint32_t)data[j + 3]);
-
-    for (; i < 64; ++i)
-        m[i] = SIG1(m[i - 2]) + m[i - 7] + SIG0(m[i - 15]) + m[i - 16];
-
-    a = ctx->state[0];
-    b = ctx->state[1];
-    c = ctx->state[2];
-    d = ctx->state[3];
-    e = ctx->state[4];
-    f = ctx->state[5];
-    g = ctx->state[6];
-    h = ctx->state[7];
-
-    for (i = 0; i < 64; ++i) {
-        t1 = h + EP1(e) + CH(e,f,g) + k[i] + m[i];
-        t2 = EP0(a) + MAJ(a,b,c);
-        h = g;
-        g = f;
-        f = e;
-        e = d + t1;
-        d = c;
-        c = b;
-        b = a;
-        a = t1 + t2;
-    }
-
-    ctx->state[0] += a;
-    ctx->state[1] += b;
-    ctx->state[2] += c;
-    ctx->state[3] += d;
-    ctx->state[4] += e;
-    ctx->state[5] += f;
-    ctx->state[6] += g;
-    ctx->state[7] += h;
+    sha256_blocks(ctx->state, data, 1);
+    METRIC_ADD(METRIC_SHA256_COMPRESSIONS, 1);
 }
 
 void sha256_update(SHA256_CTX *ctx, const uint8_t data[], size_t len) {
-    uint32_t i;
-    for (i = 0; i < len; ++i) {
-        ctx->data[ctx->datalen] = data[i];
-        ctx->datalen++;
-        if (ctx->datalen == 64) {
-            sha256_transform(ctx, ctx->data);
-            ctx->bitlen += 512;
-            ctx->datalen = 0;
-        }
+    // Top up a partially filled buffer first
+    if (ctx->datalen) {
+        size_t fill = 64 - ctx->datalen;
+        if (fill > len) fill = len;
+        memcpy(ctx->data + ctx->datalen, data, fill);
+        ctx->datalen += fill;
+        data += fill;
+        len -= fill;
+        if (ctx->datalen < 64) return;
+        sha256_transform(ctx, ctx->data);
+        ctx->bitlen += 512;
+        ctx->datalen = 0;
+    }
+
+    // Whole blocks are compressed straight from the caller's memory
+    if (len >= 64) {
+        size_t nblocks = len / 64;
+        sha256_blocks(ctx->state, data, nblocks);
+        METRIC_ADD(METRIC_SHA256_COMPRESSIONS, nblocks);
+        ctx->bitlen += (uint64_t)nblocks * 512;
+        data += nblocks * 64;
+        len -= nblocks * 64;
+    }
+
+    if (len) {
+        memcpy(ctx->data, data, len);
+        ctx->datalen = (uint32_t)len;
     }
 }
 
@@ -108,6 +302,8 @@ void sha256_final(SHA256_CTX *ctx, uint8_t hash[]) {
     }
 
     ctx->bitlen += ctx->datalen * 8;
+    METRIC_ADD(METRIC_SHA256_HASHES, 1);
+    METRIC_ADD(METRIC_SHA256_BYTES, ctx->bitlen / 8);
     ctx->data[63] = ctx->bitlen;
     ctx->data[62] = ctx->bitlen >> 8;
     ctx->data[61] = ctx->bitlen >> 16;
@@ -135,4 +331,241 @@ void sha256(const uint8_t *data, size_t len, uint8_t hash[]) {
     sha256_init(&ctx);
     sha256_update(&ctx, data, len);
     sha256_final(&ctx, hash);
-} 
\ No newline at end of file
+}
+
+// Multi-buffer hashing: one message per SIMD lane. Each lane walks its own
+// message blocks in place and finishes with up to two padding blocks built
+// in tail[]; lanes with fewer blocks idle on a zero block once their digest
+// has been written out.
+typedef struct {
+    const uint8_t *data;
+    size_t full_blocks;
+    size_t total_blocks;
+    uint8_t *out;
+    uint8_t tail[128];
+} SHA256_LANE;
+
+static const uint8_t sha256_zero_block[64];
+
+static void sha256_lane_init(SHA256_LANE *lane, const uint8_t *data, size_t len, uint8_t *out) {
+    size_t rem = len % 64;
+    uint64_t bitlen = (uint64_t)len * 8;
+    size_t tail_len = rem < 56 ? 64 : 128;
+
+    lane->data = data;
+    lane->full_blocks = len / 64;
+    lane->total_blocks = lane->full_blocks + tail_len / 64;
+    lane->out = out;
+
+    memset(lane->tail, 0, tail_len);
+    if (rem) memcpy(lane->tail, data + len - rem, rem);
+    lane->tail[rem] = 0x80;
+    for (int i = 0; i < 8; i++)
+        lane->tail[tail_len - 1 - i] = (uint8_t)(bitlen >> (i * 8));
+}
+
+static const uint8_t *sha256_lane_block(const SHA256_LANE *lane, size_t b) {
+    if (b < lane->full_blocks) return lane->data + b * 64;
+    if (b < lane->total_blocks) return lane->tail + (b - lane->full_blocks) * 64;
+    return sha256_zero_block;
+}
+
+static void sha256_lane_store(const SHA256_LANE *lane, const uint32_t state[8]) {
+    for (int i = 0; i < 8; i++) {
+        lane->out[i * 4]     = (uint8_t)(state[i] >> 24);
+        lane->out[i * 4 + 1] = (uint8_t)(state[i] >> 16);
+        lane->out[i * 4 + 2] = (uint8_t)(state[i] >> 8);
+        lane->out[i * 4 + 3] = (uint8_t)state[i];
+    }
+}
+
+// Expands to a kernel hashing `lanes` messages at once, written with GCC
+// vector extensions so the same code compiles to SSE2, AVX2 or AVX-512.
+#define DEFINE_SHA256_MB(name, lanes, attrs)                                    \
+typedef uint32_t name##_vec __attribute__((vector_size((lanes) * 4)));         \
+attrs static void name(const SHA256_LANE *lane) {                              \
+    name##_vec s[8], w[64], a, b, c, d, e, f, g, h, t1, t2;                    \
+    size_t max_blocks = 0;                                                     \
+    int i, l;                                                                  \
+                                                                               \
+    for (l = 0; l < (lanes); l++)                                              \
+        if (lane[l].total_blocks > max_blocks) max_blocks = lane[l].total_blocks; \
+    for (i = 0; i < 8; i++)                                                    \
+        s[i] = (name##_vec){0} + sha256_iv[i];                                 \
+                                                                               \
+    for (size_t blk = 0; blk < max_blocks; blk++) {                            \
+        for (l = 0; l < (lanes); l++) {                                        \
+            const uint8_t *p = sha256_lane_block(&lane[l], blk);               \
+            for (i = 0; i < 16; i++)                                           \
+                w[i][l] = load_be32(p + i * 4);                                \
+        }                                                                      \
+        for (i = 16; i < 64; i++)                                              \
+            w[i] = SIG1(w[i - 2]) + w[i - 7] + SIG0(w[i - 15]) + w[i - 16];    \
+                                                                               \
+        a = s[0]; b = s[1]; c = s[2]; d = s[3];                                \
+        e = s[4]; f = s[5]; g = s[6]; h = s[7];                                \
+        for (i = 0; i < 64; i++) {                                             \
+            t1 = h + EP1(e) + CH(e,f,g) + k[i] + w[i];                         \
+            t2 = EP0(a) + MAJ(a,b,c);                                          \
+            h = g; g = f; f = e; e = d + t1;                                   \
+            d = c; c = b; b = a; a = t1 + t2;                                  \
+        }                                                                      \
+        s[0] += a; s[1] += b; s[2] += c; s[3] += d;                            \
+        s[4] += e; s[5] += f; s[6] += g; s[7] += h;                            \
+                                                                               \
+        for (l = 0; l < (lanes); l++) {                                        \
+            if (lane[l].total_blocks == blk + 1) {                             \
+                uint32_t st[8];                                                \
+                for (i = 0; i < 8; i++) st[i] = s[i][l];                       \
+                sha256_lane_store(&lane[l], st);                               \
+            }                                                                  \
+        }                                                                      \
+    }                                                                          \
+}
+
+DEFINE_SHA256_MB(sha256_mb4, 4, )
+#ifdef SHA256_HAVE_SHANI
+DEFINE_SHA256_MB(sha256_mb8, 8, __attribute__((target("avx2"))))
+DEFINE_SHA256_MB(sha256_mb16, 16, __attribute__((target("avx512f"))))
+#endif
+
+// Hashes one group of messages on the kernel `lanes` wide, which this CPU
+// must support
+static void sha256_mb_group(const uint8_t *const data[], const size_t lens[], int lanes,
+                            uint8_t hashes[][SHA256_DIGEST_SIZE]) {
+    SHA256_LANE group[16];
+
+    for (int l = 0; l < lanes; l++) {
+        sha256_lane_init(&group[l], data[l], lens[l], hashes[l]);
+        METRIC_ADD(METRIC_SHA256_BYTES, lens[l]);
+        METRIC_ADD(METRIC_SHA256_COMPRESSIONS, group[l].total_blocks);
+    }
+    METRIC_ADD(METRIC_SHA256_HASHES, lanes);
+#ifdef SHA256_HAVE_SHANI
+    if (lanes == 16) { sha256_mb16(group); return; }
+    if (lanes == 8) { sha256_mb8(group); return; }
+#endif
+    sha256_mb4(group);
+}
+
+void sha256_batch(const uint8_t *const data[], const size_t lens[], size_t count,
+                  uint8_t hashes[][SHA256_DIGEST_SIZE]) {
+    size_t i = 0;
+
+    // Full groups at the widest width, then what is left through the
+    // narrower kernels, so a short batch or tail still runs in SIMD lanes
+    for (int lanes = sha256_lanes; lanes >= 4; lanes /= 2) {
+        if (lanes == 8 && !sha256_have_avx2) continue;
+        for (; i + lanes <= count; i += lanes)
+            sha256_mb_group(data + i, lens + i, lanes, hashes + i);
+    }
+
+    // Scalar for the last one to three messages
+    for (; i < count; i++)
+        sha256(data[i], lens[i], hashes[i]);
+}
+
+// Always the 8-lane kernel where AVX2 is present, even when batches use
+// 16 lanes
+void sha256_x8(const uint8_t *const data[8], const size_t lens[8],
+               uint8_t hashes[8][SHA256_DIGEST_SIZE]) {
+    if (sha256_have_avx2) sha256_mb_group(data, lens, 8, hashes);
+    else sha256_batch(data, lens, 8, hashes);
+}
+
+// Known-answer vectors from FIPS 180-2 / NIST CAVS
+static const struct {
+    const char *message;
+    size_t repeat;
+    const char *digest;
+} sha256_vectors[] = {
+    { "", 1, "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855" },
+    { "abc", 1, "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad" },
+    { "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 1,
+      "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1" },
+    { "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu", 1,
+      "cf5b16a778af8380036ce59e7b0492370b249b11e8f07a51afac45037afee9d1" },
+    { "a", 1000000, "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0" }
+};
+
+static int digest_matches(const uint8_t hash[], const char *hex) {
+    char buf[SHA256_DIGEST_SIZE * 2 + 1];
+    for (int i = 0; i < SHA256_DIGEST_SIZE; i++)
+        snprintf(buf + i * 2, 3, "%02x", hash[i]);
+    return strcmp(buf, hex) == 0;
+}
+
+static int check_vectors(void) {
+    uint8_t hash[SHA256_DIGEST_SIZE];
+
+    for (size_t v = 0; v < sizeof(sha256_vectors) / sizeof(sha256_vectors[0]); v++) {
+        SHA256_CTX ctx;
+        size_t len = strlen(sha256_vectors[v].message);
+
+        sha256_init(&ctx);
+        for (size_t r = 0; r < sha256_vectors[v].repeat; r++)
+            sha256_update(&ctx, (const uint8_t*)sha256_vectors[v].message, len);
+        sha256_final(&ctx, hash);
+
+        if (!digest_matches(hash, sha256_vectors[v].digest)) return 0;
+    }
+    return 1;
+}
+
+// Checks every supported backend against the NIST vectors and against the
+// scalar backend on pseudo-random inputs. Restores the active backend.
+int sha256_self_test(void) {
+    SHA256_BACKEND saved = sha256_get_backend();
+    uint8_t input[1024], expected[SHA256_DIGEST_SIZE], actual[SHA256_DIGEST_SIZE];
+    uint32_t seed = 0x9e3779b9;
+    int ok = 1;
+
+    for (size_t i = 0; i < sizeof(input); i++) {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        input[i] = (uint8_t)seed;
+    }
+
+    for (int b = SHA256_BACKEND_SCALAR; b <= SHA256_BACKEND_SHANI && ok; b++) {
+        if (!sha256_set_backend((SHA256_BACKEND)b)) continue;
+
+        ok = check_vectors();
+        for (size_t len = 0; len <= sizeof(input) && ok; len += 7) {
+            sha256_set_backend(SHA256_BACKEND_SCALAR);
+            sha256(input, len, expected);
+            sha256_set_backend((SHA256_BACKEND)b);
+            sha256(input, len, actual);
+            ok = memcmp(expected, actual, SHA256_DIGEST_SIZE) == 0;
+        }
+    }
+
+    sha256_set_backend(saved);
+
+    // Batch API: mixed lengths, more messages than one group of lanes
+    if (ok) {
+        const uint8_t *msgs[37];
+        size_t lens[37];
+        uint8_t batch[37][SHA256_DIGEST_SIZE];
+
+        for (size_t i = 0; i < 37; i++) {
+            msgs[i] = input + i;
+            lens[i] = (i * 61) % (sizeof(input) - i);
+        }
+        // Every count up to 37 takes a different mix of widths and scalar
+        for (size_t count = 1; count <= 37 && ok; count++) {
+            sha256_batch(msgs, lens, count, batch);
+            for (size_t i = 0; i < count && ok; i++) {
+                sha256(msgs[i], lens[i], expected);
+                ok = memcmp(expected, batch[i], SHA256_DIGEST_SIZE) == 0;
+            }
+        }
+
+        sha256_x8(msgs, lens, batch);
+        for (size_t i = 0; i < 8 && ok; i++) {
+            sha256(msgs[i], lens[i], expected);
+            ok = memcmp(expected, batch[i], SHA256_DIGEST_SIZE) == 0;
+        }
+    }
+    return ok;
+}
@@ -16,6 +16,12 @@ typedef struct {
     uint32_t state[8];
 } SHA256_CTX;
 
+// Compression function backends, selected once at startup via CPUID
+typedef enum {
+    SHA256_BACKEND_SCALAR = 0,
+    SHA256_BACKEND_SHANI
+} SHA256_BACKEND;
+
 // Function declarations
 void sha256_init(SHA256_CTX *ctx);
 void sha256_update(SHA256_CTX *ctx, const uint8_t data[], size_t len);
@@ -23,4 +29,18 @@ void sha256_final(SHA256_CTX *ctx, uint8_t hash[]);
 void sha256_transform(SHA256_CTX *ctx, const uint8_t data[]);
 void sha256(const uint8_t *data, size_t len, uint8_t hash[]);
 
+// Backend selection
+int sha256_backend_supported(SHA256_BACKEND backend);
+int sha256_set_backend(SHA256_BACKEND backend);
+SHA256_BACKEND sha256_get_backend(void);
+const char* sha256_backend_name(SHA256_BACKEND backend);
+int sha256_self_test(void);
+
+// Multi-buffer hashing of independent messages in SIMD lanes
+void sha256_batch(const uint8_t *const data[], const size_t lens[], size_t count,
+                  uint8_t hashes[][SHA256_DIGEST_SIZE]);
+void sha256_x8(const uint8_t *const data[8], const size_t lens[8],
+               uint8_t hashes[8][SHA256_DIGEST_SIZE]);
+int sha256_batch_lanes(void);
+
 #endif // SHA256_H 
\ No newline at end of file
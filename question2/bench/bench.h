@@ -0,0 +1,154 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "blockchain.h"
+
+// Timing harness shared by every benchmark. Every case runs a few untimed
+// warmup rounds, then is timed over several repetitions and reported as
+// the median and p99 time per operation. Figures that are not times, such
+// as sizes and counts, go through bench_value. Results go to stdout as CSV,
+// or as one JSON object per line with --json, so runs can be diffed and
+// tracked.
+
+#define BENCH_MAX_REPS 1000
+
+typedef struct {
+    int json;
+    int warmup;
+    int reps;
+    long max_blocks;  // largest chain the chain-length sweeps build
+} BenchConfig;
+
+typedef void (*bench_fn)(void* context);
+
+static inline double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static inline uint64_t bench_splitmix64(uint64_t* state) {
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// A difficulty-0 chain of n mined blocks, each holding payments in whole
+// cents among accounts named accounts; the last block stays the tip
+static inline Blockchain* bench_build_chain(size_t n, int transactions_per_block, int accounts) {
+    Blockchain* chain = create_blockchain(0);
+    if (!chain) return NULL;
+
+    uint64_t seed = 42;
+    char sender[32], receiver[32];
+    for (size_t b = 0; b < n; b++) {
+        for (int t = 0; t < transactions_per_block; t++) {
+            snprintf(sender, sizeof(sender), "account-%04d", (int)(bench_splitmix64(&seed) % accounts));
+            snprintf(receiver, sizeof(receiver), "account-%04d", (int)(bench_splitmix64(&seed) % accounts));
+            double amount = (double)(bench_splitmix64(&seed) % 100000 + 1) / 100.0;
+            add_transaction(chain->latest, sender, receiver, amount);
+        }
+        mine_block(chain->latest, 0, 1);
+        if (b + 1 < n) add_block(chain);
+    }
+    return chain;
+}
+
+static inline int bench_compare(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static inline void bench_usage(const char* program) {
+    fprintf(stderr, "usage: %s [--json] [--reps N] [--warmup N] [--max-blocks N]\n", program);
+    exit(2);
+}
+
+static inline BenchConfig bench_parse_args(int argc, char** argv) {
+    BenchConfig config = { 0, 2, 11, 1000000 };
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            config.json = 1;
+        } else if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc) {
+            config.reps = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+            config.warmup = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--max-blocks") == 0 && i + 1 < argc) {
+            config.max_blocks = atol(argv[++i]);
+        } else {
+            bench_usage(argv[0]);
+        }
+    }
+    if (config.reps < 1 || config.reps > BENCH_MAX_REPS || config.warmup < 0) bench_usage(argv[0]);
+    return config;
+}
+
+static inline void bench_header(const BenchConfig* config) {
+    if (!config->json)
+        printf("benchmark,param,reps,median_ns_per_op,p99_ns_per_op,ops_per_s,mb_per_s,value,unit\n");
+}
+
+// Reports reps timed samples in seconds, sorting them in place; each one
+// covers ops operations touching bytes bytes (0 when throughput in bytes
+// means nothing). For timings taken by the caller, such as per-block
+// latencies inside one run. Returns the median sample.
+static inline double bench_report(const BenchConfig* config, const char* name, long param,
+                                double* samples, int reps, double ops, double bytes) {
+    if (reps < 1) return 0;
+    qsort(samples, (size_t)reps, sizeof(double), bench_compare);
+
+    // Nearest-rank percentiles; with few repetitions p99 is the slowest run
+    double median = samples[(reps - 1) / 2];
+    int p99_rank = (99 * reps + 99) / 100;
+    double p99 = samples[p99_rank - 1];
+    double mb_per_s = bytes > 0 ? bytes / median / 1e6 : 0;
+
+    if (config->json) {
+        printf("{\"benchmark\":\"%s\",\"param\":%ld,\"reps\":%d,\"median_ns_per_op\":%.2f,"
+               "\"p99_ns_per_op\":%.2f,\"ops_per_s\":%.1f,\"mb_per_s\":%.2f}\n",
+               name, param, reps, median / ops * 1e9, p99 / ops * 1e9, ops / median, mb_per_s);
+    } else {
+        printf("%s,%ld,%d,%.2f,%.2f,%.1f,%.2f,,\n", name, param, reps, median / ops * 1e9,
+               p99 / ops * 1e9, ops / median, mb_per_s);
+    }
+    fflush(stdout);
+    return median;
+}
+
+// Times reps runs of fn after the warmup, reports them and returns the
+// median run. reps of 0 uses the configured count; expensive cases pass
+// fewer and warm up only once.
+static inline double bench_run(const BenchConfig* config, const char* name, long param, int reps,
+                             bench_fn fn, void* context, double ops, double bytes) {
+    double samples[BENCH_MAX_REPS];
+    int warmup = config->warmup;
+
+    if (reps > 0 && warmup > 1) warmup = 1;
+    if (reps <= 0 || reps > config->reps) reps = config->reps;
+    for (int i = 0; i < warmup; i++) fn(context);
+    for (int i = 0; i < reps; i++) {
+        double start = bench_now();
+        fn(context);
+        samples[i] = bench_now() - start;
+    }
+    return bench_report(config, name, param, samples, reps, ops, bytes);
+}
+
+// Reports a figure that is not a time, in unit: a size, a count, a ratio
+static inline void bench_value(const BenchConfig* config, const char* name, long param, double value,
+                               const char* unit) {
+    if (config->json)
+        printf("{\"benchmark\":\"%s\",\"param\":%ld,\"value\":%.10g,\"unit\":\"%s\"}\n", name, param,
+               value, unit);
+    else
+        printf("%s,%ld,,,,,,%.10g,%s\n", name, param, value, unit);
+    fflush(stdout);
+}
+
+#endif // BENCH_H
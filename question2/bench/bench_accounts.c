@@ -0,0 +1,97 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "blockchain.h"
+#include "chainfile.h"
+
+// Working set and filter speed of transactions holding interned account
+// IDs, against the old layout that spelled out both names in 64-byte
+// fields (still the chain file record layout). The filter totals what one
+// account sent: an integer compare per transaction against a strcmp.
+// The param is the transaction count.
+
+#define TRANSACTIONS 2000000
+#define ACCOUNTS 10000
+
+static double sent_by_name(const ChainFileNamedTransaction* txs, size_t n, const char* name) {
+    double total = 0;
+    for (size_t i = 0; i < n; i++)
+        if (strcmp(txs[i].sender, name) == 0) total += txs[i].amount;
+    return total;
+}
+
+static double sent_by_id(const Transaction* txs, size_t n, AccountId id) {
+    double total = 0;
+    for (size_t i = 0; i < n; i++)
+        if (txs[i].sender == id) total += txs[i].amount;
+    return total;
+}
+
+typedef struct {
+    const Transaction* txs;
+    const ChainFileNamedTransaction* named;
+    const char* name;
+    AccountId id;
+    double name_total;
+    double id_total;
+} FilterCase;
+
+static void run_by_name(void* context) {
+    FilterCase* c = (FilterCase*)context;
+
+    c->name_total = sent_by_name(c->named, TRANSACTIONS, c->name);
+}
+
+static void run_by_id(void* context) {
+    FilterCase* c = (FilterCase*)context;
+
+    c->id_total = sent_by_id(c->txs, TRANSACTIONS, c->id);
+}
+
+int main(int argc, char** argv) {
+    BenchConfig config = bench_parse_args(argc, argv);
+    Transaction* txs = (Transaction*)malloc(TRANSACTIONS * sizeof(Transaction));
+    ChainFileNamedTransaction* named = (ChainFileNamedTransaction*)malloc(TRANSACTIONS * sizeof(ChainFileNamedTransaction));
+    if (!txs || !named) return 1;
+
+    // Names share a long prefix, as addresses tend to, so strcmp cannot
+    // settle most comparisons on the first byte. Interning happens once,
+    // so it is a single sample.
+    uint64_t seed = 42;
+    char name[ACCOUNT_NAME_SIZE];
+    double intern = bench_now();
+    for (size_t i = 0; i < TRANSACTIONS; i++) {
+        snprintf(name, sizeof(name), "wallet-0000-%05d", (int)(bench_splitmix64(&seed) % ACCOUNTS));
+        txs[i].sender = account_intern(name);
+        snprintf(name, sizeof(name), "wallet-0000-%05d", (int)(bench_splitmix64(&seed) % ACCOUNTS));
+        txs[i].receiver = account_intern(name);
+        txs[i].amount = (double)(bench_splitmix64(&seed) % 10000) / 100.0;
+        txs[i].timestamp = (time_t)(1700000000 + i);
+    }
+    intern = bench_now() - intern;
+    for (size_t i = 0; i < TRANSACTIONS; i++) chainfile_fill_named_transaction(&txs[i], &named[i]);
+
+    const char* target = "wallet-0000-00042";
+    FilterCase c = { txs, named, target, account_lookup(target), 0, 0 };
+    double named_bytes = (double)TRANSACTIONS * sizeof(ChainFileNamedTransaction);
+    double id_bytes = (double)TRANSACTIONS * sizeof(Transaction);
+
+    bench_header(&config);
+    bench_report(&config, "account_intern", TRANSACTIONS, &intern, 1, 2.0 * TRANSACTIONS, 0);
+    double by_name = bench_run(&config, "filter_by_name", TRANSACTIONS, 0, run_by_name, &c, TRANSACTIONS,
+                               named_bytes);
+    double by_id = bench_run(&config, "filter_by_id", TRANSACTIONS, 0, run_by_id, &c, TRANSACTIONS, id_bytes);
+    bench_value(&config, "filter_by_id_speedup", TRANSACTIONS, by_name / by_id, "x");
+    bench_value(&config, "transaction_bytes_named", TRANSACTIONS, (double)sizeof(ChainFileNamedTransaction), "B");
+    bench_value(&config, "transaction_bytes_id", TRANSACTIONS, (double)sizeof(Transaction), "B");
+    bench_value(&config, "transactions_named", TRANSACTIONS, named_bytes / 1e6, "MB");
+    bench_value(&config, "transactions_id", TRANSACTIONS, id_bytes / 1e6, "MB");
+    bench_value(&config, "account_names", (long)account_count(), account_count() * (ACCOUNT_NAME_SIZE + 1) / 1e6,
+                "MB");
+    if (c.name_total != c.id_total) fprintf(stderr, "filters disagree\n");
+
+    free(txs);
+    free(named);
+    return 0;
+}
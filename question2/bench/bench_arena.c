@@ -0,0 +1,96 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "blockchain.h"
+
+// Build and teardown of a linked chain of blocks: one malloc per block and
+// a pointer-chasing free (the previous create_block/free_blockchain path)
+// against the chain's slab arena.
+
+static void init_block(Block* block, uint32_t index) {
+    memset(block, 0, sizeof(Block));
+    block->index = index;
+    merkle_init(&block->tx_tree);
+}
+
+static void release_block(void* object) {
+    Block* block = (Block*)object;
+    merkle_free(&block->tx_tree);
+    free(block->transactions);
+}
+
+static void run_malloc(size_t n, double* build, double* teardown) {
+    double start = bench_now();
+    Block* genesis = (Block*)malloc(sizeof(Block));
+    init_block(genesis, 0);
+    Block* latest = genesis;
+    for (size_t i = 1; i < n; i++) {
+        Block* block = (Block*)malloc(sizeof(Block));
+        init_block(block, (uint32_t)i);
+        latest->next = block;
+        latest = block;
+    }
+    *build = bench_now() - start;
+
+    start = bench_now();
+    Block* current = genesis;
+    while (current) {
+        Block* next = current->next;
+        release_block(current);
+        free(current);
+        current = next;
+    }
+    *teardown = bench_now() - start;
+}
+
+static void run_arena(size_t n, double* build, double* teardown) {
+    Arena arena;
+
+    double start = bench_now();
+    arena_init(&arena, sizeof(Block));
+    Block* genesis = (Block*)arena_alloc(&arena);
+    init_block(genesis, 0);
+    Block* latest = genesis;
+    for (size_t i = 1; i < n; i++) {
+        Block* block = (Block*)arena_alloc(&arena);
+        init_block(block, (uint32_t)i);
+        latest->next = block;
+        latest = block;
+    }
+    *build = bench_now() - start;
+
+    start = bench_now();
+    arena_for_each(&arena, release_block);
+    arena_free(&arena);
+    *teardown = bench_now() - start;
+}
+
+int main(int argc, char** argv) {
+    BenchConfig config = bench_parse_args(argc, argv);
+    const size_t sizes[] = { 100000, 1000000, 3000000 };
+    double mb[BENCH_MAX_REPS], mt[BENCH_MAX_REPS], ab[BENCH_MAX_REPS], at[BENCH_MAX_REPS];
+
+    bench_header(&config);
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        // Build and teardown are timed apart within each run, so the runs
+        // are made here; the larger sizes take long enough for fewer
+        int reps = sizes[s] >= 1000000 && config.reps > 3 ? 3 : config.reps;
+        int warmup = sizes[s] >= 1000000 && config.warmup > 1 ? 1 : config.warmup;
+        for (int r = 0; r < warmup; r++) {
+            run_malloc(sizes[s], &mb[0], &mt[0]);
+            run_arena(sizes[s], &ab[0], &at[0]);
+        }
+        for (int r = 0; r < reps; r++) {
+            run_malloc(sizes[s], &mb[r], &mt[r]);
+            run_arena(sizes[s], &ab[r], &at[r]);
+        }
+
+        double n = (double)sizes[s];
+        bench_report(&config, "malloc_build", (long)sizes[s], mb, reps, n, 0);
+        bench_report(&config, "arena_build", (long)sizes[s], ab, reps, n, 0);
+        bench_report(&config, "malloc_free", (long)sizes[s], mt, reps, n, 0);
+        bench_report(&config, "arena_free", (long)sizes[s], at, reps, n, 0);
+    }
+    return 0;
+}
@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "bench.h"
+#include "blockchain.h"
+#include "chainlog.h"
+#include "chainwriter.h"
+
+// add_block latency with the log written on the producer's thread, under
+// two sync policies, against handing it to the background writer with
+// each backend. Every background batch is synced, so durability matches
+// syncing every block; the producer just stops waiting for it. Every
+// add_block is one sample; the param is the blocks per sync.
+
+#define BLOCKS 5000
+#define TRANSACTIONS_PER_BLOCK 10
+#define LOG_FILE "bench_background_log.log"
+
+typedef struct {
+    const char* name;
+    ChainLogOptions log;
+    int background;
+    CHAINWRITER_BACKEND backend;
+} Setup;
+
+static void run(const BenchConfig* config, const Setup* setup, double* latencies) {
+    unlink(LOG_FILE);
+    Blockchain* chain = open_blockchain_log(LOG_FILE, 0, &setup->log);
+    ChainWriterOptions options = { setup->backend, 0, 0, NULL, NULL };
+    if (!chain || (setup->background && !start_background_log(chain, &options))) {
+        fprintf(stderr, "%s: could not open the log\n", setup->name);
+        free_blockchain(chain);
+        return;
+    }
+
+    double start = bench_now();
+    for (int b = 0; b < BLOCKS; b++) {
+        for (int i = 0; i < TRANSACTIONS_PER_BLOCK; i++)
+            add_transaction(chain->latest, "Alice", "Bob", 1.0 + i);
+        mine_block(chain->latest, chain->difficulty, 1);
+
+        double before = bench_now();
+        add_block(chain);
+        latencies[b] = bench_now() - before;
+    }
+    double produced = bench_now() - start;
+    // Until everything is on disk, for the durable rate
+    sync_blockchain_log(chain);
+    double durable = bench_now() - start;
+
+    char name[64];
+    if (setup->background)
+        snprintf(name, sizeof(name), "%s/%s", setup->name, chainwriter_backend_name(chain->writer->backend));
+    else
+        snprintf(name, sizeof(name), "%s", setup->name);
+    uint64_t syncs = setup->background ? chain->writer->batches_written : chain->log->syncs;
+    long param = setup->log.sync_every;
+
+    // bench_report sorts the latencies, which leaves the worst one last
+    bench_report(config, name, param, latencies, BLOCKS, 1, 0);
+    size_t length = strlen(name);
+    snprintf(name + length, sizeof(name) - length, "_max");
+    bench_value(config, name, param, latencies[BLOCKS - 1] * 1e9, "ns");
+    snprintf(name + length, sizeof(name) - length, "_blocks_per_s");
+    bench_value(config, name, param, BLOCKS / produced, "blocks/s");
+    snprintf(name + length, sizeof(name) - length, "_durable_per_s");
+    bench_value(config, name, param, BLOCKS / durable, "blocks/s");
+    snprintf(name + length, sizeof(name) - length, "_syncs");
+    bench_value(config, name, param, (double)syncs, "syncs");
+    free_blockchain(chain);
+}
+
+int main(int argc, char** argv) {
+    BenchConfig config = bench_parse_args(argc, argv);
+    double* latencies = (double*)malloc(BLOCKS * sizeof(double));
+    if (!latencies) return 1;
+
+    const Setup setups[] = {
+        { "add_block_sync", { 1, 0 }, 0, CHAINWRITER_BACKEND_PWRITE },
+        { "add_block_sync", { 64, 0 }, 0, CHAINWRITER_BACKEND_PWRITE },
+        { "add_block_background", { 1, 0 }, 1, CHAINWRITER_BACKEND_PWRITE },
+        { "add_block_background", { 1, 0 }, 1, CHAINWRITER_BACKEND_IO_URING },
+    };
+
+    bench_header(&config);
+    for (size_t s = 0; s < sizeof(setups) / sizeof(setups[0]); s++) {
+        if (setups[s].background && !chainwriter_backend_supported(setups[s].backend)) {
+            fprintf(stderr, "%s/%s: backend unavailable\n", setups[s].name,
+                    chainwriter_backend_name(setups[s].backend));
+            continue;
+        }
+        run(&config, &setups[s], latencies);
+    }
+
+    unlink(LOG_FILE);
+    free(latencies);
+    return 0;
+}
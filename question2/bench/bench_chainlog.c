@@ -0,0 +1,118 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "bench.h"
+#include "blockchain.h"
+#include "chainlog.h"
+
+// Cost of persisting each new block: the append-only log under different
+// sync policies, against rewriting the whole chain with save_blockchain.
+// A log run opens a fresh log, appends BLOCKS blocks and closes it, so the
+// final sync of every policy is part of the time.
+
+#define BLOCKS 10000
+#define TRANSACTIONS_PER_BLOCK 4
+#define LOG_REPS 3
+#define LOG_FILE "bench_chainlog.log"
+#define SNAPSHOT_FILE "bench_chainlog.dat"
+
+static long file_size(const char* filename) {
+    struct stat st;
+    return stat(filename, &st) == 0 ? (long)st.st_size : -1;
+}
+
+static void fill_tip(Blockchain* chain) {
+    for (int i = 0; i < TRANSACTIONS_PER_BLOCK; i++)
+        add_transaction(chain->latest, "Alice", "Bob", 1.0 + i);
+    mine_block(chain->latest, chain->difficulty, 1);
+}
+
+typedef struct {
+    ChainLogOptions options;
+    uint64_t syncs;
+    double bytes_per_block;
+    int failed;
+} LogCase;
+
+static void run_log(void* context) {
+    LogCase* c = (LogCase*)context;
+
+    unlink(LOG_FILE);
+    Blockchain* chain = open_blockchain_log(LOG_FILE, 0, &c->options);
+    if (!chain) {
+        c->failed = 1;
+        return;
+    }
+    for (int b = 0; b < BLOCKS; b++) {
+        fill_tip(chain);
+        add_block(chain);
+    }
+
+    // The flusher thread may still be counting syncs
+    ChainLog* log = chain->log;
+    pthread_mutex_lock(&log->lock);
+    c->syncs = log->syncs;
+    pthread_mutex_unlock(&log->lock);
+    c->bytes_per_block = (double)log->bytes_written / log->blocks_written;
+    free_blockchain(chain);
+}
+
+typedef struct {
+    Blockchain* chain;
+} SaveCase;
+
+static void run_save(void* context) {
+    SaveCase* c = (SaveCase*)context;
+
+    if (!save_blockchain(c->chain, SNAPSHOT_FILE)) fprintf(stderr, "save_blockchain failed\n");
+}
+
+int main(int argc, char** argv) {
+    BenchConfig config = bench_parse_args(argc, argv);
+    // The param is the policy's block count or interval; 0 syncs on close
+    const struct {
+        const char* name;
+        long param;
+        ChainLogOptions options;
+    } policies[] = {
+        { "chainlog_sync_every", 1, { 1, 0 } },
+        { "chainlog_sync_every", 64, { 64, 0 } },
+        { "chainlog_sync_interval_ms", 10, { 0, 10 } },
+        { "chainlog_sync_on_close", 0, { 0, 0 } },
+    };
+
+    bench_header(&config);
+    for (size_t p = 0; p < sizeof(policies) / sizeof(policies[0]); p++) {
+        LogCase c = { policies[p].options, 0, 0, 0 };
+        bench_run(&config, policies[p].name, policies[p].param, LOG_REPS, run_log, &c, BLOCKS, 0);
+        if (c.failed) return 1;
+
+        char name[64];
+        snprintf(name, sizeof(name), "%s_syncs", policies[p].name);
+        bench_value(&config, name, policies[p].param, (double)c.syncs, "syncs");
+        snprintf(name, sizeof(name), "%s_bytes", policies[p].name);
+        bench_value(&config, name, policies[p].param, c.bytes_per_block, "B/block");
+    }
+    unlink(LOG_FILE);
+
+    // A full rewrite per block writes the whole chain every time; the
+    // param is the chain's length when the new block is saved
+    Blockchain* chain = create_blockchain(0);
+    if (!chain) return 1;
+    for (int b = 1; b <= BLOCKS; b++) {
+        fill_tip(chain);
+        add_block(chain);
+        if (b == 100 || b == 1000 || b == BLOCKS) {
+            SaveCase c = { chain };
+            run_save(&c);
+            double bytes = (double)file_size(SNAPSHOT_FILE);
+            bench_run(&config, "save_blockchain_per_block", b, 0, run_save, &c, 1, bytes);
+            bench_value(&config, "save_blockchain_bytes", b, bytes, "B/block");
+        }
+    }
+    free_blockchain(chain);
+    unlink(SNAPSHOT_FILE);
+    return 0;
+}
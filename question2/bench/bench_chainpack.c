@@ -0,0 +1,116 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "bench.h"
+#include "blockchain.h"
+#include "chainpack.h"
+
+// File size, save and load time of the version 4 chain file against the
+// compact pack format, stored and LZ-compressed. Loads are timed with the
+// file in the page cache and again after dropping it from the cache; the
+// disk estimate adds the time to read the file at DISK_MB_PER_S to the
+// cached load, for disks slower than the one this runs on. The param is
+// the chain's length in blocks.
+
+#define BLOCKS 100000
+#define TRANSACTIONS_PER_BLOCK 10
+#define ACCOUNTS 1000
+#define REPS 3
+#define DISK_MB_PER_S 100.0
+#define BENCH_FILE "bench_chainpack.tmp"
+
+static long file_size(const char* filename) {
+    struct stat st;
+    return stat(filename, &st) == 0 ? (long)st.st_size : -1;
+}
+
+// Writes the file back and asks the kernel to forget its cached pages
+static void drop_cache(const char* filename) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return;
+
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+typedef struct {
+    const char* name;
+    int packed;
+    ChainPackOptions options;
+} Format;
+
+static void run(const BenchConfig* config, Blockchain* chain, const Format* format, long baseline) {
+    double save[BENCH_MAX_REPS], warm[BENCH_MAX_REPS], cold[BENCH_MAX_REPS];
+    int reps = config->reps < REPS ? config->reps : REPS;
+    int ok = 1;
+
+    // Dropping the cache between loads is not part of any time, so the
+    // runs are made here rather than through bench_run
+    for (int r = 0; r < reps && ok; r++) {
+        double start = bench_now();
+        ok = format->packed ? save_compact_blockchain(chain, BENCH_FILE, &format->options)
+                            : save_blockchain(chain, BENCH_FILE);
+        save[r] = bench_now() - start;
+
+        start = bench_now();
+        Blockchain* loaded = load_blockchain(BENCH_FILE);
+        warm[r] = bench_now() - start;
+        ok = ok && loaded && get_block_count(loaded) == get_block_count(chain);
+        free_blockchain(loaded);
+
+        drop_cache(BENCH_FILE);
+        start = bench_now();
+        loaded = load_blockchain(BENCH_FILE);
+        cold[r] = bench_now() - start;
+        ok = ok && loaded;
+        free_blockchain(loaded);
+    }
+
+    long size = file_size(BENCH_FILE);
+    if (!ok || size <= 0) {
+        fprintf(stderr, "%s: save or load failed\n", format->name);
+        return;
+    }
+
+    char name[64];
+    snprintf(name, sizeof(name), "%s_save", format->name);
+    bench_report(config, name, BLOCKS, save, reps, BLOCKS, (double)size);
+    snprintf(name, sizeof(name), "%s_load", format->name);
+    double load = bench_report(config, name, BLOCKS, warm, reps, BLOCKS, (double)size);
+    snprintf(name, sizeof(name), "%s_load_cold", format->name);
+    bench_report(config, name, BLOCKS, cold, reps, BLOCKS, (double)size);
+
+    snprintf(name, sizeof(name), "%s_size", format->name);
+    bench_value(config, name, BLOCKS, size / 1e6, "MB");
+    snprintf(name, sizeof(name), "%s_smaller", format->name);
+    bench_value(config, name, BLOCKS, (double)baseline / size, "x");
+    snprintf(name, sizeof(name), "%s_load_at_disk_rate", format->name);
+    bench_value(config, name, BLOCKS, (load + size / (DISK_MB_PER_S * 1e6)) * 1e3, "ms");
+}
+
+int main(int argc, char** argv) {
+    BenchConfig config = bench_parse_args(argc, argv);
+    Blockchain* chain = bench_build_chain(BLOCKS, TRANSACTIONS_PER_BLOCK, ACCOUNTS);
+    if (!chain) return 1;
+
+    const Format formats[] = {
+        { "chain_file", 0, { 0, 0 } },
+        { "pack", 1, { 0, 0 } },
+        { "pack_lz", 1, { 1, 0 } },
+    };
+
+    // Every ratio is against the version 4 file
+    if (!save_blockchain(chain, BENCH_FILE)) return 1;
+    long baseline = file_size(BENCH_FILE);
+
+    bench_header(&config);
+    for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); i++) run(&config, chain, &formats[i], baseline);
+
+    unlink(BENCH_FILE);
+    free_blockchain(chain);
+    return 0;
+}
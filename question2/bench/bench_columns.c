@@ -0,0 +1,212 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "blockchain.h"
+#include "txcolumns.h"
+
+// Scan rate of the columnar transaction copy, per kernel and backend, over
+// ROWS rows (100M by default, or the first argument). MB/s counts the
+// column bytes a kernel has to read. For scale, the reference line is a
+// plain integer sum over the amounts, as the compiler builds it by default
+// (SSE2); the AVX2 scans should come close to or beat it.
+// A smaller chain then compares one account's payments found by walking
+// the blocks with the same question asked of the columns. The param is
+// the number of rows scanned.
+
+#define ROWS 100000000
+#define CHUNK 65536
+#define ACCOUNTS 100000
+#define REPS 3
+#define CHAIN_BLOCKS 10000
+#define CHAIN_TRANSACTIONS 100
+
+// IDs are used as given; the scans never resolve them to names
+static int fill_columns(TxColumns* columns, size_t rows) {
+    Transaction* chunk = (Transaction*)malloc(CHUNK * sizeof(Transaction));
+    if (!chunk || !txcolumns_reserve(columns, rows)) {
+        free(chunk);
+        return 0;
+    }
+
+    uint64_t seed = 42;
+    for (size_t done = 0; done < rows;) {
+        size_t n = rows - done < CHUNK ? rows - done : CHUNK;
+        for (size_t i = 0; i < n; i++) {
+            uint64_t r = bench_splitmix64(&seed);
+            chunk[i].sender = (AccountId)(r % ACCOUNTS);
+            chunk[i].receiver = (AccountId)((r >> 20) % ACCOUNTS);
+            chunk[i].amount = (double)((r >> 40) % 100000) / 100.0;
+            chunk[i].timestamp = (time_t)(1700000000 + (done + i) / 1000);
+        }
+        if (!txcolumns_append(columns, chunk, n)) break;
+        done += n;
+    }
+    free(chunk);
+    return columns->count == rows;
+}
+
+static volatile uint64_t sink;
+
+static void run_reference(void* context) {
+    const TxColumns* columns = (const TxColumns*)context;
+    const uint64_t* words = (const uint64_t*)columns->amounts;
+    uint64_t total[4] = { 0 };
+    size_t i = 0;
+
+    for (; i + 4 <= columns->count; i += 4)
+        for (int j = 0; j < 4; j++) total[j] += words[i + j];
+    for (; i < columns->count; i++) total[0] += words[i];
+    sink = total[0] + total[1] + total[2] + total[3];
+}
+
+typedef enum { SCAN_SUM, SCAN_WINDOW, SCAN_FLOW, SCAN_SELECT, SCAN_HISTOGRAM, SCAN_GROUP_BY } Scan;
+
+typedef struct {
+    Scan scan;
+    const char* name;
+    size_t bytes_per_row;
+} Kernel;
+
+typedef struct {
+    const TxColumns* columns;
+    Scan scan;
+    double* group_sent;
+    double* group_received;
+} ScanCase;
+
+static void run_scan(void* context) {
+    ScanCase* c = (ScanCase*)context;
+    const TxColumns* columns = c->columns;
+    size_t n = columns->count, matched = 0, rows[16];
+    int64_t from = 1700000000 + (int64_t)(n / 1000) * 2 / 5, to = from + (int64_t)(n / 1000) / 10;
+    const double edges[] = { 0, 10, 100, 250, 500, 750, 900, 990, 1000 };
+    uint64_t counts[8];
+    AccountFlow flow;
+
+    switch (c->scan) {
+    case SCAN_SUM:
+        sink = (uint64_t)txcolumns_sum(columns, 0, n);
+        break;
+    case SCAN_WINDOW:
+        sink = (uint64_t)txcolumns_sum_between(columns, 0, n, from, to, &matched) + matched;
+        break;
+    case SCAN_FLOW:
+        txcolumns_account_flow(columns, 0, n, 4242, &flow);
+        sink = flow.receipts + flow.payments;
+        break;
+    case SCAN_SELECT:
+        sink = txcolumns_select_account(columns, 0, n, 4242, rows, 16);
+        break;
+    case SCAN_HISTOGRAM:
+        txcolumns_histogram(columns, 0, n, edges, 8, counts);
+        sink = counts[0];
+        break;
+    case SCAN_GROUP_BY:
+        memset(c->group_sent, 0, ACCOUNTS * sizeof(double));
+        memset(c->group_received, 0, ACCOUNTS * sizeof(double));
+        txcolumns_group_by_account(columns, 0, n, c->group_sent, c->group_received, ACCOUNTS);
+        sink = (uint64_t)c->group_sent[0];
+        break;
+    }
+}
+
+typedef struct {
+    const Blockchain* chain;
+    const TxColumns* columns;
+    AccountId id;
+    double walked;
+    AccountFlow flow;
+} WalkCase;
+
+static void run_walk(void* context) {
+    WalkCase* c = (WalkCase*)context;
+
+    c->walked = 0;
+    for (const Block* block = c->chain->genesis; block; block = block->next)
+        for (int i = 0; i < block->transaction_count; i++)
+            if (block->transactions[i].sender == c->id) c->walked += block->transactions[i].amount;
+}
+
+static void run_flow(void* context) {
+    WalkCase* c = (WalkCase*)context;
+
+    txcolumns_account_flow(c->columns, 0, c->columns->count, c->id, &c->flow);
+}
+
+// One account's payments found through Block->next, then through the columns
+static void compare_chain_walk(const BenchConfig* config) {
+    Blockchain* chain = bench_build_chain(CHAIN_BLOCKS, CHAIN_TRANSACTIONS, 1000);
+    if (!chain) return;
+
+    const TxColumns* columns = enable_transaction_columns(chain) ? get_transaction_columns(chain) : NULL;
+    if (!columns) {
+        free_blockchain(chain);
+        return;
+    }
+
+    WalkCase c = { chain, columns, account_lookup("account-0042"), 0, { 0, 0, 0, 0 } };
+    long n = (long)columns->count;
+    double walk = bench_run(config, "chain_walk_account", n, REPS, run_walk, &c, (double)n, 0);
+    double scan = bench_run(config, "columns_account_flow", n, REPS, run_flow, &c, (double)n, 0);
+    bench_value(config, "columns_account_flow_speedup", n, walk / scan, "x");
+    if ((long long)(c.walked * 100 + 0.5) != (long long)(c.flow.sent * 100 + 0.5))
+        fprintf(stderr, "chain walk and columns totals differ\n");
+    free_blockchain(chain);
+}
+
+int main(int argc, char** argv) {
+    // A leading number is the row count; the rest are the harness's options
+    size_t rows = ROWS;
+    if (argc > 1 && argv[1][0] >= '0' && argv[1][0] <= '9') {
+        rows = strtoull(argv[1], NULL, 10);
+        argv[1] = argv[0];
+        argv++;
+        argc--;
+    }
+    BenchConfig config = bench_parse_args(argc, argv);
+    if (rows == 0) return 1;
+
+    TxColumns columns;
+    txcolumns_init(&columns);
+    double* group_sent = (double*)malloc(ACCOUNTS * sizeof(double));
+    double* group_received = (double*)malloc(ACCOUNTS * sizeof(double));
+    if (!group_sent || !group_received || !fill_columns(&columns, rows)) {
+        fprintf(stderr, "could not build %zu rows\n", rows);
+        return 1;
+    }
+
+    bench_header(&config);
+    bench_run(&config, "read_reference", (long)rows, REPS, run_reference, &columns, (double)rows,
+              (double)rows * sizeof(double));
+
+    const Kernel kernels[] = {
+        { SCAN_SUM, "sum", sizeof(double) },
+        { SCAN_WINDOW, "sum_in_window", sizeof(double) + sizeof(int64_t) },
+        { SCAN_FLOW, "account_flow", 2 * sizeof(double) + 2 * sizeof(AccountId) },
+        { SCAN_SELECT, "select_account", 2 * sizeof(AccountId) },
+        { SCAN_HISTOGRAM, "histogram", sizeof(double) },
+        { SCAN_GROUP_BY, "group_by_account", sizeof(double) + 2 * sizeof(AccountId) },
+    };
+    TXCOLUMNS_BACKEND original = txcolumns_get_backend();
+    for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+        for (int b = TXCOLUMNS_BACKEND_SCALAR; b <= TXCOLUMNS_BACKEND_AVX2; b++) {
+            // Group-by is scalar on every backend
+            if (kernels[k].scan == SCAN_GROUP_BY && b != TXCOLUMNS_BACKEND_SCALAR) continue;
+            if (!txcolumns_set_backend((TXCOLUMNS_BACKEND)b)) continue;
+
+            ScanCase c = { &columns, kernels[k].scan, group_sent, group_received };
+            char name[64];
+            snprintf(name, sizeof(name), "%s/%s", kernels[k].name, txcolumns_backend_name((TXCOLUMNS_BACKEND)b));
+            bench_run(&config, name, (long)rows, REPS, run_scan, &c, (double)rows,
+                      (double)rows * kernels[k].bytes_per_row);
+        }
+    }
+    txcolumns_set_backend(original);
+
+    txcolumns_free(&columns);
+    free(group_sent);
+    free(group_received);
+    compare_chain_walk(&config);
+    return 0;
+}
@@ -0,0 +1,81 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "bench.h"
+#include "blockchain.h"
+#include "chainexport.h"
+
+// Export throughput of every format on 1 to 4 threads, against printing
+// each block with print_block's fprintf calls. Output goes to /dev/null,
+// so the figures are formatting cost alone. The param is the thread count.
+
+#define BLOCKS 100000
+#define TRANSACTIONS_PER_BLOCK 10
+#define ACCOUNTS 1000
+#define REPS 3
+
+typedef struct {
+    Blockchain* chain;
+    FILE* out;
+    ChainExportOptions options;
+    uint64_t written;
+    int failed;
+} ExportCase;
+
+// The old path: one fprintf per hash byte and per transaction
+static void run_fprint(void* context) {
+    ExportCase* c = (ExportCase*)context;
+
+    for (size_t h = 0; h < get_block_count(c->chain); h++) fprint_block(c->out, get_block_by_index(c->chain, h));
+    fflush(c->out);
+}
+
+static void run_export(void* context) {
+    ExportCase* c = (ExportCase*)context;
+
+    if (!chainexport_write(c->chain, c->out, &c->options, &c->written)) c->failed = 1;
+    fflush(c->out);
+}
+
+int main(int argc, char** argv) {
+    BenchConfig config = bench_parse_args(argc, argv);
+    Blockchain* chain = bench_build_chain(BLOCKS, TRANSACTIONS_PER_BLOCK, ACCOUNTS);
+    FILE* out = fopen("/dev/null", "wb");
+    if (!chain || !out) return 1;
+
+    // The same bytes as the text export
+    uint64_t bytes = 0;
+    if (!chainexport_write(chain, out, NULL, &bytes)) return 1;
+
+    bench_header(&config);
+    // Thread counts above this cannot run in parallel
+    bench_value(&config, "cpus_online", 0, (double)sysconf(_SC_NPROCESSORS_ONLN), "cpus");
+    ExportCase baseline_case = { chain, out, { CHAINEXPORT_TEXT, 1, 0, 0 }, 0, 0 };
+    double baseline = bench_run(&config, "fprint_block", 1, REPS, run_fprint, &baseline_case, BLOCKS, (double)bytes);
+
+    const int thread_counts[] = { 1, 2, 4 };
+    for (int format = CHAINEXPORT_TEXT; format <= CHAINEXPORT_CSV; format++) {
+        const char* format_name = chainexport_format_name((ChainExportFormat)format);
+        char name[64];
+        for (size_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); t++) {
+            ExportCase c = { chain, out, { (ChainExportFormat)format, thread_counts[t], 0, 0 }, 0, 0 };
+
+            // Throughput needs the byte count, which a first run finds
+            run_export(&c);
+            snprintf(name, sizeof(name), "export_%s", format_name);
+            double elapsed = bench_run(&config, name, thread_counts[t], REPS, run_export, &c, BLOCKS,
+                                       (double)c.written);
+            if (c.failed) {
+                fprintf(stderr, "%s export failed\n", format_name);
+                return 1;
+            }
+            snprintf(name, sizeof(name), "export_%s_speedup", format_name);
+            bench_value(&config, name, thread_counts[t], baseline / elapsed, "x");
+        }
+    }
+
+    fclose(out);
+    free_blockchain(chain);
+    return 0;
+}
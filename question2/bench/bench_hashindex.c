@@ -0,0 +1,96 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "hashindex.h"
+
+// Lookup latency of the digest-keyed index at 10^4 to 10^7 entries, for
+// keys that are present (in random order) and keys that are not.
+
+static void random_key(uint64_t* state, uint8_t key[]) {
+    for (int i = 0; i < SHA256_DIGEST_SIZE; i += 8) {
+        uint64_t r = bench_splitmix64(state);
+        memcpy(key + i, &r, 8);
+    }
+}
+
+#define LOOKUPS 2000000
+
+typedef struct {
+    uint8_t (*keys)[SHA256_DIGEST_SIZE];
+    size_t n;
+    const size_t* order;
+    uint64_t seed;
+    uint64_t checksum;
+    size_t found_missing;
+    HashIndex index;
+} IndexCase;
+
+// A fresh index filled with n keys; the one free at the end is noise
+static void run_insert(void* context) {
+    IndexCase* c = (IndexCase*)context;
+    HashIndex index;
+
+    hash_index_init(&index);
+    for (size_t i = 0; i < c->n; i++)
+        hash_index_insert(&index, c->keys[i], i);
+    hash_index_free(&index);
+}
+
+static void run_hit(void* context) {
+    IndexCase* c = (IndexCase*)context;
+    uint64_t value;
+
+    for (size_t i = 0; i < LOOKUPS; i++) {
+        if (hash_index_find(&c->index, c->keys[c->order[i]], &value)) c->checksum += value;
+    }
+}
+
+static void run_miss(void* context) {
+    IndexCase* c = (IndexCase*)context;
+    uint8_t missing[SHA256_DIGEST_SIZE];
+
+    for (size_t i = 0; i < LOOKUPS; i++) {
+        random_key(&c->seed, missing);
+        c->found_missing += hash_index_find(&c->index, missing, NULL);
+    }
+}
+
+int main(int argc, char** argv) {
+    BenchConfig config = bench_parse_args(argc, argv);
+    const size_t sizes[] = { 10000, 100000, 1000000, 10000000 };
+    size_t max_n = sizes[sizeof(sizes) / sizeof(sizes[0]) - 1];
+    uint8_t (*keys)[SHA256_DIGEST_SIZE] = malloc(max_n * SHA256_DIGEST_SIZE);
+    size_t* order = (size_t*)malloc(LOOKUPS * sizeof(size_t));
+    if (!keys || !order) return 1;
+
+    uint64_t seed = 42;
+    for (size_t i = 0; i < max_n; i++) random_key(&seed, keys[i]);
+
+    bench_header(&config);
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        size_t n = sizes[s];
+        IndexCase c = { keys, n, order, seed, 0, 0, { 0 } };
+
+        // Filling ten million entries takes a while per run
+        int reps = n >= 10000000 ? 3 : 0;
+        bench_run(&config, "hash_index_insert", (long)n, reps, run_insert, &c, (double)n, 0);
+
+        hash_index_init(&c.index);
+        for (size_t i = 0; i < n; i++)
+            hash_index_insert(&c.index, keys[i], i);
+        for (size_t i = 0; i < LOOKUPS; i++) order[i] = bench_splitmix64(&seed) % n;
+
+        bench_run(&config, "hash_index_find_hit", (long)n, 0, run_hit, &c, LOOKUPS, 0);
+        bench_run(&config, "hash_index_find_miss", (long)n, 0, run_miss, &c, LOOKUPS, 0);
+        bench_value(&config, "hash_index_table", (long)n, c.index.capacity * sizeof(HashIndexEntry) / 1e6, "MB");
+        if (c.found_missing || c.checksum == 0) fprintf(stderr, "unexpected lookup results\n");
+
+        seed = c.seed;
+        hash_index_free(&c.index);
+    }
+
+    free(order);
+    free(keys);
+    return 0;
+}
@@ -0,0 +1,158 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "blockchain.h"
+
+// Ledger throughput: applying 1000-transaction blocks of random transfers
+// among 10^3 to 10^6 accounts, balance lookups, and for comparison the
+// balance scan over every transaction that the ledger replaces.
+
+static AccountId account(size_t i) {
+    char name[ACCOUNT_NAME_SIZE];
+    snprintf(name, sizeof(name), "account-%zu", i);
+    return account_intern(name);
+}
+
+static const char* format_name(size_t i, char name[]) {
+    snprintf(name, ACCOUNT_NAME_SIZE, "account-%zu", i);
+    return name;
+}
+
+#define BLOCK_TRANSACTIONS 1000
+#define BLOCKS 2000
+#define LOOKUPS 2000000
+
+// The balance the slow way: every transaction of every block
+static double scan_balance(const Blockchain* chain, const char* name) {
+    AccountId id = account_lookup(name);
+    double balance = 0;
+
+    for (size_t h = 0; h < chain->block_count; h++) {
+        const Block* block = chain->blocks[h];
+        for (int i = 0; i < block->transaction_count; i++) {
+            const Transaction* tx = &block->transactions[i];
+            if (tx->receiver == id) balance += tx->amount;
+            if (h > 0 && tx->sender == id) balance -= tx->amount;
+        }
+    }
+    return balance;
+}
+
+typedef struct {
+    Ledger ledger;
+    const Transaction* txs;
+    size_t rejected;
+    double total;
+} ApplyCase;
+
+// Every block once; transfers are small enough to repeat for every run
+static void run_apply(void* context) {
+    ApplyCase* c = (ApplyCase*)context;
+
+    for (size_t b = 0; b < BLOCKS; b++) {
+        const Transaction* block = &c->txs[b * BLOCK_TRANSACTIONS];
+        for (int i = 0; i < BLOCK_TRANSACTIONS; i++)
+            c->rejected += !ledger_transfer(&c->ledger, block[i].sender, block[i].receiver, block[i].amount);
+    }
+}
+
+static void run_balance(void* context) {
+    ApplyCase* c = (ApplyCase*)context;
+
+    for (size_t i = 0; i < LOOKUPS; i++)
+        c->total += ledger_balance(&c->ledger, c->txs[i % ((size_t)BLOCKS * BLOCK_TRANSACTIONS)].sender);
+}
+
+// The param is the number of accounts
+static void bench_apply(const BenchConfig* config) {
+    const size_t sizes[] = { 1000, 100000, 1000000 };
+    Transaction* txs = (Transaction*)calloc((size_t)BLOCKS * BLOCK_TRANSACTIONS, sizeof(Transaction));
+    if (!txs) return;
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        size_t n = sizes[s];
+        uint64_t seed = 42;
+        ApplyCase c = { { 0 }, txs, 0, 0 };
+        ledger_init(&c.ledger);
+
+        for (size_t i = 0; i < n; i++) ledger_mint(&c.ledger, account(i), 1e6);
+        for (size_t i = 0; i < (size_t)BLOCKS * BLOCK_TRANSACTIONS; i++) {
+            txs[i].sender = account(bench_splitmix64(&seed) % n);
+            txs[i].receiver = account(bench_splitmix64(&seed) % n);
+            txs[i].amount = 0.01;
+        }
+
+        bench_run(config, "ledger_transfer", (long)n, 0, run_apply, &c, (double)BLOCKS * BLOCK_TRANSACTIONS, 0);
+        bench_run(config, "ledger_balance", (long)n, 0, run_balance, &c, LOOKUPS, 0);
+        bench_value(config, "ledger_table", (long)n, c.ledger.capacity * sizeof(LedgerAccount) / 1e6, "MB");
+        if (c.rejected || c.total <= 0) fprintf(stderr, "unexpected ledger results\n");
+
+        ledger_free(&c.ledger);
+    }
+    free(txs);
+}
+
+typedef struct {
+    Blockchain* chain;
+    double balance;
+    double scanned;
+} QueryCase;
+
+static void run_get_account(void* context) {
+    QueryCase* c = (QueryCase*)context;
+
+    for (int i = 0; i < LOOKUPS; i++) get_account(c->chain, "account-1", &c->balance, NULL);
+}
+
+static void run_scan(void* context) {
+    QueryCase* c = (QueryCase*)context;
+
+    c->scanned = scan_balance(c->chain, "account-1");
+}
+
+// Same question through the chain: get_account against a full scan. The
+// param is the chain's length in blocks.
+static void bench_query(const BenchConfig* config) {
+    const size_t blocks = 10000;
+    const int per_block = 100;
+    Blockchain* chain = create_blockchain(0);
+    if (!chain) return;
+
+    char sender[ACCOUNT_NAME_SIZE], receiver[ACCOUNT_NAME_SIZE];
+    uint64_t seed = 7;
+    for (int i = 0; i < per_block; i++) add_transaction(chain->latest, "mint", format_name((size_t)i, receiver), 1e6);
+    for (size_t b = 1; b < blocks; b++) {
+        mine_block(chain->latest, 0, 1);
+        add_block(chain);
+        for (int i = 0; i < per_block; i++) {
+            format_name(bench_splitmix64(&seed) % per_block, sender);
+            format_name(bench_splitmix64(&seed) % per_block, receiver);
+            add_transaction(chain->latest, sender, receiver, 0.01);
+        }
+    }
+    mine_block(chain->latest, 0, 1);
+
+    // The first query catches the ledger up with the tip, once
+    QueryCase c = { chain, 0, 0 };
+    double catch_up = bench_now();
+    get_account(chain, "account-1", &c.balance, NULL);
+    catch_up = bench_now() - catch_up;
+    bench_report(config, "get_account_catch_up", (long)blocks, &catch_up, 1, 1, 0);
+
+    bench_run(config, "get_account", (long)blocks, 0, run_get_account, &c, LOOKUPS, 0);
+    bench_run(config, "scan_balance", (long)blocks, 0, run_scan, &c, 1, 0);
+    if (chain->ledger_first_invalid >= 0 || c.scanned < c.balance - 1e-3 || c.scanned > c.balance + 1e-3)
+        fprintf(stderr, "ledger and scan disagree\n");
+
+    free_blockchain(chain);
+}
+
+int main(int argc, char** argv) {
+    BenchConfig config = bench_parse_args(argc, argv);
+
+    bench_header(&config);
+    bench_apply(&config);
+    bench_query(&config);
+    return 0;
+}
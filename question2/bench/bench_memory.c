@@ -0,0 +1,64 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "blockchain.h"
+#include "chainfile.h"
+
+// Bytes per block with transactions sized to each block, against the
+// original layout that stored MAX_TRANSACTIONS (100) transactions inline,
+// with account names spelled out as version 1 chain files store them.
+
+typedef struct LegacyBlock {
+    uint32_t index;
+    time_t timestamp;
+    ChainFileNamedTransaction transactions[100];
+    int transaction_count;
+    uint8_t previous_hash[SHA256_DIGEST_SIZE];
+    uint64_t nonce;
+    uint8_t hash[SHA256_DIGEST_SIZE];
+    struct LegacyBlock* next;
+} LegacyBlock;
+
+// Heap bytes excluding allocator overhead, averaged over BLOCKS blocks;
+// the old layout had no room for more than 100 transactions
+#define BLOCKS 1000
+
+int main(int argc, char** argv) {
+    BenchConfig config = bench_parse_args(argc, argv);
+    const int tx_counts[] = { 0, 2, 10, 100, 1000 };
+    const int blocks = BLOCKS;
+
+    bench_header(&config);
+
+    for (size_t t = 0; t < sizeof(tx_counts) / sizeof(tx_counts[0]); t++) {
+        Blockchain* chain = create_blockchain(0);
+        if (!chain) return 1;
+
+        for (int b = 0; b < blocks; b++) {
+            add_block(chain);
+            for (int i = 0; i < tx_counts[t]; i++)
+                add_transaction(chain->latest, "alice", "bob", 1.0 + i);
+            calculate_block_hash(chain->latest);
+        }
+        // Seal the last block as well
+        add_block(chain);
+
+        size_t total = 0, count = 0;
+        for (Block* block = chain->genesis->next; block != chain->latest; block = block->next) {
+            total += block_memory_usage(block);
+            count++;
+        }
+
+        double after = (double)total / count;
+        bench_value(&config, "block_bytes", tx_counts[t], after, "B");
+        if (tx_counts[t] <= 100) {
+            double before = (double)sizeof(LegacyBlock);
+            bench_value(&config, "block_bytes_inline", tx_counts[t], before, "B");
+            bench_value(&config, "block_bytes_saving", tx_counts[t], before / after, "x");
+        }
+
+        free_blockchain(chain);
+    }
+    return 0;
+}
@@ -0,0 +1,198 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "bench.h"
+#include "blockchain.h"
+#include "mempool.h"
+#include "metrics.h"
+
+// Mempool ingest with 1 to 8 producer threads: first into a consumer that
+// only drains, which is the queue's own ceiling, then into the block
+// assembler filling 1000-transaction blocks by arrival and by fee. Last,
+// a check that the assembler runs one proof of work per block. Each run
+// starts the producers afresh; the param is their count.
+
+#define POOL_CAPACITY (1 << 16)
+#define SUBMITS_PER_PRODUCER 1000000
+#define ACCOUNTS 64
+#define MAX_PRODUCERS 8
+#define CHECK_DIFFICULTY 8
+#define CHECK_BLOCKS 50
+#define REPS 3
+
+typedef struct {
+    Mempool* pool;
+    int id;
+    size_t submits;
+    atomic_int* running;
+} Producer;
+
+static void* producer_main(void* arg) {
+    Producer* p = (Producer*)arg;
+    char names[ACCOUNTS][16];
+    for (int i = 0; i < ACCOUNTS; i++) snprintf(names[i], sizeof(names[i]), "account-%d", i);
+
+    for (size_t i = 0; i < p->submits; i++) {
+        const char* sender = names[(i + (size_t)p->id) % ACCOUNTS];
+        const char* receiver = names[(i * 7 + 3) % ACCOUNTS];
+        // A full pool means the consumer is behind; give it the CPU
+        while (!mempool_submit(p->pool, sender, receiver, 0.001, (double)(i % 100)))
+            sched_yield();
+    }
+    atomic_fetch_sub(p->running, 1);
+    return NULL;
+}
+
+static int start_producers(Mempool* pool, int count, pthread_t threads[], Producer producers[],
+                           atomic_int* running) {
+    atomic_store(running, count);
+    for (int i = 0; i < count; i++) {
+        producers[i] = (Producer){ pool, i, SUBMITS_PER_PRODUCER, running };
+        if (pthread_create(&threads[i], NULL, producer_main, &producers[i]) != 0) return 0;
+    }
+    return 1;
+}
+
+typedef struct {
+    int producers;
+    AssemblyOrder order;
+    uint64_t blocks;
+    uint64_t rejected;
+} IngestCase;
+
+static void run_drain(void* context) {
+    IngestCase* c = (IngestCase*)context;
+    Mempool* pool = mempool_create(POOL_CAPACITY);
+    MempoolEntry* batch = (MempoolEntry*)malloc(256 * sizeof(MempoolEntry));
+    pthread_t threads[MAX_PRODUCERS];
+    Producer producers[MAX_PRODUCERS];
+    atomic_int running;
+    if (!pool || !batch) return;
+
+    size_t total = (size_t)c->producers * SUBMITS_PER_PRODUCER, drained = 0;
+    if (!start_producers(pool, c->producers, threads, producers, &running)) return;
+    while (drained < total) {
+        size_t n = mempool_drain(pool, batch, 256);
+        if (n == 0) sched_yield();
+        drained += n;
+    }
+    for (int i = 0; i < c->producers; i++) pthread_join(threads[i], NULL);
+
+    free(batch);
+    mempool_free(pool);
+}
+
+static void run_assemble(void* context) {
+    IngestCase* c = (IngestCase*)context;
+    Mempool* pool = mempool_create(POOL_CAPACITY);
+    AssemblerOptions options = { c->order, 1000, 256 };
+    BlockAssembler* assembler = block_assembler_create(pool, &options);
+    Blockchain* chain = create_blockchain(0);
+    pthread_t threads[MAX_PRODUCERS];
+    Producer producers[MAX_PRODUCERS];
+    atomic_int running;
+    if (!pool || !assembler || !chain) return;
+
+    // Genesis mints every account enough for the whole run
+    char name[16];
+    for (int i = 0; i < ACCOUNTS; i++) {
+        snprintf(name, sizeof(name), "account-%d", i);
+        submit_transaction(chain, "mint", name, 1e9);
+    }
+    mine_block(chain->latest, 0, 1);
+    add_block(chain);
+
+    size_t total = (size_t)c->producers * SUBMITS_PER_PRODUCER;
+    if (!start_producers(pool, c->producers, threads, producers, &running)) return;
+    while (assembler->included + assembler->rejected < total) {
+        if (assemble_block(assembler, chain) == 0) sched_yield();
+    }
+    for (int i = 0; i < c->producers; i++) pthread_join(threads[i], NULL);
+    c->blocks = assembler->blocks;
+    c->rejected = assembler->rejected;
+
+    free_blockchain(chain);
+    block_assembler_free(assembler);
+    mempool_free(pool);
+}
+
+static void bench_assemble(const BenchConfig* config, int producers, AssemblyOrder order) {
+    const char* name = order == ASSEMBLE_BY_FEE ? "assemble_by_fee" : "assemble_by_arrival";
+    IngestCase c = { producers, order, 0, 0 };
+    double ops = (double)producers * SUBMITS_PER_PRODUCER;
+
+    double elapsed = bench_run(config, name, producers, REPS, run_assemble, &c, ops, 0);
+    char value_name[64];
+    snprintf(value_name, sizeof(value_name), "%s_blocks_per_s", name);
+    bench_value(config, value_name, producers, c.blocks / elapsed, "blocks/s");
+    snprintf(value_name, sizeof(value_name), "%s_rejected", name);
+    bench_value(config, value_name, producers, (double)c.rejected, "transactions");
+}
+
+// Below 12 bits mining stays on one thread and tries nonces from 0 up, so
+// a block mined once costs exactly its nonce + 1 tries. Anything above the
+// sum over the assembled blocks is proof of work spent twice. Each new tip
+// also gets one plain header hash from add_block.
+static int check_hashes_per_block(const BenchConfig* config) {
+    if (!metrics_enabled()) {
+        fprintf(stderr, "hashes per block: not counted, build with make METRICS=1\n");
+        return 1;
+    }
+
+    Mempool* pool = mempool_create(POOL_CAPACITY);
+    AssemblerOptions options = { ASSEMBLE_BY_ARRIVAL, 100, 100 };
+    BlockAssembler* assembler = block_assembler_create(pool, &options);
+    Blockchain* chain = create_blockchain(CHECK_DIFFICULTY);
+    if (!pool || !assembler || !chain) return 0;
+
+    submit_transaction(chain, "mint", "account-0", 1e9);
+    mine_tip(chain);
+    add_block(chain);
+
+    MetricsSnapshot before, after;
+    metrics_snapshot(&before);
+    uint64_t expected_tries = 0;
+    for (int b = 0; b < CHECK_BLOCKS; b++) {
+        for (size_t i = 0; i < options.block_capacity; i++)
+            mempool_submit(pool, "account-0", "account-1", 0.001, 1.0);
+
+        Block* tip = chain->latest;
+        if (assemble_block(assembler, chain) == 0) break;
+        expected_tries += tip->nonce + 1;
+    }
+    metrics_snapshot(&after);
+
+    uint64_t blocks = assembler->blocks;
+    uint64_t tries = after.counters[METRIC_NONCES_TRIED] - before.counters[METRIC_NONCES_TRIED];
+    uint64_t hashes = after.counters[METRIC_BLOCK_HASHES] - before.counters[METRIC_BLOCK_HASHES];
+    int ok = blocks == CHECK_BLOCKS && tries == expected_tries && hashes == blocks;
+    bench_value(config, "assembler_header_hashes_per_block", CHECK_DIFFICULTY,
+                blocks ? (double)(tries + hashes) / blocks : 0.0, "hashes");
+    if (!ok)
+        fprintf(stderr, "hashes per block: %llu tries for %llu expected, %llu plain hashes for %llu blocks\n",
+                (unsigned long long)tries, (unsigned long long)expected_tries, (unsigned long long)hashes,
+                (unsigned long long)blocks);
+
+    free_blockchain(chain);
+    block_assembler_free(assembler);
+    mempool_free(pool);
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    BenchConfig config = bench_parse_args(argc, argv);
+    const int counts[] = { 1, 2, 4, 8 };
+    const size_t n = sizeof(counts) / sizeof(counts[0]);
+
+    bench_header(&config);
+    for (size_t i = 0; i < n; i++) {
+        IngestCase c = { counts[i], ASSEMBLE_BY_ARRIVAL, 0, 0 };
+        bench_run(&config, "drain", counts[i], REPS, run_drain, &c, (double)counts[i] * SUBMITS_PER_PRODUCER, 0);
+    }
+    for (size_t i = 0; i < n; i++) bench_assemble(&config, counts[i], ASSEMBLE_BY_ARRIVAL);
+    for (size_t i = 0; i < n; i++) bench_assemble(&config, counts[i], ASSEMBLE_BY_FEE);
+    return check_hashes_per_block(&config) ? 0 : 1;
+}
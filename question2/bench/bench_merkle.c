@@ -0,0 +1,83 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "bench.h"
+#include "blockchain.h"
+
+// Cost of committing to one more transaction: an incremental Merkle append
+// versus re-hashing every transaction in the block, which is what
+// calculate_block_hash used to do after each add_transaction.
+
+static void full_rehash(const Transaction* txs, size_t n, uint8_t hash[]) {
+    SHA256_CTX ctx;
+    sha256_init(&ctx);
+    for (size_t i = 0; i < n; i++) {
+        size_t len;
+        const char* name = account_name(txs[i].sender, &len);
+        sha256_update(&ctx, (const uint8_t*)name, len);
+        name = account_name(txs[i].receiver, &len);
+        sha256_update(&ctx, (const uint8_t*)name, len);
+        sha256_update(&ctx, (const uint8_t*)&txs[i].amount, sizeof(txs[i].amount));
+        sha256_update(&ctx, (const uint8_t*)&txs[i].timestamp, sizeof(txs[i].timestamp));
+    }
+    sha256_final(&ctx, hash);
+}
+
+typedef struct {
+    const Transaction* txs;
+    size_t n;
+} CommitCase;
+
+// Incremental: the whole tree built leaf by leaf, so ns/op is per append
+static void run_merkle(void* context) {
+    CommitCase* c = (CommitCase*)context;
+    uint8_t leaf[SHA256_DIGEST_SIZE];
+    MerkleTree tree;
+
+    merkle_init(&tree);
+    for (size_t i = 0; i < c->n; i++) {
+        transaction_leaf_hash(&c->txs[i], leaf);
+        merkle_append(&tree, leaf);
+    }
+    merkle_free(&tree);
+}
+
+// Full rehash: one pass over all n transactions per append
+static void run_rehash(void* context) {
+    CommitCase* c = (CommitCase*)context;
+    uint8_t hash[SHA256_DIGEST_SIZE];
+
+    full_rehash(c->txs, c->n, hash);
+}
+
+int main(int argc, char** argv) {
+    BenchConfig config = bench_parse_args(argc, argv);
+    const size_t sizes[] = { 100, 10000, 1000000 };
+    size_t max_n = sizes[sizeof(sizes) / sizeof(sizes[0]) - 1];
+    Transaction* txs = (Transaction*)malloc(max_n * sizeof(Transaction));
+    if (!txs) return 1;
+
+    char name[ACCOUNT_NAME_SIZE];
+    for (size_t i = 0; i < max_n; i++) {
+        snprintf(name, sizeof(name), "account-%zu", i % 5000);
+        txs[i].sender = account_intern(name);
+        snprintf(name, sizeof(name), "account-%zu", (i * 7 + 1) % 5000);
+        txs[i].receiver = account_intern(name);
+        txs[i].amount = 1.0 + (double)(i % 1000) / 100.0;
+        txs[i].timestamp = (time_t)(1700000000 + i);
+    }
+
+    bench_header(&config);
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        CommitCase c = { txs, sizes[s] };
+        // A million-leaf tree takes a good fraction of a second per run
+        int reps = sizes[s] >= 1000000 ? 3 : 0;
+        double merkle = bench_run(&config, "merkle_append", (long)c.n, reps, run_merkle, &c, (double)c.n, 0);
+        double rehash = bench_run(&config, "full_rehash", (long)c.n, 0, run_rehash, &c, 1, 0);
+        bench_value(&config, "merkle_append_speedup", (long)c.n, rehash / (merkle / c.n), "x");
+    }
+
+    free(txs);
+    return 0;
+}
@@ -0,0 +1,157 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "bench.h"
+#include "blockchain.h"
+
+// Readers against a writer appending at full speed. Each reader takes
+// snapshots in a loop: looks a random block up by height and by hash and
+// verifies it, and every WALK_INTERVAL snapshots walks the whole chain from
+// genesis checking each link. Any inconsistency is counted as an error.
+// Only the writer's appends are timed; the param is the reader count.
+
+#define APPENDS 200000
+#define WALK_INTERVAL 16384
+#define MAX_READERS 8
+#define REPS 3
+
+typedef struct {
+    Blockchain* chain;
+    atomic_int* writing;
+    uint64_t seed;
+    uint64_t lookups;
+    uint64_t walked;
+    uint64_t errors;
+} Reader;
+
+// Follows next from genesis to the snapshot's tip; every block must link
+// to the one before it and sit at its own height
+static int walk_snapshot(const ChainSnapshot* snapshot, uint64_t* walked) {
+    const Block* previous = NULL;
+    size_t height = 0;
+
+    for (const Block* block = snapshot_block(snapshot, 0); block; block = snapshot_next(snapshot, block)) {
+        if (block != snapshot_block(snapshot, height)) return 0;
+        if (previous && memcmp(block->previous_hash, previous->hash, SHA256_DIGEST_SIZE) != 0) return 0;
+        previous = block;
+        height++;
+    }
+    *walked += height;
+    return height == snapshot->count;
+}
+
+static void* reader_main(void* arg) {
+    Reader* r = (Reader*)arg;
+    int slot = register_reader(r->chain);
+    if (slot < 0) {
+        r->errors++;
+        return NULL;
+    }
+
+    ChainSnapshot snapshot;
+    size_t last_count = 0;
+    for (uint64_t i = 0; atomic_load_explicit(r->writing, memory_order_relaxed); i++) {
+        size_t count = read_snapshot(r->chain, slot, &snapshot);
+        // Snapshots only ever move forward
+        if (count < last_count) r->errors++;
+        last_count = count;
+
+        if (count > 0) {
+            size_t height = (size_t)(bench_splitmix64(&r->seed) % count);
+            Block* block = snapshot_block(&snapshot, height);
+            Block* previous = height > 0 ? snapshot_block(&snapshot, height - 1) : NULL;
+            if (snapshot_find_block(&snapshot, block->hash) != block ||
+                !verify_block(block, previous ? previous->hash : NULL, r->chain->difficulty))
+                r->errors++;
+            r->lookups++;
+
+            if (i % WALK_INTERVAL == 0 && !walk_snapshot(&snapshot, &r->walked)) r->errors++;
+        }
+        release_snapshot(&snapshot);
+    }
+
+    unregister_reader(r->chain, slot);
+    return NULL;
+}
+
+typedef struct {
+    double elapsed;
+    uint64_t lookups;
+    uint64_t walked;
+    uint64_t errors;
+} ReadersRun;
+
+static void run(int readers_count, ReadersRun* result) {
+    Blockchain* chain = create_blockchain(0);
+    pthread_t threads[MAX_READERS];
+    Reader readers[MAX_READERS];
+    atomic_int writing;
+    if (!chain) return;
+
+    atomic_init(&writing, 1);
+    int started = 0;
+    for (; started < readers_count; started++) {
+        readers[started] = (Reader){ chain, &writing, (uint64_t)started + 1, 0, 0, 0 };
+        if (pthread_create(&threads[started], NULL, reader_main, &readers[started]) != 0) break;
+    }
+
+    // The writer runs on this thread
+    double start = bench_now();
+    for (int i = 0; i < APPENDS; i++) {
+        add_transaction(chain->latest, "writer", "reader", 1.0);
+        mine_block(chain->latest, chain->difficulty, 1);
+        add_block(chain);
+    }
+    result->elapsed = bench_now() - start;
+    atomic_store(&writing, 0);
+
+    result->lookups = result->walked = 0;
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+        result->lookups += readers[i].lookups;
+        result->walked += readers[i].walked;
+        result->errors += readers[i].errors;
+    }
+    if (started < readers_count) result->errors++;
+
+    // Once the writer is done, one last snapshot must hold a valid chain
+    int slot = register_reader(chain);
+    ChainSnapshot snapshot;
+    read_snapshot(chain, slot, &snapshot);
+    if (snapshot.count != (size_t)APPENDS || !validate_snapshot(&snapshot)) result->errors++;
+    release_snapshot(&snapshot);
+    unregister_reader(chain, slot);
+
+    free_blockchain(chain);
+}
+
+int main(int argc, char** argv) {
+    BenchConfig config = bench_parse_args(argc, argv);
+    const int counts[] = { 0, 1, 2, 4, 8 };
+    double samples[BENCH_MAX_REPS];
+
+    bench_header(&config);
+    for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+        // Reader throughput is only known per run, so the runs are made here
+        int reps = config.reps < REPS ? config.reps : REPS;
+        int warmup = config.warmup < 1 ? config.warmup : 1;
+        ReadersRun result = { 0, 0, 0, 0 };
+        double lookups = 0, walked = 0, writing = 0;
+        for (int r = 0; r < warmup + reps; r++) {
+            run(counts[i], &result);
+            if (r < warmup) continue;
+            samples[r - warmup] = result.elapsed;
+            lookups += (double)result.lookups;
+            walked += (double)result.walked;
+            writing += result.elapsed;
+        }
+
+        bench_report(&config, "append_with_readers", counts[i], samples, reps, APPENDS, 0);
+        bench_value(&config, "reader_lookups_per_s", counts[i], lookups / writing, "lookups/s");
+        bench_value(&config, "reader_blocks_walked_per_s", counts[i], walked / writing, "blocks/s");
+        bench_value(&config, "reader_errors", counts[i], (double)result.errors, "errors");
+    }
+    return 0;
+}
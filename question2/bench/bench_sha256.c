@@ -0,0 +1,75 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "sha256.h"
+
+// Compares sha256_update against the original byte-at-a-time buffering
+// loop, which is reproduced here on top of sha256_transform. Each run
+// hashes about TOTAL_BYTES, split into messages of the size under test.
+
+#define TOTAL_BYTES (4 << 20)
+
+static void update_bytewise(SHA256_CTX *ctx, const uint8_t data[], size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+        ctx->data[ctx->datalen] = data[i];
+        ctx->datalen++;
+        if (ctx->datalen == 64) {
+            sha256_transform(ctx, ctx->data);
+            ctx->bitlen += 512;
+            ctx->datalen = 0;
+        }
+    }
+}
+
+typedef struct {
+    const uint8_t *buf;
+    size_t len;
+    size_t iterations;
+    int bytewise;
+} HashCase;
+
+static void run_hash(void *context) {
+    HashCase *c = (HashCase *)context;
+    uint8_t hash[SHA256_DIGEST_SIZE];
+
+    for (size_t i = 0; i < c->iterations; i++) {
+        SHA256_CTX ctx;
+        sha256_init(&ctx);
+        if (c->bytewise)
+            update_bytewise(&ctx, c->buf, c->len);
+        else
+            sha256_update(&ctx, c->buf, c->len);
+        sha256_final(&ctx, hash);
+    }
+}
+
+int main(int argc, char **argv) {
+    BenchConfig config = bench_parse_args(argc, argv);
+    const size_t sizes[] = { 32, 1024, 1024 * 1024 };
+    size_t max_len = sizes[sizeof(sizes) / sizeof(sizes[0]) - 1];
+    uint8_t *buf = malloc(max_len);
+    if (!buf) return 1;
+
+    for (size_t i = 0; i < max_len; i++) buf[i] = (uint8_t)(i * 131 + 7);
+
+    // Both loops compress through the selected backend, named in the case
+    const char *backend = sha256_backend_name(sha256_get_backend());
+    char bytewise_name[64], bulk_name[64], speedup_name[64];
+    snprintf(bytewise_name, sizeof(bytewise_name), "sha256_update_bytewise/%s", backend);
+    snprintf(bulk_name, sizeof(bulk_name), "sha256_update/%s", backend);
+    snprintf(speedup_name, sizeof(speedup_name), "sha256_update_speedup/%s", backend);
+
+    bench_header(&config);
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        HashCase c = { buf, sizes[i], TOTAL_BYTES / sizes[i], 1 };
+        double ops = (double)c.iterations, bytes = (double)(c.iterations * c.len);
+        double before = bench_run(&config, bytewise_name, (long)sizes[i], 0, run_hash, &c, ops, bytes);
+        c.bytewise = 0;
+        double after = bench_run(&config, bulk_name, (long)sizes[i], 0, run_hash, &c, ops, bytes);
+        bench_value(&config, speedup_name, (long)sizes[i], before / after, "x");
+    }
+
+    free(buf);
+    return 0;
+}
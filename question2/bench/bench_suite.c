@@ -0,0 +1,185 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "bench.h"
+#include "blockchain.h"
+#include "chainvalidate.h"
+
+// Regression suite: raw SHA-256 throughput, block hashing and verification
+// by transaction count, add_block, validation at 10^3 to 10^6 blocks and
+// save/load throughput. Pass --json for JSON lines instead of CSV.
+
+#define SUITE_FILE "bench_suite.dat"
+#define ACCOUNTS 1000
+
+typedef struct {
+    const uint8_t* data;
+    size_t size;
+    size_t iterations;
+} HashCase;
+
+static void run_sha256(void* context) {
+    HashCase* c = (HashCase*)context;
+    uint8_t hash[SHA256_DIGEST_SIZE];
+
+    for (size_t i = 0; i < c->iterations; i++)
+        sha256(c->data, c->size, hash);
+}
+
+typedef struct {
+    Block* block;
+    size_t iterations;
+} BlockCase;
+
+static void run_calculate_block_hash(void* context) {
+    BlockCase* c = (BlockCase*)context;
+
+    for (size_t i = 0; i < c->iterations; i++) {
+        c->block->nonce = i;
+        calculate_block_hash(c->block);
+    }
+}
+
+// Full check of one block: Merkle root from every transaction, then the header
+static void run_verify_block(void* context) {
+    BlockCase* c = (BlockCase*)context;
+
+    for (size_t i = 0; i < c->iterations; i++)
+        verify_block(c->block, NULL, 0);
+}
+
+typedef struct {
+    Blockchain* chain;
+    size_t blocks;
+} ChainCase;
+
+static void run_add_block(void* context) {
+    ChainCase* c = (ChainCase*)context;
+
+    for (size_t i = 0; i < c->blocks; i++) {
+        mine_tip(c->chain);
+        add_block(c->chain);
+    }
+}
+
+static void run_validate_chain(void* context) {
+    ChainCase* c = (ChainCase*)context;
+
+    if (!validate_chain(c->chain)) fprintf(stderr, "validate_chain failed\n");
+}
+
+static void run_validate_chain_parallel(void* context) {
+    ChainCase* c = (ChainCase*)context;
+    ValidationOptions options = { (int)sysconf(_SC_NPROCESSORS_ONLN), 0, 0 };
+
+    if (!validate_chain_parallel(c->chain, &options, NULL)) fprintf(stderr, "validate_chain_parallel failed\n");
+}
+
+static void run_save(void* context) {
+    ChainCase* c = (ChainCase*)context;
+
+    if (!save_blockchain(c->chain, SUITE_FILE)) fprintf(stderr, "save_blockchain failed\n");
+}
+
+static void run_load(void* context) {
+    (void)context;
+    Blockchain* chain = load_blockchain(SUITE_FILE);
+
+    if (!chain) fprintf(stderr, "load_blockchain failed\n");
+    free_blockchain(chain);
+}
+
+static void run_validate_file(void* context) {
+    (void)context;
+
+    if (!validate_chain_file(SUITE_FILE, NULL, NULL)) fprintf(stderr, "validate_chain_file failed\n");
+}
+
+static void bench_hashing(const BenchConfig* config) {
+    const size_t sizes[] = { 64, 1024, 65536, 1 << 20 };
+    const size_t total = 16 << 20;
+    uint8_t* data = (uint8_t*)malloc(sizes[3]);
+    if (!data) return;
+    for (size_t i = 0; i < sizes[3]; i++) data[i] = (uint8_t)(i * 31);
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        HashCase c = { data, sizes[s], total / sizes[s] };
+        bench_run(config, "sha256", (long)sizes[s], 0, run_sha256, &c, (double)c.iterations,
+                  (double)(c.iterations * c.size));
+    }
+    free(data);
+}
+
+static void bench_blocks(const BenchConfig* config) {
+    const int counts[] = { 1, 10, 100, 1000 };
+
+    for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+        Blockchain* chain = bench_build_chain(1, counts[i], ACCOUNTS);
+        if (!chain) return;
+
+        BlockCase c = { chain->genesis, 100000 };
+        bench_run(config, "calculate_block_hash", counts[i], 0, run_calculate_block_hash, &c,
+                  (double)c.iterations, 0);
+
+        mine_block(chain->genesis, 0, 1);
+        c.iterations = 100000 / (size_t)counts[i];
+        bench_run(config, "verify_block", counts[i], 0, run_verify_block, &c, (double)c.iterations, 0);
+        free_blockchain(chain);
+    }
+}
+
+static void bench_add_block(const BenchConfig* config) {
+    const int difficulties[] = { 0, 8 };
+
+    for (size_t i = 0; i < sizeof(difficulties) / sizeof(difficulties[0]); i++) {
+        ChainCase c = { create_blockchain(difficulties[i]), difficulties[i] ? 1000 : 10000 };
+        if (!c.chain) return;
+
+        bench_run(config, "add_block", difficulties[i], 0, run_add_block, &c, (double)c.blocks, 0);
+        free_blockchain(c.chain);
+    }
+}
+
+static void bench_validation(const BenchConfig* config) {
+    for (long n = 1000; n <= config->max_blocks; n *= 10) {
+        ChainCase c = { bench_build_chain((size_t)n, 2, ACCOUNTS), (size_t)n };
+        if (!c.chain) return;
+
+        // Large chains take seconds per run, so they get fewer repetitions
+        int reps = n >= 1000000 ? 3 : 0;
+        bench_run(config, "validate_chain", n, reps, run_validate_chain, &c, (double)n, 0);
+        bench_run(config, "validate_chain_parallel", n, reps, run_validate_chain_parallel, &c, (double)n, 0);
+        free_blockchain(c.chain);
+    }
+}
+
+static void bench_persistence(const BenchConfig* config) {
+    long n = config->max_blocks < 100000 ? config->max_blocks : 100000;
+    ChainCase c = { bench_build_chain((size_t)n, 4, ACCOUNTS), (size_t)n };
+    if (!c.chain) return;
+
+    run_save(&c);
+    struct stat st;
+    double bytes = stat(SUITE_FILE, &st) == 0 ? (double)st.st_size : 0;
+
+    bench_run(config, "save_blockchain", n, 0, run_save, &c, (double)n, bytes);
+    bench_run(config, "load_blockchain", n, 0, run_load, &c, (double)n, bytes);
+    bench_run(config, "validate_chain_file", n, 0, run_validate_file, &c, (double)n, bytes);
+
+    free_blockchain(c.chain);
+    unlink(SUITE_FILE);
+}
+
+int main(int argc, char** argv) {
+    BenchConfig config = bench_parse_args(argc, argv);
+
+    bench_header(&config);
+    bench_hashing(&config);
+    bench_blocks(&config);
+    bench_add_block(&config);
+    bench_validation(&config);
+    bench_persistence(&config);
+    return 0;
+}
@@ -0,0 +1,170 @@
+#include "accounts.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define CHUNK_BITS 12
+#define CHUNK_SIZE ((size_t)1 << CHUNK_BITS)
+#define MAX_CHUNKS ((size_t)1 << 16)  // room for 2^28 names
+#define MIN_TABLE_CAPACITY 1024
+
+// Names by ID, CHUNK_SIZE at a time; NUL-terminated, with their lengths
+typedef struct {
+    char names[CHUNK_SIZE][ACCOUNT_NAME_SIZE];
+    uint8_t lengths[CHUNK_SIZE];
+} NameChunk;
+
+// Open-addressing name -> ID table. A slot holds the name's hash in its
+// high half and ID + 1 in its low half, 0 when free. Once replaced by a
+// larger table it is never written again.
+typedef struct NameTable {
+    struct NameTable* replaced;  // the table before this one
+    size_t capacity;
+    _Atomic uint64_t slots[];
+} NameTable;
+
+static _Atomic(NameChunk*) chunks[MAX_CHUNKS];
+static _Atomic(NameTable*) table;
+static atomic_size_t name_count;
+static pthread_mutex_t insert_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// FNV-1a over the name's bytes
+static uint32_t name_hash(const char* name, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (uint8_t)name[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// The name's ID if t holds it; otherwise ACCOUNT_NONE, with the free slot
+// where it would go in *free_slot
+static AccountId probe(const NameTable* t, const char* name, size_t len, uint32_t hash, size_t* free_slot) {
+    size_t mask = t->capacity - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        uint64_t slot = atomic_load_explicit(&t->slots[i], memory_order_acquire);
+        if (slot == 0) {
+            if (free_slot) *free_slot = i;
+            return ACCOUNT_NONE;
+        }
+        if ((uint32_t)(slot >> 32) != hash) continue;
+
+        // The slot was published after the name was written
+        AccountId id = (AccountId)slot - 1;
+        const NameChunk* chunk = atomic_load_explicit(&chunks[id >> CHUNK_BITS], memory_order_relaxed);
+        size_t k = id & (CHUNK_SIZE - 1);
+        if (chunk->lengths[k] == len && memcmp(chunk->names[k], name, len) == 0) return id;
+    }
+}
+
+// A miss in a table that has since been replaced proves nothing, so retry
+// until the table stays the same across the probe
+static AccountId find(const char* name, size_t len, uint32_t hash) {
+    NameTable* t = atomic_load_explicit(&table, memory_order_acquire);
+    while (t) {
+        AccountId id = probe(t, name, len, hash, NULL);
+        if (id != ACCOUNT_NONE) return id;
+
+        NameTable* current = atomic_load_explicit(&table, memory_order_acquire);
+        if (current == t) break;
+        t = current;
+    }
+    return ACCOUNT_NONE;
+}
+
+// Builds a table twice the size holding every entry of t and publishes it
+static NameTable* grow_table(NameTable* t) {
+    size_t capacity = t ? t->capacity * 2 : MIN_TABLE_CAPACITY;
+    NameTable* grown = (NameTable*)calloc(1, sizeof(NameTable) + capacity * sizeof(uint64_t));
+    if (!grown) return NULL;
+
+    grown->replaced = t;
+    grown->capacity = capacity;
+    for (size_t i = 0; t && i < t->capacity; i++) {
+        uint64_t slot = atomic_load_explicit(&t->slots[i], memory_order_relaxed);
+        if (slot == 0) continue;
+
+        size_t j = (size_t)(slot >> 32) & (capacity - 1);
+        while (atomic_load_explicit(&grown->slots[j], memory_order_relaxed) != 0) j = (j + 1) & (capacity - 1);
+        atomic_store_explicit(&grown->slots[j], slot, memory_order_relaxed);
+    }
+
+    atomic_store_explicit(&table, grown, memory_order_release);
+    return grown;
+}
+
+// Called with insert_lock held
+static AccountId insert_locked(const char* name, size_t len, uint32_t hash) {
+    NameTable* t = atomic_load_explicit(&table, memory_order_relaxed);
+    size_t count = atomic_load_explicit(&name_count, memory_order_relaxed);
+    size_t free_slot = 0;
+
+    if (t) {
+        AccountId id = probe(t, name, len, hash, &free_slot);
+        if (id != ACCOUNT_NONE) return id;
+    }
+    if (count >= MAX_CHUNKS * CHUNK_SIZE) return ACCOUNT_NONE;
+    if (!t || count + 1 > t->capacity / 4 * 3) {
+        t = grow_table(t);
+        if (!t) return ACCOUNT_NONE;
+        probe(t, name, len, hash, &free_slot);
+    }
+
+    NameChunk* chunk = atomic_load_explicit(&chunks[count >> CHUNK_BITS], memory_order_relaxed);
+    if (!chunk) {
+        chunk = (NameChunk*)malloc(sizeof(NameChunk));
+        if (!chunk) return ACCOUNT_NONE;
+        atomic_store_explicit(&chunks[count >> CHUNK_BITS], chunk, memory_order_release);
+    }
+
+    size_t k = count & (CHUNK_SIZE - 1);
+    memcpy(chunk->names[k], name, len);
+    chunk->names[k][len] = '\0';
+    chunk->lengths[k] = (uint8_t)len;
+
+    // Count first, so whoever finds the slot can also resolve the ID
+    AccountId id = (AccountId)count;
+    atomic_store_explicit(&name_count, count + 1, memory_order_release);
+    atomic_store_explicit(&t->slots[free_slot], ((uint64_t)hash << 32) | (id + 1), memory_order_release);
+    return id;
+}
+
+// The name's ID, adding it if it is new; ACCOUNT_NONE if there is no
+// memory or no ID left for it
+AccountId account_intern(const char* name) {
+    if (!name) return ACCOUNT_NONE;
+
+    size_t len = strnlen(name, ACCOUNT_NAME_MAX);
+    uint32_t hash = name_hash(name, len);
+    AccountId id = find(name, len, hash);
+    if (id != ACCOUNT_NONE) return id;
+
+    pthread_mutex_lock(&insert_lock);
+    id = insert_locked(name, len, hash);
+    pthread_mutex_unlock(&insert_lock);
+    return id;
+}
+
+// The name's ID, or ACCOUNT_NONE if it was never interned
+AccountId account_lookup(const char* name) {
+    if (!name) return ACCOUNT_NONE;
+
+    size_t len = strnlen(name, ACCOUNT_NAME_MAX);
+    return find(name, len, name_hash(name, len));
+}
+
+// The name behind an ID, or NULL if no name has that ID
+const char* account_name(AccountId id, size_t* length) {
+    if ((size_t)id >= atomic_load_explicit(&name_count, memory_order_acquire)) return NULL;
+
+    const NameChunk* chunk = atomic_load_explicit(&chunks[id >> CHUNK_BITS], memory_order_relaxed);
+    size_t k = id & (CHUNK_SIZE - 1);
+    if (length) *length = chunk->lengths[k];
+    return chunk->names[k];
+}
+
+size_t account_count(void) {
+    return atomic_load_explicit(&name_count, memory_order_acquire);
+}
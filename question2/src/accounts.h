@@ -0,0 +1,29 @@
+#ifndef ACCOUNTS_H
+#define ACCOUNTS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Process-wide table of account names. Each distinct name is stored once
+// and numbered in order of first use; transactions and ledgers carry the
+// 32-bit IDs, and names are looked up only to print or hash them. IDs are
+// never reused, so an ID stays valid for the life of the process.
+//
+// Any thread may intern, look up or resolve at any time. Resolving an ID
+// and finding a name already in the table take no lock: names live in
+// chunks that never move, and the name -> ID table is replaced rather than
+// rehashed in place, with the tables it replaced kept until exit. Only
+// adding a new name takes a mutex.
+#define ACCOUNT_NAME_SIZE 64
+#define ACCOUNT_NAME_MAX (ACCOUNT_NAME_SIZE - 1)  // longer names are truncated
+#define ACCOUNT_NONE UINT32_MAX
+
+typedef uint32_t AccountId;
+
+// Function declarations
+AccountId account_intern(const char* name);
+AccountId account_lookup(const char* name);
+const char* account_name(AccountId id, size_t* length);
+size_t account_count(void);
+
+#endif // ACCOUNTS_H
@@ -0,0 +1,84 @@
+#include "arena.h"
+#include <stdlib.h>
+#include <stdalign.h>
+
+void arena_init(Arena* arena, size_t object_size) {
+    // Keep every object in a chunk suitably aligned
+    size_t align = alignof(max_align_t);
+    arena->object_size = (object_size + align - 1) / align * align;
+    arena->next_chunk_objects = ARENA_MIN_CHUNK_OBJECTS;
+    arena->head = NULL;
+    arena->tail = NULL;
+}
+
+static ArenaChunk* add_chunk(Arena* arena, size_t objects) {
+    ArenaChunk* chunk = (ArenaChunk*)malloc(sizeof(ArenaChunk) + objects * arena->object_size);
+    if (!chunk) return NULL;
+
+    chunk->next = NULL;
+    chunk->capacity = objects;
+    chunk->used = 0;
+    if (arena->tail)
+        arena->tail->next = chunk;
+    else
+        arena->head = chunk;
+    arena->tail = chunk;
+    return chunk;
+}
+
+// Makes sure the next `objects` allocations come from one chunk.
+// Untouched chunk pages are not committed until they are used, so
+// over-estimating costs address space rather than memory.
+int arena_reserve(Arena* arena, size_t objects) {
+    if (!arena) return 0;
+    if (arena->tail && arena->tail->capacity - arena->tail->used >= objects) return 1;
+
+    return add_chunk(arena, objects) != NULL;
+}
+
+void* arena_alloc(Arena* arena) {
+    if (!arena) return NULL;
+
+    ArenaChunk* chunk = arena->tail;
+    if (!chunk || chunk->used == chunk->capacity) {
+        // Chunks double up to a cap so short chains stay small
+        chunk = add_chunk(arena, arena->next_chunk_objects);
+        if (!chunk) return NULL;
+        if (arena->next_chunk_objects < ARENA_MAX_CHUNK_OBJECTS)
+            arena->next_chunk_objects *= 2;
+    }
+
+    return chunk->data + chunk->used++ * arena->object_size;
+}
+
+// Visits every allocated object in allocation order
+void arena_for_each(Arena* arena, void (*fn)(void* object)) {
+    if (!arena || !fn) return;
+
+    for (ArenaChunk* chunk = arena->head; chunk; chunk = chunk->next) {
+        for (size_t i = 0; i < chunk->used; i++)
+            fn(chunk->data + i * arena->object_size);
+    }
+}
+
+size_t arena_count(const Arena* arena) {
+    size_t count = 0;
+
+    for (ArenaChunk* chunk = arena ? arena->head : NULL; chunk; chunk = chunk->next)
+        count += chunk->used;
+    return count;
+}
+
+void arena_free(Arena* arena) {
+    if (!arena) return;
+
+    ArenaChunk* chunk = arena->head;
+    while (chunk) {
+        ArenaChunk* next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    arena->head = NULL;
+    arena->tail = NULL;
+    arena->next_chunk_objects = ARENA_MIN_CHUNK_OBJECTS;
+}
@@ -0,0 +1,33 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// Slab allocator for fixed-size objects. Objects are handed out from large
+// contiguous chunks and are only ever released all at once.
+typedef struct ArenaChunk {
+    struct ArenaChunk* next;
+    size_t capacity;  // objects the chunk can hold
+    size_t used;      // objects handed out so far
+    _Alignas(max_align_t) unsigned char data[];
+} ArenaChunk;
+
+typedef struct {
+    size_t object_size;
+    size_t next_chunk_objects;  // size of the next chunk to allocate
+    ArenaChunk* head;
+    ArenaChunk* tail;
+} Arena;
+
+#define ARENA_MIN_CHUNK_OBJECTS 64
+#define ARENA_MAX_CHUNK_OBJECTS 65536
+
+// Function declarations
+void arena_init(Arena* arena, size_t object_size);
+int arena_reserve(Arena* arena, size_t objects);
+void* arena_alloc(Arena* arena);
+void arena_for_each(Arena* arena, void (*fn)(void* object));
+size_t arena_count(const Arena* arena);
+void arena_free(Arena* arena);
+
+#endif // ARENA_H
@@ -1,17 +1,121 @@
 #include "blockchain.h"
+#include "chainfile.h"
+#include "chainlog.h"
+#include "chainwriter.h"
+#include "chainpack.h"
+#include "txcolumns.h"
+#include "chainexport.h"
+#include "encoding.h"
+#include "metrics.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
+#include <float.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
 
-Blockchain* create_blockchain(int difficulty) {
-    if (difficulty < 0) return NULL;
+static void init_block(Block* block) {
+    block->index = 0;
+    block->timestamp = time(NULL);
+    block->transactions = NULL;
+    block->transaction_count = 0;
+    block->transaction_capacity = 0;
+    merkle_init(&block->tx_tree);
+    memset(block->previous_hash, 0, SHA256_DIGEST_SIZE);
+    block->nonce = 0;
+    block->next = NULL;
+}
+
+// Blocks that belong to a chain come from its arena; the caller mines or
+// fills in the hash
+static Block* alloc_chain_block(Blockchain* chain) {
+    Block* block = (Block*)arena_alloc(&chain->block_arena);
+    if (!block) return NULL;
+
+    init_block(block);
+    return block;
+}
+
+// The published view may still point at an old table; publish_sealed
+// retires it along with the view once a new view replaces it
+static int published_table(const Blockchain* chain, const void* table) {
+    const ChainView* view = atomic_load_explicit(&chain->view, memory_order_relaxed);
+    return view && (view->blocks == table || view->block_hash_index.entries == table);
+}
+
+static void release_hash_entries(void* context, HashIndexEntry* entries) {
+    if (!published_table((Blockchain*)context, entries)) free(entries);
+}
+
+// Grows by copying rather than realloc, as readers may be using the old index
+static int reserve_block_index(Blockchain* chain, size_t capacity) {
+    if (capacity <= chain->block_capacity) return 1;
+
+    Block** blocks = (Block**)malloc(capacity * sizeof(Block*));
+    if (!blocks) return 0;
+
+    if (chain->block_count > 0) memcpy(blocks, chain->blocks, chain->block_count * sizeof(Block*));
+    if (!published_table(chain, chain->blocks)) free(chain->blocks);
+    chain->blocks = blocks;
+    chain->block_capacity = capacity;
+    return 1;
+}
+
+// Records block as the next height; the caller links it into the list
+static int index_block(Blockchain* chain, Block* block) {
+    if (chain->block_count == chain->block_capacity) {
+        size_t capacity = chain->block_capacity ? chain->block_capacity * 2 : 16;
+        if (!reserve_block_index(chain, capacity)) return 0;
+    }
+
+    chain->blocks[chain->block_count++] = block;
+    // None of the new tip's transactions are indexed yet
+    chain->indexed_tip_transactions = 0;
+    return 1;
+}
+
+static Blockchain* new_blockchain(int difficulty, size_t expected_blocks) {
+    if (difficulty < 0 || difficulty > MAX_DIFFICULTY) return NULL;
 
     Blockchain* chain = (Blockchain*)malloc(sizeof(Blockchain));
     if (!chain) return NULL;
 
     chain->difficulty = difficulty;
-    chain->genesis = create_block();
-    if (!chain->genesis) {
+    chain->blocks = NULL;
+    chain->block_count = 0;
+    chain->block_capacity = 0;
+    hash_index_init(&chain->block_hash_index);
+    chain->block_hash_index.release_entries = release_hash_entries;
+    chain->block_hash_index.release_context = chain;
+    hash_index_init(&chain->tx_hash_index);
+    ledger_init(&chain->tx_nonces);
+    chain->indexed_tip_transactions = 0;
+    chain->checkpoint_height = -1;
+    chain->log = NULL;
+    chain->logged_blocks = 0;
+    chain->writer = NULL;
+    ledger_init(&chain->ledger);
+    chain->ledger_height = 0;
+    chain->ledger_tip_transactions = 0;
+    chain->ledger_first_invalid = -1;
+    chain->ledger_skipped = 0;
+    chain->columns = NULL;
+    atomic_init(&chain->view, NULL);
+    atomic_init(&chain->published_count, 0);
+    chain->readers = epoch_create();
+    arena_init(&chain->block_arena, sizeof(Block));
+    if (expected_blocks > 0) {
+        arena_reserve(&chain->block_arena, expected_blocks);
+        reserve_block_index(chain, expected_blocks);
+    }
+
+    chain->genesis = alloc_chain_block(chain);
+    if (!chain->readers || !chain->genesis || !index_block(chain, chain->genesis)) {
+        arena_free(&chain->block_arena);
+        free(chain->blocks);
+        epoch_free(chain->readers);
         free(chain);
         return NULL;
     }
@@ -20,186 +124,994 @@ Blockchain* create_blockchain(int difficulty) {
     return chain;
 }
 
+// The genesis block is the first tip, so like every tip it is mined by
+// the caller (mine_tip) once its transactions are in
+Blockchain* create_blockchain(int difficulty) {
+    Blockchain* chain = new_blockchain(difficulty, 0);
+    if (!chain) return NULL;
+
+    calculate_block_hash(chain->genesis);
+    return chain;
+}
+
+// Standalone block outside any chain's arena
 Block* create_block() {
     Block* block = (Block*)malloc(sizeof(Block));
     if (!block) return NULL;
 
-    block->index = 0;
-    block->timestamp = time(NULL);
-    block->transaction_count = 0;
-    memset(block->previous_hash, 0, SHA256_DIGEST_SIZE);
-    block->next = NULL;
-
+    init_block(block);
     calculate_block_hash(block);
     return block;
 }
 
 int add_transaction(Block* block, const char* sender, const char* receiver, double amount) {
     if (!block || !sender || !receiver || amount <= 0) return 0;
-    if (block->transaction_count >= MAX_TRANSACTIONS) return 0;
+    if (block->transaction_capacity == TRANSACTIONS_BORROWED) return 0;
+
+    AccountId from = account_intern(sender);
+    AccountId to = account_intern(receiver);
+    if (from == ACCOUNT_NONE || to == ACCOUNT_NONE) return 0;
+    if (block->transaction_count == block->transaction_capacity) {
+        if (block->transaction_capacity > INT_MAX / 2) return 0;
+        int capacity = block->transaction_capacity ? block->transaction_capacity * 2 : 4;
+        if (!reserve_transactions(block, capacity)) return 0;
+    }
 
     Transaction* tx = &block->transactions[block->transaction_count];
-    strncpy(tx->sender, sender, 63);
-    tx->sender[63] = '\0';
-    strncpy(tx->receiver, receiver, 63);
-    tx->receiver[63] = '\0';
+    tx->sender = from;
+    tx->receiver = to;
     tx->amount = amount;
     tx->timestamp = time(NULL);
     
+    uint8_t leaf[SHA256_DIGEST_SIZE];
+    transaction_leaf_hash(tx, leaf);
+    if (!merkle_append(&block->tx_tree, leaf)) return 0;
+
     block->transaction_count++;
     return 1;
 }
 
+// Resizes the transaction array; never drops below the current count
+int reserve_transactions(Block* block, int capacity) {
+    if (!block || capacity < block->transaction_count) return 0;
+    if (block->transaction_capacity == TRANSACTIONS_BORROWED) return 0;
+    if (capacity == block->transaction_capacity) return 1;
+
+    if (capacity == 0) {
+        free(block->transactions);
+        block->transactions = NULL;
+        block->transaction_capacity = 0;
+        return 1;
+    }
+
+    Transaction* transactions = (Transaction*)realloc(block->transactions, (size_t)capacity * sizeof(Transaction));
+    if (!transactions) return 0;
+
+    block->transactions = transactions;
+    block->transaction_capacity = capacity;
+    return 1;
+}
+
+// Leaf hash: the leaf prefix and the canonical encoding, hashed in one call
+void transaction_leaf_hash(const Transaction* tx, uint8_t hash[]) {
+    uint8_t buf[1 + TRANSACTION_ENCODED_MAX];
+
+    buf[0] = MERKLE_LEAF_PREFIX;
+    size_t len = encode_transaction(tx, buf + 1);
+    sha256(buf, 1 + len, hash);
+}
+
+// The canonical encoding followed by the sender's nonce, little-endian
+static size_t encode_transaction_id(const Transaction* tx, uint64_t sender_nonce, uint8_t out[]) {
+    size_t len = encode_transaction(tx, out);
+
+    for (size_t i = 0; i < sizeof(sender_nonce); i++)
+        out[len + i] = (uint8_t)(sender_nonce >> (8 * i));
+    return len + sizeof(sender_nonce);
+}
+
+// Transaction ID: SHA-256 of the canonical encoding and the sender's
+// nonce, the transfers the sender made earlier in the chain. The nonce
+// keeps apart two transfers with the same fields in the same second.
+void transaction_id(const Transaction* tx, uint64_t sender_nonce, uint8_t id[]) {
+    uint8_t buf[TRANSACTION_ENCODED_MAX + sizeof(uint64_t)];
+
+    size_t len = encode_transaction_id(tx, sender_nonce, buf);
+    sha256(buf, len, id);
+}
+
+// Leaf hashes (nonces NULL) or IDs of count transactions, through the
+// multi-buffer hasher a chunk at a time
+#define HASH_CHUNK 64
+
+static void hash_transactions(const Transaction* txs, size_t count, const uint64_t* nonces,
+                              uint8_t (*hashes)[SHA256_DIGEST_SIZE]) {
+    uint8_t buf[HASH_CHUNK][1 + TRANSACTION_ENCODED_MAX + sizeof(uint64_t)];
+    const uint8_t* data[HASH_CHUNK];
+    size_t lens[HASH_CHUNK];
+
+    for (size_t start = 0; start < count; start += HASH_CHUNK) {
+        size_t n = count - start < HASH_CHUNK ? count - start : HASH_CHUNK;
+        for (size_t i = 0; i < n; i++) {
+            if (nonces) {
+                lens[i] = encode_transaction_id(&txs[start + i], nonces[start + i], buf[i]);
+            } else {
+                buf[i][0] = MERKLE_LEAF_PREFIX;
+                lens[i] = 1 + encode_transaction(&txs[start + i], buf[i] + 1);
+            }
+            data[i] = buf[i];
+        }
+        sha256_batch(data, lens, n, hashes + start);
+    }
+}
+
+// A sealed block keeps only its Merkle root, so its proofs come from a
+// tree rebuilt from the transactions for the one call
+int get_transaction_proof(const Block* block, int tx_index, MerkleProof* proof) {
+    if (!block || tx_index < 0 || tx_index >= block->transaction_count) return 0;
+    if (merkle_has_levels(&block->tx_tree)) return merkle_get_proof(&block->tx_tree, (size_t)tx_index, proof);
+
+    MerkleTree tree;
+    uint8_t leaves[HASH_CHUNK][SHA256_DIGEST_SIZE];
+    int ok = 1;
+
+    merkle_init(&tree);
+    for (int start = 0; start < block->transaction_count && ok; start += HASH_CHUNK) {
+        int n = block->transaction_count - start < HASH_CHUNK ? block->transaction_count - start : HASH_CHUNK;
+        hash_transactions(&block->transactions[start], (size_t)n, NULL, leaves);
+        ok = merkle_append_many(&tree, leaves, (size_t)n);
+    }
+    ok = ok && merkle_get_proof(&tree, (size_t)tx_index, proof);
+    merkle_free(&tree);
+    return ok;
+}
+
+int verify_transaction_proof(const uint8_t merkle_root[], const Transaction* tx, const MerkleProof* proof) {
+    if (!merkle_root || !tx || !proof) return 0;
+
+    uint8_t leaf[SHA256_DIGEST_SIZE];
+    transaction_leaf_hash(tx, leaf);
+    return merkle_verify_proof(merkle_root, leaf, proof);
+}
+
+// Rebuilds the Merkle root from the transactions themselves
+void compute_merkle_root(const Block* block, uint8_t root[]) {
+    MerkleAccumulator acc;
+    uint8_t leaf[SHA256_DIGEST_SIZE];
+
+    merkle_accumulator_init(&acc);
+    for (int i = 0; i < block->transaction_count; i++) {
+        transaction_leaf_hash(&block->transactions[i], leaf);
+        merkle_accumulator_append(&acc, leaf);
+    }
+    merkle_accumulator_root(&acc, root);
+}
+
+static int rebuild_tx_tree(Block* block) {
+    uint8_t leaf[SHA256_DIGEST_SIZE];
+
+    merkle_free(&block->tx_tree);
+    for (int i = 0; i < block->transaction_count; i++) {
+        transaction_leaf_hash(&block->transactions[i], leaf);
+        if (!merkle_append(&block->tx_tree, leaf)) return 0;
+    }
+    return 1;
+}
+
+// Frees what a block owns; the Block itself belongs to the arena
+static void release_block(void* object) {
+    Block* block = (Block*)object;
+    merkle_free(&block->tx_tree);
+    free(block->transactions);
+    block->transactions = NULL;
+    block->transaction_count = 0;
+    block->transaction_capacity = 0;
+}
+
+// Once a block is followed by another it no longer grows, so drop the
+// slack left by geometric growth, and every Merkle node but the root
+static void shrink_block(Block* block) {
+    reserve_transactions(block, block->transaction_count);
+    merkle_drop_levels(&block->tx_tree);
+}
+
+size_t block_memory_usage(const Block* block) {
+    if (!block) return 0;
+
+    size_t bytes = sizeof(Block);
+    if (block->transaction_capacity > 0)
+        bytes += (size_t)block->transaction_capacity * sizeof(Transaction);
+    bytes += (size_t)block->tx_tree.level_count * sizeof(MerkleLevel);
+    for (int k = 0; k < block->tx_tree.level_count; k++)
+        bytes += block->tx_tree.levels[k].capacity * SHA256_DIGEST_SIZE;
+    return bytes;
+}
+
+// Hashes the encoded header up to the nonce, which comes last so that
+// miners can reuse this state as a midstate. The transactions enter only
+// through their Merkle root.
+static void hash_block_prefix(const Block* block, const uint8_t merkle_root[], SHA256_CTX* ctx) {
+    uint8_t header[BLOCK_HEADER_ENCODED_SIZE];
+
+    encode_block_header(block, merkle_root, header);
+    sha256_init(ctx);
+    sha256_update(ctx, header, BLOCK_HEADER_NONCE_OFFSET);
+}
+
+static void hash_with_nonce(const SHA256_CTX* midstate, uint64_t nonce, uint8_t hash[]) {
+    SHA256_CTX ctx = *midstate;
+    uint8_t bytes[sizeof(nonce)];
+
+    for (size_t i = 0; i < sizeof(bytes); i++)
+        bytes[i] = (uint8_t)(nonce >> (8 * i));
+    sha256_update(&ctx, bytes, sizeof(bytes));
+    sha256_final(&ctx, hash);
+}
+
+// The whole encoded header in a single pass
+void compute_block_hash(const Block* block, const uint8_t merkle_root[], uint8_t hash[]) {
+    uint8_t header[BLOCK_HEADER_ENCODED_SIZE];
+
+    encode_block_header(block, merkle_root, header);
+    sha256(header, sizeof(header), hash);
+    METRIC_ADD(METRIC_BLOCK_HASHES, 1);
+}
+
 void calculate_block_hash(Block* block) {
     if (!block) return;
 
-    SHA256_CTX ctx;
-    sha256_init(&ctx);
-    
-    // Hash the block's index
-    sha256_update(&ctx, (uint8_t*)&block->index, sizeof(block->index));
-    
-    // Hash the timestamp
-    sha256_update(&ctx, (uint8_t*)&block->timestamp, sizeof(block->timestamp));
-    
-    // Hash the transactions
-    for (int i = 0; i < block->transaction_count; i++) {
-        Transaction* tx = &block->transactions[i];
-        sha256_update(&ctx, (uint8_t*)tx->sender, strlen(tx->sender));
-        sha256_update(&ctx, (uint8_t*)tx->receiver, strlen(tx->receiver));
-        sha256_update(&ctx, (uint8_t*)&tx->amount, sizeof(tx->amount));
-        sha256_update(&ctx, (uint8_t*)&tx->timestamp, sizeof(tx->timestamp));
+    compute_block_hash(block, block->tx_tree.root, block->hash);
+}
+
+int hash_meets_difficulty(const uint8_t hash[], int difficulty) {
+    int full_bytes = difficulty / 8;
+    int rest_bits = difficulty % 8;
+
+    for (int i = 0; i < full_bytes; i++) {
+        if (hash[i] != 0) return 0;
     }
-    
-    // Hash the previous block's hash
-    sha256_update(&ctx, block->previous_hash, SHA256_DIGEST_SIZE);
-    
-    sha256_final(&ctx, block->hash);
+    if (rest_bits && (hash[full_bytes] >> (8 - rest_bits)) != 0) return 0;
+    return 1;
+}
+
+// Shared state for the mining threads
+typedef struct {
+    SHA256_CTX midstate;
+    int difficulty;
+    atomic_int found;
+    uint64_t nonce;
+    uint8_t hash[SHA256_DIGEST_SIZE];
+} MiningJob;
+
+typedef struct {
+    MiningJob* job;
+    uint64_t start;
+    uint64_t count;
+} MiningRange;
+
+// How many nonces a miner tries between checks of the found flag
+#define MINING_POLL_INTERVAL 4096
+// Below this many leading zero bits mining stays on the calling thread
+#define MINING_THREAD_MIN_DIFFICULTY 12
+
+static void* mining_worker(void* arg) {
+    MiningRange* range = (MiningRange*)arg;
+    MiningJob* job = range->job;
+    uint8_t hash[SHA256_DIGEST_SIZE];
+    uint64_t nonce = range->start;
+    uint64_t remaining = range->count;
+
+    while (remaining > 0 && !atomic_load_explicit(&job->found, memory_order_relaxed)) {
+        uint64_t batch = remaining < MINING_POLL_INTERVAL ? remaining : MINING_POLL_INTERVAL;
+        for (uint64_t i = 0; i < batch; i++, nonce++) {
+            hash_with_nonce(&job->midstate, nonce, hash);
+            if (hash_meets_difficulty(hash, job->difficulty)) {
+                int expected = 0;
+                if (atomic_compare_exchange_strong(&job->found, &expected, 1)) {
+                    job->nonce = nonce;
+                    memcpy(job->hash, hash, SHA256_DIGEST_SIZE);
+                }
+                METRIC_ADD(METRIC_NONCES_TRIED, i + 1);
+                return NULL;
+            }
+        }
+        METRIC_ADD(METRIC_NONCES_TRIED, batch);
+        remaining -= batch;
+    }
+    return NULL;
+}
+
+int mine_block(Block* block, int difficulty, int num_threads) {
+    if (!block || difficulty < 0 || difficulty > MAX_DIFFICULTY) return 0;
+
+    if (num_threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        num_threads = cpus > 0 ? (int)cpus : 1;
+    }
+    // Easy targets are met sooner than extra threads can start
+    if (difficulty < MINING_THREAD_MIN_DIFFICULTY) num_threads = 1;
+
+    MiningJob job;
+    hash_block_prefix(block, block->tx_tree.root, &job.midstate);
+    job.difficulty = difficulty;
+    atomic_init(&job.found, 0);
+
+    // Split the nonce space into disjoint ranges, one per thread
+    MiningRange* ranges = (MiningRange*)malloc((size_t)num_threads * sizeof(MiningRange));
+    pthread_t* threads = (pthread_t*)malloc((size_t)num_threads * sizeof(pthread_t));
+    if (!ranges || !threads) {
+        free(ranges);
+        free(threads);
+        return 0;
+    }
+
+    uint64_t span = UINT64_MAX / (uint64_t)num_threads;
+    for (int t = 0; t < num_threads; t++) {
+        ranges[t].job = &job;
+        ranges[t].start = span * (uint64_t)t;
+        ranges[t].count = t == num_threads - 1 ? UINT64_MAX - ranges[t].start : span;
+    }
+
+    int started = 1;
+    while (started < num_threads &&
+           pthread_create(&threads[started], NULL, mining_worker, &ranges[started]) == 0)
+        started++;
+
+    // The caller mines its own range, then any range whose thread failed to start
+    mining_worker(&ranges[0]);
+    for (int t = started; t < num_threads; t++)
+        mining_worker(&ranges[t]);
+
+    for (int t = 1; t < started; t++)
+        pthread_join(threads[t], NULL);
+    free(ranges);
+    free(threads);
+
+    if (!atomic_load(&job.found)) return 0;
+
+    block->nonce = job.nonce;
+    memcpy(block->hash, job.hash, SHA256_DIGEST_SIZE);
+    return 1;
+}
+
+// Transactions never move between heights, so the tip's are indexed as
+// soon as they are seen, in chain order, which is what numbers each
+// sender's transfers. Genesis mints send nothing; their position stands
+// in for the nonce. A chunk is indexed whole or not at all, so a retry
+// after a failure numbers no transfer twice.
+static int index_tip_transactions(Blockchain* chain) {
+    Block* tip = chain->latest;
+    size_t height = chain->block_count - 1;
+    uint8_t ids[HASH_CHUNK][SHA256_DIGEST_SIZE];
+    uint64_t nonces[HASH_CHUNK];
+
+    while (chain->indexed_tip_transactions < tip->transaction_count) {
+        int start = chain->indexed_tip_transactions;
+        int n = tip->transaction_count - start < HASH_CHUNK ? tip->transaction_count - start : HASH_CHUNK;
+        if (!hash_index_reserve(&chain->tx_hash_index, chain->tx_hash_index.count + (size_t)n) ||
+            !ledger_reserve(&chain->tx_nonces, chain->tx_nonces.count + (size_t)n))
+            return 0;
+
+        for (int i = 0; i < n; i++) {
+            if (height == 0) nonces[i] = (uint64_t)(start + i);
+            else ledger_take_nonce(&chain->tx_nonces, tip->transactions[start + i].sender, &nonces[i]);
+        }
+        hash_transactions(&tip->transactions[start], (size_t)n, nonces, ids);
+        for (int i = 0; i < n; i++)
+            hash_index_insert(&chain->tx_hash_index, ids[i], ((uint64_t)height << 32) | (uint32_t)(start + i));
+        chain->indexed_tip_transactions += n;
+    }
+    return 1;
+}
+
+// Genesis transactions mint: the receiver is credited and the sender, only
+// a label there, is left alone. Every later transaction is a transfer that
+// the sender's balance must cover.
+static int apply_transaction(Ledger* ledger, const Transaction* tx, size_t height) {
+    if (height == 0) return ledger_mint(ledger, tx->receiver, tx->amount);
+    return ledger_transfer(ledger, tx->sender, tx->receiver, tx->amount);
+}
+
+// Brings the ledger up to date with every transaction in the chain, tip
+// included; the tip only gains transactions, so they are applied as they
+// appear. A transaction that cannot apply is left out and counted in
+// ledger_skipped, and the first block holding one is recorded in
+// ledger_first_invalid; later transactions still apply. Returns 0 only if
+// the ledger could not grow, LEDGER_SKIPPED once anything was left out.
+static int update_ledger(Blockchain* chain) {
+    for (;;) {
+        size_t height = chain->ledger_height;
+        const Block* block = chain->blocks[height];
+
+        for (int i = chain->ledger_tip_transactions; i < block->transaction_count; i++) {
+            // Growing first leaves an overspend as the only way to fail
+            if (!ledger_reserve(&chain->ledger, chain->ledger.count + 2)) return 0;
+            if (!apply_transaction(&chain->ledger, &block->transactions[i], height)) {
+                if (chain->ledger_first_invalid < 0) chain->ledger_first_invalid = (long)height;
+                chain->ledger_skipped++;
+            }
+            chain->ledger_tip_transactions = i + 1;
+        }
+
+        if (height + 1 >= chain->block_count) return chain->ledger_skipped ? LEDGER_SKIPPED : 1;
+        chain->ledger_height++;
+        chain->ledger_tip_transactions = 0;
+    }
+}
+
+// Starts the ledger over from the genesis block, for when it has counted
+// transactions the chain does not hold
+static void rebuild_ledger(Blockchain* chain) {
+    ledger_free(&chain->ledger);
+    ledger_init(&chain->ledger);
+    chain->ledger_height = 0;
+    chain->ledger_tip_transactions = 0;
+    chain->ledger_first_invalid = -1;
+    chain->ledger_skipped = 0;
+    update_ledger(chain);
+}
+
+// Adds a transaction to the tip only if the ledger allows it: the sender
+// must hold amount, except in the genesis block, which mints. Returns
+// LEDGER_SKIPPED instead of 1 if the ledger has left out an overspend
+// that reached the chain some other way.
+int submit_transaction(Blockchain* chain, const char* sender, const char* receiver, double amount) {
+    if (!chain || !sender || !receiver || !(amount > 0 && amount <= DBL_MAX)) return 0;
+    if (!update_ledger(chain)) return 0;
+    if (chain->block_count > 1 && ledger_balance(&chain->ledger, account_lookup(sender)) < amount) return 0;
+
+    if (!add_transaction(chain->latest, sender, receiver, amount)) return 0;
+    return update_ledger(chain);
+}
+
+// Batch form of submit_transaction: each transaction the ledger accepts,
+// in order, is added to the tip, and the Merkle root is folded once for
+// the batch. Transactions the ledger refuses, or whose account IDs were
+// never interned, are skipped. Returns how many were added.
+int submit_transactions(Blockchain* chain, const Transaction* txs, int count) {
+    if (!chain || !txs || count <= 0 || !update_ledger(chain)) return 0;
+
+    Block* tip = chain->latest;
+    size_t height = chain->block_count - 1;
+    if (tip->transaction_capacity == TRANSACTIONS_BORROWED || count > INT_MAX - tip->transaction_count) return 0;
+    if (tip->transaction_count + count > tip->transaction_capacity &&
+        !reserve_transactions(tip, tip->transaction_count + count))
+        return 0;
+
+    // The ledger check has to see earlier transactions of the batch applied
+    time_t now = time(NULL);
+    Transaction* added = &tip->transactions[tip->transaction_count];
+    int accepted = 0;
+    for (int i = 0; i < count; i++) {
+        const Transaction* tx = &txs[i];
+        if (!(tx->amount > 0 && tx->amount <= DBL_MAX)) continue;
+        if (!account_name(tx->sender, NULL) || !account_name(tx->receiver, NULL)) continue;
+        if (!apply_transaction(&chain->ledger, tx, height)) continue;
+
+        Transaction* slot = &added[accepted++];
+        *slot = *tx;
+        slot->timestamp = now;
+    }
+
+    uint8_t leaves[HASH_CHUNK][SHA256_DIGEST_SIZE];
+    int ok = 1;
+    for (int start = 0; start < accepted && ok; start += HASH_CHUNK) {
+        size_t n = accepted - start < HASH_CHUNK ? (size_t)(accepted - start) : HASH_CHUNK;
+        hash_transactions(&added[start], n, NULL, leaves);
+        ok = merkle_append_many(&tip->tx_tree, leaves, n);
+    }
+
+    // The ledger already counts the accepted transactions; if the tree
+    // could not take them all, it is rebuilt from what the tip kept
+    tip->transaction_count = (int)tip->tx_tree.leaf_count;
+    chain->ledger_tip_transactions = tip->transaction_count;
+    if (!ok) {
+        rebuild_ledger(chain);
+        return 0;
+    }
+    return accepted;
+}
+
+// Balance and nonce of an account, counting the tip's transactions.
+// Returns 0 for an account no transaction has touched, and LEDGER_SKIPPED
+// instead of 1 if the ledger has left out an overspend.
+int get_account(Blockchain* chain, const char* name, double* balance, uint64_t* nonce) {
+    if (!chain || !name) return 0;
+    int status = update_ledger(chain);
+
+    const LedgerAccount* account = ledger_find(&chain->ledger, account_lookup(name));
+    if (balance) *balance = account ? account->balance : 0;
+    if (nonce) *nonce = account ? account->nonce : 0;
+    if (!account) return 0;
+    return status == LEDGER_SKIPPED ? LEDGER_SKIPPED : 1;
+}
+
+// Starts a columnar copy of every transaction (txcolumns.h), kept up to
+// date from then on as blocks are sealed
+int enable_transaction_columns(Blockchain* chain) {
+    if (!chain) return 0;
+    if (chain->columns) return 1;
+
+    TxColumns* columns = (TxColumns*)malloc(sizeof(TxColumns));
+    if (!columns) return 0;
+    txcolumns_init(columns);
+    if (!txcolumns_sync(columns, chain->blocks, chain->block_count)) {
+        txcolumns_free(columns);
+        free(columns);
+        return 0;
+    }
+    chain->columns = columns;
+    return 1;
+}
+
+// The columns with the tip's transactions so far included, or NULL if
+// they are not enabled or cannot catch up. Valid until the next change
+// to the chain, on the thread that adds blocks.
+const TxColumns* get_transaction_columns(Blockchain* chain) {
+    if (!chain || !chain->columns) return NULL;
+    if (!txcolumns_sync(chain->columns, chain->blocks, chain->block_count)) return NULL;
+    return chain->columns;
+}
+
+// The tip may still gain transactions and be re-mined, so its hash only
+// enters the index once another block is appended after it
+static int seal_tip(Blockchain* chain) {
+    size_t height = chain->block_count - 1;
+    Block* tip = chain->latest;
+
+    if (!index_tip_transactions(chain)) return 0;
+    if (!hash_index_insert(&chain->block_hash_index, tip->hash, height)) return 0;
+
+    // An overspend does not stop the chain from growing; the ledger leaves
+    // it out and reports it through ledger_first_invalid and ledger_skipped
+    update_ledger(chain);
+    // Columns that could not grow catch up on the next call
+    if (chain->columns) txcolumns_sync(chain->columns, chain->blocks, chain->block_count);
+    return 1;
+}
+
+// A sealed block never changes again, so this is when it goes to the log,
+// or to the background writer, which only copies its encoding here
+static int log_sealed_tip(Blockchain* chain) {
+    if (!chain->log || chain->logged_blocks >= chain->block_count) return 1;
+
+    if (chain->writer ? !chainwriter_submit(chain->writer, chain->latest)
+                      : !chainlog_append(chain->log, chain->latest))
+        return 0;
+    chain->logged_blocks = chain->block_count;
+    return 1;
+}
+
+static void release_view(void* object) {
+    ChainView* view = (ChainView*)object;
+
+    if (view->release_blocks) free(view->blocks);
+    if (view->release_entries) free(view->block_hash_index.entries);
+    free(view);
+}
+
+// Makes every block below the tip visible to readers; the tip can still
+// gain transactions or be re-mined, so it waits until it is sealed
+static void publish_sealed(Blockchain* chain) {
+    ChainView* old = atomic_load_explicit(&chain->view, memory_order_relaxed);
+
+    if (!old || old->blocks != chain->blocks || old->block_hash_index.entries != chain->block_hash_index.entries) {
+        ChainView* view = (ChainView*)malloc(sizeof(ChainView));
+        // Readers keep the old view, which stays intact, and the old count
+        if (!view) return;
+
+        view->blocks = chain->blocks;
+        view->block_hash_index = chain->block_hash_index;
+        view->release_blocks = 0;
+        view->release_entries = 0;
+        atomic_store_explicit(&chain->view, view, memory_order_release);
+
+        if (old) {
+            old->release_blocks = old->blocks != view->blocks;
+            old->release_entries = old->block_hash_index.entries != view->block_hash_index.entries;
+            epoch_retire(chain->readers, old, release_view);
+        }
+    }
+
+    // A reader that sees this count also sees a view that covers it
+    atomic_store_explicit(&chain->published_count, chain->block_count - 1, memory_order_release);
+    epoch_reclaim(chain->readers);
 }
 
+Block* find_block_by_hash(const Blockchain* chain, const uint8_t hash[]) {
+    if (!chain || !hash) return NULL;
+
+    uint64_t height;
+    if (hash_index_find(&chain->block_hash_index, hash, &height)) {
+        Block* block = get_block_by_index(chain, (size_t)height);
+        if (block && memcmp(block->hash, hash, SHA256_DIGEST_SIZE) == 0) return block;
+    }
+
+    if (chain->latest && memcmp(chain->latest->hash, hash, SHA256_DIGEST_SIZE) == 0)
+        return chain->latest;
+    return NULL;
+}
+
+Transaction* find_transaction(Blockchain* chain, const uint8_t id[], Block** block) {
+    if (block) *block = NULL;
+    if (!chain || !id || chain->block_count == 0) return NULL;
+
+    // Pick up transactions added to the tip since the last lookup
+    index_tip_transactions(chain);
+
+    uint64_t location;
+    if (!hash_index_find(&chain->tx_hash_index, id, &location)) return NULL;
+
+    Block* found = get_block_by_index(chain, (size_t)(location >> 32));
+    int position = (int)(location & 0xffffffffu);
+    if (!found || position >= found->transaction_count) return NULL;
+
+    if (block) *block = found;
+    return &found->transactions[position];
+}
+
+// O(1) lookup by height; NULL past the tip
+Block* get_block_by_index(const Blockchain* chain, size_t index) {
+    if (!chain || index >= chain->block_count) return NULL;
+
+    return chain->blocks[index];
+}
+
+size_t get_block_count(const Blockchain* chain) {
+    return chain ? chain->block_count : 0;
+}
+
+// Whether the tip's hash is still that of its contents and meets the
+// target; one header hash, as the Merkle root is kept up to date
+static int tip_is_mined(const Blockchain* chain) {
+    uint8_t hash[SHA256_DIGEST_SIZE];
+
+    compute_block_hash(chain->latest, chain->latest->tx_tree.root, hash);
+    return memcmp(hash, chain->latest->hash, SHA256_DIGEST_SIZE) == 0 &&
+           hash_meets_difficulty(hash, chain->difficulty);
+}
+
+// Mines the tip at the chain's difficulty on every online CPU; done once
+// per block, after its last transaction and before add_block seals it
+int mine_tip(Blockchain* chain) {
+    if (!chain || !chain->latest) return 0;
+
+    return mine_block(chain->latest, chain->difficulty, 0);
+}
+
+// Seals the tip as the caller mined it and starts an empty tip after it.
+// The new tip only gets its plain header hash: it is mined once it has
+// been filled, so no proof of work is spent on a block that will change.
+// A tip the caller did not mine, or changed after mining, is mined here,
+// so every sealed block matches its hash and meets the target.
 void add_block(Blockchain* chain) {
     if (!chain || !chain->latest) return;
+    if (!tip_is_mined(chain) && !mine_tip(chain)) return;
 
-    Block* new_block = create_block();
+    Block* new_block = alloc_chain_block(chain);
     if (!new_block) return;
 
     new_block->index = chain->latest->index + 1;
     memcpy(new_block->previous_hash, chain->latest->hash, SHA256_DIGEST_SIZE);
-    
     calculate_block_hash(new_block);
     
+    if (!seal_tip(chain) || !log_sealed_tip(chain) || !index_block(chain, new_block)) {
+        release_block(new_block);
+        return;
+    }
+    
+    shrink_block(chain->latest);
     chain->latest->next = new_block;
     chain->latest = new_block;
+    publish_sealed(chain);
+}
+
+// After a full validation the last sealed block becomes the checkpoint;
+// the tip is left out because it can still change without being re-mined
+static void advance_checkpoint(Blockchain* chain) {
+    if (chain->block_count < 2) return;
+
+    chain->checkpoint_height = (long)chain->block_count - 2;
+    memcpy(chain->checkpoint_hash, chain->blocks[chain->block_count - 2]->hash, SHA256_DIGEST_SIZE);
+}
+
+// Height validation can start from: just after the checkpoint, if the
+// block there still has the hash that was vouched for
+static size_t checkpoint_start(const Blockchain* chain) {
+    if (chain->checkpoint_height < 0 || (size_t)chain->checkpoint_height >= chain->block_count) return 0;
+
+    const Block* block = chain->blocks[chain->checkpoint_height];
+    if (memcmp(block->hash, chain->checkpoint_hash, SHA256_DIGEST_SIZE) != 0) return 0;
+    return (size_t)chain->checkpoint_height + 1;
 }
 
 int validate_chain(Blockchain* chain) {
     if (!chain || !chain->genesis) return 0;
+    METRIC_TIMER_START(timer);
 
-    Block* current = chain->genesis;
-    uint8_t calculated_hash[SHA256_DIGEST_SIZE];
+    // Each block is checked against its contents, the proof-of-work target
+    // and the block before it. The tip is only mined when it is sealed, so
+    // it is held to its contents and link alone.
+    int valid = 1;
+    const Block* previous = NULL;
+    for (const Block* current = chain->genesis; current && valid; current = current->next) {
+        int difficulty = current == chain->latest ? 0 : chain->difficulty;
+        valid = verify_block(current, previous ? previous->hash : NULL, difficulty);
+        previous = current;
+    }
 
-    while (current) {
-        // Calculate hash of current block
-        SHA256_CTX ctx;
-        sha256_init(&ctx);
-        
-        sha256_update(&ctx, (uint8_t*)&current->index, sizeof(current->index));
-        sha256_update(&ctx, (uint8_t*)&current->timestamp, sizeof(current->timestamp));
-        
-        for (int i = 0; i < current->transaction_count; i++) {
-            Transaction* tx = &current->transactions[i];
-            sha256_update(&ctx, (uint8_t*)tx->sender, strlen(tx->sender));
-            sha256_update(&ctx, (uint8_t*)tx->receiver, strlen(tx->receiver));
-            sha256_update(&ctx, (uint8_t*)&tx->amount, sizeof(tx->amount));
-            sha256_update(&ctx, (uint8_t*)&tx->timestamp, sizeof(tx->timestamp));
-        }
-        
-        sha256_update(&ctx, current->previous_hash, SHA256_DIGEST_SIZE);
-        sha256_final(&ctx, calculated_hash);
+    METRIC_TIMER_STOP(METRIC_VALIDATE_LATENCY, timer);
+    if (!valid) return 0;
+    advance_checkpoint(chain);
+    return 1;
+}
 
-        // Compare calculated hash with stored hash
-        if (memcmp(calculated_hash, current->hash, SHA256_DIGEST_SIZE) != 0) {
-            return 0;
+// Shared state for the validation workers
+typedef struct {
+    Block* const* blocks;
+    size_t first;  // height to start from
+    size_t count;
+    size_t chunk_size;
+    int difficulty;
+    atomic_size_t next_chunk;
+    atomic_size_t first_invalid;  // count while no bad block has been found
+} ValidationJob;
+
+// A block is bad if its stored hash does not match its contents, misses the
+// proof-of-work target, or its previous_hash does not match previous_hash
+// (the hash of the block before it, or NULL for the genesis block)
+int verify_block(const Block* block, const uint8_t previous_hash[], int difficulty) {
+    uint8_t merkle_root[SHA256_DIGEST_SIZE], calculated_hash[SHA256_DIGEST_SIZE];
+
+    METRIC_ADD(METRIC_BLOCKS_VALIDATED, 1);
+    compute_merkle_root(block, merkle_root);
+    compute_block_hash(block, merkle_root, calculated_hash);
+    if (memcmp(calculated_hash, block->hash, SHA256_DIGEST_SIZE) != 0) return 0;
+    if (!hash_meets_difficulty(block->hash, difficulty)) return 0;
+    if (previous_hash && memcmp(previous_hash, block->previous_hash, SHA256_DIGEST_SIZE) != 0) return 0;
+    return 1;
+}
+
+// The first block of a chunk checks the link back into the previous chunk.
+// The last block is the unsealed tip, which need not meet the target yet.
+static int block_is_valid(ValidationJob* job, size_t i) {
+    int difficulty = i + 1 == job->count ? 0 : job->difficulty;
+    return verify_block(job->blocks[i], i > 0 ? job->blocks[i - 1]->hash : NULL, difficulty);
+}
+
+static void* validation_worker(void* arg) {
+    ValidationJob* job = (ValidationJob*)arg;
+
+    for (;;) {
+        size_t start = job->first + atomic_fetch_add(&job->next_chunk, 1) * job->chunk_size;
+        // Chunks are claimed in order, so nothing later can beat a known failure
+        if (start >= job->count || start >= atomic_load(&job->first_invalid)) break;
+
+        size_t end = start + job->chunk_size;
+        if (end > job->count) end = job->count;
+
+        for (size_t i = start; i < end; i++) {
+            size_t known = atomic_load(&job->first_invalid);
+            if (i >= known) break;
+            if (!block_is_valid(job, i)) {
+                while (i < known && !atomic_compare_exchange_weak(&job->first_invalid, &known, i))
+                    ;
+                break;
+            }
         }
+    }
+    return NULL;
+}
 
-        // If there's a next block, verify its previous hash matches current block's hash
-        if (current->next && memcmp(current->hash, current->next->previous_hash, SHA256_DIGEST_SIZE) != 0) {
-            return 0;
+int validate_chain_parallel(Blockchain* chain, const ValidationOptions* options, long* first_invalid) {
+    if (first_invalid) *first_invalid = -1;
+    if (!chain || !chain->genesis) {
+        if (first_invalid) *first_invalid = 0;
+        return 0;
+    }
+
+    METRIC_TIMER_START(timer);
+    int num_threads = options ? options->num_threads : 1;
+    size_t chunk_size = options ? options->chunk_size : 0;
+
+    // Workers address blocks through the height index
+    ValidationJob job;
+    job.blocks = chain->blocks;
+    job.first = options && options->from_checkpoint ? checkpoint_start(chain) : 0;
+    job.count = chain->block_count;
+
+    if (num_threads < 1) num_threads = 1;
+    if (chunk_size == 0) {
+        // Several chunks per thread so a slow segment does not stall the rest
+        chunk_size = (job.count - job.first) / ((size_t)num_threads * 8);
+        if (chunk_size == 0) chunk_size = 1;
+    }
+    job.chunk_size = chunk_size;
+    job.difficulty = chain->difficulty;
+    atomic_init(&job.next_chunk, 0);
+    atomic_init(&job.first_invalid, job.count);
+
+    pthread_t* threads = NULL;
+    int started = 0;
+    if (num_threads > 1) {
+        threads = (pthread_t*)malloc((size_t)(num_threads - 1) * sizeof(pthread_t));
+        for (; threads && started < num_threads - 1; started++) {
+            if (pthread_create(&threads[started], NULL, validation_worker, &job) != 0) break;
         }
+    }
 
-        current = current->next;
+    // The calling thread works too
+    validation_worker(&job);
+
+    for (int i = 0; i < started; i++)
+        pthread_join(threads[i], NULL);
+    free(threads);
+    METRIC_TIMER_STOP(METRIC_VALIDATE_LATENCY, timer);
+
+    size_t bad = atomic_load(&job.first_invalid);
+    if (bad < job.count) {
+        if (first_invalid) *first_invalid = (long)bad;
+        return 0;
     }
 
+    advance_checkpoint(chain);
     return 1;
 }
 
-void print_block(Block* block) {
-    if (!block) return;
+// The reference format; chainexport.h writes the same text much faster
+void fprint_block(FILE* out, const Block* block) {
+    if (!out || !block) return;
 
-    printf("\nBlock #%u\n", block->index);
-    printf("Timestamp: %ld\n", block->timestamp);
-    printf("Previous Hash: ");
+    fprintf(out, "\nBlock #%u\n", block->index);
+    fprintf(out, "Timestamp: %ld\n", block->timestamp);
+    fprintf(out, "Nonce: %llu\n", (unsigned long long)block->nonce);
+    fprintf(out, "Previous Hash: ");
     for (int i = 0; i < SHA256_DIGEST_SIZE; i++) {
-        printf("%02x", block->previous_hash[i]);
+        fprintf(out, "%02x", block->previous_hash[i]);
     }
-    printf("\nHash: ");
+    fprintf(out, "\nHash: ");
     for (int i = 0; i < SHA256_DIGEST_SIZE; i++) {
-        printf("%02x", block->hash[i]);
+        fprintf(out, "%02x", block->hash[i]);
     }
-    printf("\nTransactions:\n");
+    fprintf(out, "\nTransactions:\n");
     
     for (int i = 0; i < block->transaction_count; i++) {
-        Transaction* tx = &block->transactions[i];
-        printf("  %d. %s -> %s: %.2f\n", 
-               i + 1, tx->sender, tx->receiver, tx->amount);
+        const Transaction* tx = &block->transactions[i];
+        fprintf(out, "  %d. %s -> %s: %.2f\n", 
+                i + 1, account_name(tx->sender, NULL), account_name(tx->receiver, NULL), tx->amount);
     }
-    printf("\n");
+    fprintf(out, "\n");
+}
+
+void print_block(Block* block) {
+    fprint_block(stdout, block);
 }
 
+// Same output as print_block on every block, through the buffered exporter
 void print_blockchain(Blockchain* chain) {
     if (!chain || !chain->genesis) return;
 
-    Block* current = chain->genesis;
-    while (current) {
-        print_block(current);
-        current = current->next;
-    }
+    chainexport_write(chain, stdout, NULL, NULL);
 }
 
-int save_blockchain(Blockchain* chain, const char* filename) {
-    if (!chain || !filename) return 0;
+// A thread that reads while another adds blocks claims a reader slot
+// first. Returns -1 if all EPOCH_MAX_READERS are taken.
+int register_reader(Blockchain* chain) {
+    return chain ? epoch_register(chain->readers) : -1;
+}
 
-    FILE* file = fopen(filename, "wb");
-    if (!file) return 0;
+void unregister_reader(Blockchain* chain, int reader) {
+    if (chain) epoch_unregister(chain->readers, reader);
+}
 
-    // Write blockchain metadata
-    if (fwrite(&chain->difficulty, sizeof(int), 1, file) != 1) {
-        fclose(file);
-        return 0;
-    }
+// Takes a snapshot of the sealed blocks without locking or waiting. Until
+// release_snapshot the writer cannot free anything the snapshot may reach,
+// so snapshots should be short-lived. Returns how many blocks it holds.
+size_t read_snapshot(Blockchain* chain, int reader, ChainSnapshot* snapshot) {
+    if (!snapshot) return 0;
 
-    // Write blocks
-    Block* current = chain->genesis;
-    while (current) {
-        if (fwrite(&current->index, sizeof(uint32_t), 1, file) != 1 ||
-            fwrite(&current->timestamp, sizeof(time_t), 1, file) != 1 ||
-            fwrite(&current->transaction_count, sizeof(int), 1, file) != 1 ||
-            fwrite(current->transactions, sizeof(Transaction), current->transaction_count, file) != current->transaction_count ||
-            fwrite(current->previous_hash, sizeof(uint8_t), SHA256_DIGEST_SIZE, file) != SHA256_DIGEST_SIZE ||
-            fwrite(current->hash, sizeof(uint8_t), SHA256_DIGEST_SIZE, file) != SHA256_DIGEST_SIZE) {
-            fclose(file);
-            return 0;
-        }
-        current = current->next;
-    }
+    snapshot->chain = chain;
+    snapshot->reader = -1;
+    snapshot->view = NULL;
+    snapshot->count = 0;
+    snapshot->tip = NULL;
+    if (!chain || reader < 0 || reader >= EPOCH_MAX_READERS) return 0;
 
-    fclose(file);
+    epoch_enter(chain->readers, reader);
+    snapshot->reader = reader;
+    snapshot->count = atomic_load_explicit(&chain->published_count, memory_order_acquire);
+    snapshot->view = atomic_load_explicit(&chain->view, memory_order_acquire);
+    if (snapshot->count > 0) snapshot->tip = snapshot->view->blocks[snapshot->count - 1];
+    return snapshot->count;
+}
+
+void release_snapshot(ChainSnapshot* snapshot) {
+    if (!snapshot || !snapshot->chain || snapshot->reader < 0) return;
+
+    epoch_exit(snapshot->chain->readers, snapshot->reader);
+    snapshot->reader = -1;
+    snapshot->view = NULL;
+    snapshot->count = 0;
+    snapshot->tip = NULL;
+}
+
+Block* snapshot_block(const ChainSnapshot* snapshot, size_t height) {
+    if (!snapshot || height >= snapshot->count) return NULL;
+
+    return snapshot->view->blocks[height];
+}
+
+// Walks like next, but stops at the snapshot's tip, whose next pointer
+// the writer may be setting
+Block* snapshot_next(const ChainSnapshot* snapshot, const Block* block) {
+    if (!snapshot || !block || block == snapshot->tip) return NULL;
+
+    return block->next;
+}
+
+// Blocks sealed after the snapshot was taken are not found
+Block* snapshot_find_block(const ChainSnapshot* snapshot, const uint8_t hash[]) {
+    if (!snapshot || !hash || snapshot->count == 0) return NULL;
+
+    uint64_t height;
+    if (!hash_index_find(&snapshot->view->block_hash_index, hash, &height) || height >= snapshot->count)
+        return NULL;
+
+    Block* block = snapshot->view->blocks[height];
+    return memcmp(block->hash, hash, SHA256_DIGEST_SIZE) == 0 ? block : NULL;
+}
+
+// Like validate_chain over the snapshot's blocks, but leaves the
+// checkpoint alone, as only the writer may move it. A snapshot holds only
+// sealed blocks, so every one of them must meet the target.
+int validate_snapshot(const ChainSnapshot* snapshot) {
+    if (!snapshot || snapshot->count == 0) return 0;
+
+    Block* const* blocks = snapshot->view->blocks;
+    for (size_t i = 0; i < snapshot->count; i++) {
+        if (!verify_block(blocks[i], i > 0 ? blocks[i - 1]->hash : NULL, snapshot->chain->difficulty)) return 0;
+    }
     return 1;
 }
 
-Blockchain* load_blockchain(const char* filename) {
-    if (!filename) return NULL;
+// Smallest block record in a version 1 file: a block with no transactions
+#define MIN_SAVED_BLOCK_SIZE (sizeof(uint32_t) + sizeof(time_t) + sizeof(int) + 2 * SHA256_DIGEST_SIZE)
+
+int save_blockchain(Blockchain* chain, const char* filename) {
+    METRIC_TIMER_START(timer);
+    int ok = chainfile_save(chain, filename);
+    METRIC_TIMER_STOP(METRIC_SAVE_LATENCY, timer);
+    return ok;
+}
 
+// Writes the compact pack format from chainpack.h; load_blockchain reads
+// it back. NULL options compress with the default segment size.
+int save_compact_blockchain(Blockchain* chain, const char* filename, const ChainPackOptions* options) {
+    METRIC_TIMER_START(timer);
+    int ok = chainpack_save(chain, filename, options);
+    METRIC_TIMER_STOP(METRIC_SAVE_LATENCY, timer);
+    return ok;
+}
+
+// A version 1 transaction's share of its block hash, as the original code
+// hashed it: the names up to their terminators, then the raw amount and
+// timestamp bytes
+static void hash_legacy_transaction(SHA256_CTX* ctx, const ChainFileNamedTransaction* tx) {
+    sha256_update(ctx, (const uint8_t*)tx->sender, strlen(tx->sender));
+    sha256_update(ctx, (const uint8_t*)tx->receiver, strlen(tx->receiver));
+    sha256_update(ctx, (const uint8_t*)&tx->amount, sizeof(tx->amount));
+    sha256_update(ctx, (const uint8_t*)&tx->timestamp, sizeof(tx->timestamp));
+}
+
+// Reads a version 1 file, as the original save_blockchain wrote it: the
+// difficulty, then every block as index, timestamp, transaction count,
+// transactions, previous hash and hash. There is no nonce, and the hashes
+// cover the raw fields rather than the canonical encoding. Each block is
+// checked against its stored hash and link the way they were made, then
+// hashed afresh and mined at the file's difficulty, which the original
+// code never did. Returns NULL if the file is cut short or does not check
+// out, which is also what a file in any other layout comes to.
+static Blockchain* load_legacy_blockchain(const char* filename) {
     FILE* file = fopen(filename, "rb");
     if (!file) return NULL;
 
@@ -210,63 +1122,344 @@ Blockchain* load_blockchain(const char* filename) {
         return NULL;
     }
 
-    Blockchain* chain = create_blockchain(difficulty);
+    // Size the arena for the most blocks the file could hold
+    long file_size = -1;
+    if (fseek(file, 0, SEEK_END) == 0) file_size = ftell(file);
+    if (fseek(file, sizeof(int), SEEK_SET) != 0) {
+        fclose(file);
+        return NULL;
+    }
+    size_t expected_blocks = 0;
+    if (file_size > (long)sizeof(int))
+        expected_blocks = ((size_t)file_size - sizeof(int)) / MIN_SAVED_BLOCK_SIZE;
+
+    Blockchain* chain = new_blockchain(difficulty, expected_blocks);
     if (!chain) {
         fclose(file);
         return NULL;
     }
 
-    // Read blocks
     Block* current = chain->genesis;
-    while (!feof(file)) {
-        size_t read_size;
-        
-        read_size = fread(&current->index, sizeof(uint32_t), 1, file);
-        if (read_size != 1) break;
-        
-        read_size = fread(&current->timestamp, sizeof(time_t), 1, file);
-        if (read_size != 1) break;
-        
-        read_size = fread(&current->transaction_count, sizeof(int), 1, file);
-        if (read_size != 1) break;
-        
-        read_size = fread(current->transactions, sizeof(Transaction), current->transaction_count, file);
-        if (read_size != current->transaction_count) break;
-        
-        read_size = fread(current->previous_hash, sizeof(uint8_t), SHA256_DIGEST_SIZE, file);
-        if (read_size != SHA256_DIGEST_SIZE) break;
-        
-        read_size = fread(current->hash, sizeof(uint8_t), SHA256_DIGEST_SIZE, file);
-        if (read_size != SHA256_DIGEST_SIZE) break;
-
-        // Check if we've reached the end of the file
-        if (feof(file)) break;
-
-        // Create next block
-        Block* next = create_block();
-        if (!next) {
-            free_blockchain(chain);
-            fclose(file);
-            return NULL;
+    Block* previous = NULL;
+    uint8_t stored_previous[SHA256_DIGEST_SIZE];  // the previous block's hash as the file has it
+    int ok;
+    for (;;) {
+        int transaction_count;
+        ok = fread(&current->index, sizeof(uint32_t), 1, file) == 1 &&
+             fread(&current->timestamp, sizeof(time_t), 1, file) == 1 &&
+             fread(&transaction_count, sizeof(int), 1, file) == 1 &&
+             transaction_count >= 0 && reserve_transactions(current, transaction_count);
+        if (!ok) break;
+
+        SHA256_CTX ctx;
+        sha256_init(&ctx);
+        sha256_update(&ctx, (const uint8_t*)&current->index, sizeof(current->index));
+        sha256_update(&ctx, (const uint8_t*)&current->timestamp, sizeof(current->timestamp));
+        for (int i = 0; i < transaction_count && ok; i++) {
+            ChainFileNamedTransaction stored;
+            ok = fread(&stored, sizeof(stored), 1, file) == 1 &&
+                 memchr(stored.sender, '\0', sizeof(stored.sender)) &&
+                 memchr(stored.receiver, '\0', sizeof(stored.receiver)) &&
+                 chainfile_read_named_transactions(&stored, 1, &current->transactions[i]);
+            if (ok) hash_legacy_transaction(&ctx, &stored);
         }
 
+        uint8_t previous_hash[SHA256_DIGEST_SIZE], hash[SHA256_DIGEST_SIZE], expected[SHA256_DIGEST_SIZE];
+        ok = ok && fread(previous_hash, 1, SHA256_DIGEST_SIZE, file) == SHA256_DIGEST_SIZE &&
+             fread(hash, 1, SHA256_DIGEST_SIZE, file) == SHA256_DIGEST_SIZE;
+        if (!ok) break;
+        current->transaction_count = transaction_count;
+        sha256_update(&ctx, previous_hash, SHA256_DIGEST_SIZE);
+        sha256_final(&ctx, expected);
+
+        ok = memcmp(expected, hash, SHA256_DIGEST_SIZE) == 0 &&
+             (!previous || memcmp(previous_hash, stored_previous, SHA256_DIGEST_SIZE) == 0);
+        if (!ok) break;
+        memcpy(stored_previous, hash, SHA256_DIGEST_SIZE);
+
+        // Re-derive the hash and link under the current scheme
+        memcpy(current->previous_hash, previous ? previous->hash : previous_hash, SHA256_DIGEST_SIZE);
+        ok = rebuild_tx_tree(current) && mine_block(current, difficulty, 0);
+        if (!ok) break;
+
+        // Stop unless another block follows
+        int c = fgetc(file);
+        if (c == EOF) break;
+        ungetc(c, file);
+
+        Block* next = alloc_chain_block(chain);
+        ok = next && seal_tip(chain) && index_block(chain, next);
+        if (!ok) break;
+        shrink_block(current);
+
         current->next = next;
+        previous = current;
         current = next;
         chain->latest = current;
+        publish_sealed(chain);
     }
 
     fclose(file);
+    if (!ok) {
+        free_blockchain(chain);
+        return NULL;
+    }
+    METRIC_ADD(METRIC_LOAD_BYTES, file_size > 0 ? file_size : 0);
+    index_tip_transactions(chain);
     return chain;
 }
 
+// Copies a block record out of the mapping into a chain-owned block
+static int load_record(Block* block, const ChainFileBlock* record, const Transaction* transactions) {
+    block->index = record->index;
+    block->timestamp = (time_t)record->timestamp;
+    block->nonce = record->nonce;
+    memcpy(block->previous_hash, record->previous_hash, SHA256_DIGEST_SIZE);
+    memcpy(block->hash, record->hash, SHA256_DIGEST_SIZE);
+
+    int count = (int)record->transaction_count;
+    if (!reserve_transactions(block, count)) return 0;
+    if (count > 0) memcpy(block->transactions, transactions, (size_t)count * sizeof(Transaction));
+    block->transaction_count = count;
+    return rebuild_tx_tree(block);
+}
+
+// Adds the stored block at height to a chain being loaded; height 0 fills
+// in the genesis block new_blockchain made
+static int append_loaded_block(Blockchain* chain, size_t height, const ChainFileBlock* record,
+                               const Transaction* transactions) {
+    Block* block = chain->latest;
+
+    if (height > 0) {
+        block = alloc_chain_block(chain);
+        if (!block || !seal_tip(chain) || !index_block(chain, block)) return 0;
+        shrink_block(chain->latest);
+        chain->latest->next = block;
+        chain->latest = block;
+        publish_sealed(chain);
+    }
+    return load_record(block, record, transactions);
+}
+
+// The header gives the exact block count, so the arena and the height
+// index are sized once up front
+static Blockchain* load_mapped_blockchain(const char* filename) {
+    ChainFile* file = chainfile_open(filename);
+    if (!file) return NULL;
+
+    size_t count = chainfile_block_count(file);
+    Blockchain* chain = count > 0 ? new_blockchain(chainfile_difficulty(file), count) : NULL;
+    if (!chain) {
+        chainfile_close(file);
+        return NULL;
+    }
+
+    // Records are copied as they lie unless the file's account IDs differ
+    // from the process's; then each block's go through a scratch array
+    Transaction* scratch = NULL;
+    size_t capacity = 0;
+    for (size_t h = 0; h < count; h++) {
+        const ChainFileTransaction* stored;
+        const ChainFileBlock* record = chainfile_record(file, h, &stored);
+        int ok = record != NULL;
+        if (ok && !file->names.identity && record->transaction_count > capacity) {
+            Transaction* grown = (Transaction*)realloc(scratch, record->transaction_count * sizeof(Transaction));
+            ok = grown != NULL;
+            if (ok) {
+                scratch = grown;
+                capacity = record->transaction_count;
+            }
+        }
+        const Transaction* transactions =
+            ok ? chainfile_transactions(&file->names, stored, record->transaction_count, scratch) : NULL;
+        if (!transactions || !append_loaded_block(chain, h, record, transactions)) {
+            free(scratch);
+            free_blockchain(chain);
+            chainfile_close(file);
+            return NULL;
+        }
+    }
+    free(scratch);
+
+    // The checkpoint is only kept if it names a block that is really there
+    uint64_t checkpoint_height;
+    uint8_t checkpoint_hash[SHA256_DIGEST_SIZE];
+    if (chainfile_checkpoint(file, &checkpoint_height, checkpoint_hash) &&
+        memcmp(chain->blocks[checkpoint_height]->hash, checkpoint_hash, SHA256_DIGEST_SIZE) == 0) {
+        chain->checkpoint_height = (long)checkpoint_height;
+        memcpy(chain->checkpoint_hash, checkpoint_hash, SHA256_DIGEST_SIZE);
+    }
+
+    METRIC_ADD(METRIC_LOAD_BYTES, file->size);
+    chainfile_close(file);
+    index_tip_transactions(chain);
+    return chain;
+}
+
+typedef struct {
+    Blockchain* chain;
+    size_t count;
+} LogReplay;
+
+static int replay_logged_block(void* context, const ChainFileBlock* record, const Transaction* transactions) {
+    LogReplay* replay = (LogReplay*)context;
+
+    if (!append_loaded_block(replay->chain, replay->count, record, transactions)) return 0;
+    replay->count++;
+    return 1;
+}
+
+// Pack files are decoded block by block through the same path as the log
+static Blockchain* load_packed_blockchain(const char* filename) {
+    ChainPack* pack = chainpack_open(filename);
+    if (!pack) return NULL;
+
+    LogReplay replay;
+    replay.chain = pack->block_count > 0 ? new_blockchain(pack->difficulty, pack->block_count) : NULL;
+    replay.count = 0;
+    if (!replay.chain || !chainpack_read(pack, replay_logged_block, &replay)) {
+        free_blockchain(replay.chain);
+        chainpack_close(pack);
+        return NULL;
+    }
+
+    Blockchain* chain = replay.chain;
+    if (pack->has_checkpoint && pack->checkpoint_height < chain->block_count &&
+        memcmp(chain->blocks[pack->checkpoint_height]->hash, pack->checkpoint_hash, SHA256_DIGEST_SIZE) == 0) {
+        chain->checkpoint_height = (long)pack->checkpoint_height;
+        memcpy(chain->checkpoint_hash, pack->checkpoint_hash, SHA256_DIGEST_SIZE);
+    }
+
+    chainpack_close(pack);
+    index_tip_transactions(chain);
+    return chain;
+}
+
+// Reads any file version, or a pack file
+Blockchain* load_blockchain(const char* filename) {
+    if (!filename) return NULL;
+
+    METRIC_TIMER_START(timer);
+    Blockchain* chain;
+    if (chainfile_is_chainfile(filename))
+        chain = load_mapped_blockchain(filename);
+    else if (chainpack_is_chainpack(filename))
+        chain = load_packed_blockchain(filename);
+    else
+        chain = load_legacy_blockchain(filename);
+    METRIC_TIMER_STOP(METRIC_LOAD_LATENCY, timer);
+    return chain;
+}
+
+// Loads a chain and validates it, starting after its checkpoint unless
+// force_full is set. Returns NULL if the file cannot be read or a block is
+// bad; first_invalid gets the bad block's height, or -1.
+Blockchain* load_verified_blockchain(const char* filename, const ValidationOptions* options, int force_full,
+                                     long* first_invalid) {
+    if (first_invalid) *first_invalid = -1;
+
+    Blockchain* chain = load_blockchain(filename);
+    if (!chain) return NULL;
+
+    ValidationOptions validation = { 1, 0, 0 };
+    if (options) validation = *options;
+    validation.from_checkpoint = !force_full;
+
+    if (!validate_chain_parallel(chain, &validation, first_invalid)) {
+        free_blockchain(chain);
+        return NULL;
+    }
+    return chain;
+}
+
+// Rebuilds the chain from the log, or starts a new one if the log is
+// empty. From then on add_block appends each block it seals. The tip is
+// only logged once a block follows it, as until then it may still change;
+// every logged block was sealed, so a replayed chain gets a new empty tip.
+Blockchain* open_blockchain_log(const char* filename, int difficulty, const ChainLogOptions* options) {
+    ChainLog* log = chainlog_open(filename, difficulty, options);
+    if (!log) return NULL;
+
+    LogReplay replay;
+    replay.chain = new_blockchain(log->difficulty, 0);
+    replay.count = 0;
+    if (!replay.chain || !chainlog_replay(log, replay_logged_block, &replay)) {
+        free_blockchain(replay.chain);
+        chainlog_close(log);
+        return NULL;
+    }
+
+    Blockchain* chain = replay.chain;
+    chain->log = log;
+    chain->logged_blocks = replay.count;
+    if (replay.count == 0) {
+        calculate_block_hash(chain->genesis);
+        return chain;
+    }
+
+    // The last logged block is sealed again, which does not log it twice
+    add_block(chain);
+    if (chain->block_count != replay.count + 1) {
+        free_blockchain(chain);
+        return NULL;
+    }
+    return chain;
+}
+
+// Forces every block logged so far to disk, whatever the sync policy
+int sync_blockchain_log(Blockchain* chain) {
+    if (!chain) return 0;
+    if (chain->writer && !chainwriter_flush(chain->writer)) return 0;
+
+    return chain->log ? chainlog_sync(chain->log) : 1;
+}
+
+// Hands the log's writes to a background thread (chainwriter.h), so that
+// add_block no longer waits on the disk. The log's sync policy no longer
+// applies; each batch the thread writes is synced unless options skip it.
+int start_background_log(Blockchain* chain, const ChainWriterOptions* options) {
+    if (!chain || !chain->log) return 0;
+    if (chain->writer) return 1;
+
+    chain->writer = chainwriter_start(chain->log, chain->logged_blocks, options);
+    return chain->writer != NULL;
+}
+
+// Waits until the block at height is on disk. Returns 0 if it has not
+// been sealed into the log yet or could not be written.
+int wait_until_durable(Blockchain* chain, size_t height) {
+    if (!chain || !chain->log || height >= chain->logged_blocks) return 0;
+    if (chain->writer) return chainwriter_wait(chain->writer, height);
+
+    return chainlog_sync(chain->log);
+}
+
 void free_blockchain(Blockchain* chain) {
     if (!chain) return;
 
-    Block* current = chain->genesis;
-    while (current) {
-        Block* next = current->next;
-        free(current);
-        current = next;
+    // The writer finishes its last batch before the log is closed
+    chainwriter_stop(chain->writer);
+    chainlog_close(chain->log);
+
+    // No reader may be left, so the view goes along with anything retired
+    epoch_free(chain->readers);
+    ChainView* view = atomic_load_explicit(&chain->view, memory_order_relaxed);
+    if (view) {
+        view->release_blocks = view->blocks != chain->blocks;
+        view->release_entries = view->block_hash_index.entries != chain->block_hash_index.entries;
+        release_view(view);
     }
+
+    // Blocks sit contiguously in the arena, so release them chunk by chunk
+    // rather than chasing next pointers
+    arena_for_each(&chain->block_arena, release_block);
+    arena_free(&chain->block_arena);
+    free(chain->blocks);
+    hash_index_free(&chain->block_hash_index);
+    hash_index_free(&chain->tx_hash_index);
+    ledger_free(&chain->ledger);
+    ledger_free(&chain->tx_nonces);
+    txcolumns_free(chain->columns);
+    free(chain->columns);
     free(chain);
 } 
\ No newline at end of file
@@ -7,15 +7,28 @@
 #include <stdlib.h>
 #include <string.h>
 #include "sha256.h"
+#include "merkle.h"
+#include "arena.h"
+#include "hashindex.h"
+#include "accounts.h"
+#include "ledger.h"
+#include "epoch.h"
 
-#define MAX_TRANSACTIONS 100
 #define MAX_DATA_SIZE 1024
 #define MAX_TRANSACTION_SIZE 256
+#define MAX_DIFFICULTY (SHA256_DIGEST_SIZE * 8)
+// transaction_capacity of a block whose transactions it does not own,
+// such as one read from a mapped chain file; such blocks are read-only
+#define TRANSACTIONS_BORROWED (-1)
+// What get_account and submit_transaction return, in place of 1, once the
+// ledger has had to leave out a transaction that overspends
+#define LEDGER_SKIPPED 2
 
-// Transaction structure
+// Transaction structure. Accounts are interned IDs (accounts.h); the names
+// are looked up only to print or hash a transaction.
 typedef struct {
-    char sender[64];
-    char receiver[64];
+    AccountId sender;
+    AccountId receiver;
     double amount;
     time_t timestamp;
 } Transaction;
@@ -24,31 +37,133 @@ typedef struct {
 typedef struct Block {
     uint32_t index;
     time_t timestamp;
-    Transaction transactions[MAX_TRANSACTIONS];
+    Transaction* transactions;  // heap array sized to what the block holds
     int transaction_count;
+    int transaction_capacity;
+    MerkleTree tx_tree;  // the block commits to tx_tree.root
     uint8_t previous_hash[SHA256_DIGEST_SIZE];
+    uint64_t nonce;
     uint8_t hash[SHA256_DIGEST_SIZE];
     struct Block* next;
 } Block;
 
+// What readers on other threads find blocks through. A view is never
+// changed; when the height index or the hash index moves, the writer
+// publishes a new view and retires the old one.
+typedef struct {
+    Block** blocks;
+    HashIndex block_hash_index;
+    int release_blocks;   // set when retired: blocks went with this view
+    int release_entries;  // likewise block_hash_index.entries
+} ChainView;
+
 // Blockchain structure
 typedef struct {
     Block* genesis;
     Block* latest;
-    int difficulty;
+    int difficulty;  // required leading zero bits in every block hash
+    Arena block_arena;  // owns every Block in the chain
+    Block** blocks;     // height index: blocks[i] is the block at height i
+    size_t block_count;
+    size_t block_capacity;
+    HashIndex block_hash_index;  // block hash -> height, for sealed blocks
+    HashIndex tx_hash_index;     // transaction ID -> height << 32 | position
+    Ledger tx_nonces;  // transfers indexed so far per sender, for transaction IDs
+    int indexed_tip_transactions;
+    long checkpoint_height;  // last block a full validation vouched for, -1 if none
+    uint8_t checkpoint_hash[SHA256_DIGEST_SIZE];
+    struct ChainLog* log;  // append-only log of sealed blocks, if any
+    size_t logged_blocks;  // heights below this are already in the log
+    struct ChainWriter* writer;  // writes the log on a background thread, if started
+    Ledger ledger;  // account balances after every transaction applied so far
+    size_t ledger_height;  // height of the block the ledger is applying
+    int ledger_tip_transactions;  // transactions of that block already applied
+    long ledger_first_invalid;  // height of the first overspending block, -1 if none
+    size_t ledger_skipped;  // overspending transactions the ledger left out
+    struct TxColumns* columns;  // columnar copy of the transactions, if enabled
+    // Readers on other threads see the sealed blocks, every one below the
+    // tip, through these; they are written only by the thread adding blocks
+    _Atomic(ChainView*) view;
+    atomic_size_t published_count;
+    EpochDomain* readers;
 } Blockchain;
 
+// A reader's consistent picture of the chain: the blocks that were sealed
+// when it was taken. The writer may keep appending meanwhile; everything
+// reached through the snapshot stays valid until release_snapshot.
+typedef struct {
+    Blockchain* chain;
+    int reader;
+    const ChainView* view;
+    size_t count;  // heights 0 to count - 1
+    Block* tip;    // the last of them, or NULL if count is 0
+} ChainSnapshot;
+
+struct ChainLogOptions;
+struct ChainWriterOptions;
+struct ChainPackOptions;
+struct TxColumns;
+
+// Parallel validation settings
+typedef struct {
+    int num_threads;    // worker threads; 1 or less validates on the caller's thread
+    size_t chunk_size;  // blocks per work item; 0 picks one from the chain length
+    int from_checkpoint;  // only check blocks after the chain's checkpoint
+} ValidationOptions;
+
 // Function declarations
 Blockchain* create_blockchain(int difficulty);
 Block* create_block();
 int add_transaction(Block* block, const char* sender, const char* receiver, double amount);
+int reserve_transactions(Block* block, int capacity);
+int submit_transaction(Blockchain* chain, const char* sender, const char* receiver, double amount);
+int submit_transactions(Blockchain* chain, const Transaction* txs, int count);
+int get_account(Blockchain* chain, const char* name, double* balance, uint64_t* nonce);
+int enable_transaction_columns(Blockchain* chain);
+const struct TxColumns* get_transaction_columns(Blockchain* chain);
+void transaction_leaf_hash(const Transaction* tx, uint8_t hash[]);
+void transaction_id(const Transaction* tx, uint64_t sender_nonce, uint8_t id[]);
+int get_transaction_proof(const Block* block, int tx_index, MerkleProof* proof);
+int verify_transaction_proof(const uint8_t merkle_root[], const Transaction* tx, const MerkleProof* proof);
+// The tip is mined once, when it is full: mine_tip after its last
+// transaction, then add_block to seal it. add_block mines a tip whose hash
+// misses the target or no longer matches its transactions. Until it is
+// sealed, validation holds the tip to its contents but not the target.
+int mine_tip(Blockchain* chain);
 void add_block(Blockchain* chain);
+Block* get_block_by_index(const Blockchain* chain, size_t index);
+size_t get_block_count(const Blockchain* chain);
+Block* find_block_by_hash(const Blockchain* chain, const uint8_t hash[]);
+Transaction* find_transaction(Blockchain* chain, const uint8_t id[], Block** block);
 void calculate_block_hash(Block* block);
+void compute_merkle_root(const Block* block, uint8_t root[]);
+void compute_block_hash(const Block* block, const uint8_t merkle_root[], uint8_t hash[]);
+int verify_block(const Block* block, const uint8_t previous_hash[], int difficulty);
+int hash_meets_difficulty(const uint8_t hash[], int difficulty);
+int mine_block(Block* block, int difficulty, int num_threads);
 int validate_chain(Blockchain* chain);
+int validate_chain_parallel(Blockchain* chain, const ValidationOptions* options, long* first_invalid);
+size_t block_memory_usage(const Block* block);
+void fprint_block(FILE* out, const Block* block);
 void print_block(Block* block);
 void print_blockchain(Blockchain* chain);
 int save_blockchain(Blockchain* chain, const char* filename);
+int save_compact_blockchain(Blockchain* chain, const char* filename, const struct ChainPackOptions* options);
 Blockchain* load_blockchain(const char* filename);
+Blockchain* load_verified_blockchain(const char* filename, const ValidationOptions* options, int force_full,
+                                     long* first_invalid);
+Blockchain* open_blockchain_log(const char* filename, int difficulty, const struct ChainLogOptions* options);
+int sync_blockchain_log(Blockchain* chain);
+int start_background_log(Blockchain* chain, const struct ChainWriterOptions* options);
+int wait_until_durable(Blockchain* chain, size_t height);
+int register_reader(Blockchain* chain);
+void unregister_reader(Blockchain* chain, int reader);
+size_t read_snapshot(Blockchain* chain, int reader, ChainSnapshot* snapshot);
+void release_snapshot(ChainSnapshot* snapshot);
+Block* snapshot_block(const ChainSnapshot* snapshot, size_t height);
+Block* snapshot_next(const ChainSnapshot* snapshot, const Block* block);
+Block* snapshot_find_block(const ChainSnapshot* snapshot, const uint8_t hash[]);
+int validate_snapshot(const ChainSnapshot* snapshot);
 void free_blockchain(Blockchain* chain);
 
 #endif // BLOCKCHAIN_H 
\ No newline at end of file
@@ -0,0 +1,437 @@
+#include "chainexport.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+// Most bytes a block's own fields or one transaction can take in any
+// format: two names escaped at 6 bytes per byte, and a %.2f amount of up
+// to 309 integer digits
+#define BLOCK_TEXT_MAX 512
+#define TRANSACTION_TEXT_MAX 2048
+#define SLICES_PER_THREAD 4
+// Below this, amounts that are whole cents print as cents
+#define CENTS_LIMIT 1e15
+
+#define PUT_LITERAL(p, s) (memcpy((p), (s), sizeof(s) - 1), (p) + sizeof(s) - 1)
+
+static const char DIGIT_PAIRS[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static const char HEX_PAIRS[] =
+    "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f"
+    "202122232425262728292a2b2c2d2e2f303132333435363738393a3b3c3d3e3f"
+    "404142434445464748494a4b4c4d4e4f505152535455565758595a5b5c5d5e5f"
+    "606162636465666768696a6b6c6d6e6f707172737475767778797a7b7c7d7e7f"
+    "808182838485868788898a8b8c8d8e8f909192939495969798999a9b9c9d9e9f"
+    "a0a1a2a3a4a5a6a7a8a9aaabacadaeafb0b1b2b3b4b5b6b7b8b9babbbcbdbebf"
+    "c0c1c2c3c4c5c6c7c8c9cacbcccdcecfd0d1d2d3d4d5d6d7d8d9dadbdcdddedf"
+    "e0e1e2e3e4e5e6e7e8e9eaebecedeeeff0f1f2f3f4f5f6f7f8f9fafbfcfdfeff";
+
+// Output gathered before it is written. With out set, a full buffer is
+// written out; without, it grows to hold everything put in it.
+typedef struct {
+    char* data;
+    size_t used;
+    size_t capacity;
+    FILE* out;
+    uint64_t written;
+    int failed;
+} ExportBuffer;
+
+static int buffer_flush(ExportBuffer* buffer) {
+    if (buffer->used > 0 && fwrite(buffer->data, 1, buffer->used, buffer->out) != buffer->used) {
+        buffer->failed = 1;
+        return 0;
+    }
+    buffer->written += buffer->used;
+    buffer->used = 0;
+    return 1;
+}
+
+// Where the next n bytes go, or NULL if there is no room for them
+static char* buffer_space(ExportBuffer* buffer, size_t n) {
+    if (buffer->failed) return NULL;
+    if (buffer->capacity - buffer->used >= n) return buffer->data + buffer->used;
+    if (buffer->out && !buffer_flush(buffer)) return NULL;
+
+    if (buffer->capacity - buffer->used < n) {
+        size_t capacity = buffer->capacity ? buffer->capacity : n;
+        while (capacity - buffer->used < n) capacity *= 2;
+        char* data = (char*)realloc(buffer->data, capacity);
+        if (!data) {
+            buffer->failed = 1;
+            return NULL;
+        }
+        buffer->data = data;
+        buffer->capacity = capacity;
+    }
+    return buffer->data + buffer->used;
+}
+
+static char* put_u64(char* p, uint64_t value) {
+    char digits[20];
+    char* d = digits + sizeof(digits);
+
+    while (value >= 100) {
+        d -= 2;
+        memcpy(d, DIGIT_PAIRS + value % 100 * 2, 2);
+        value /= 100;
+    }
+    if (value >= 10) {
+        d -= 2;
+        memcpy(d, DIGIT_PAIRS + value * 2, 2);
+    } else {
+        *--d = (char)('0' + value);
+    }
+
+    size_t n = (size_t)(digits + sizeof(digits) - d);
+    memcpy(p, d, n);
+    return p + n;
+}
+
+static char* put_i64(char* p, int64_t value) {
+    if (value >= 0) return put_u64(p, (uint64_t)value);
+    *p++ = '-';
+    return put_u64(p, 0 - (uint64_t)value);
+}
+
+static char* put_hex(char* p, const uint8_t hash[]) {
+    for (int i = 0; i < SHA256_DIGEST_SIZE; i++) {
+        memcpy(p, HEX_PAIRS + hash[i] * 2, 2);
+        p += 2;
+    }
+    return p;
+}
+
+// printf's %.2f: the exact binary value rounded to cents, ties to even.
+// The value is mantissa * 2^shift, so the cents are mantissa * 100 shifted,
+// with the bits shifted out deciding the rounding. Values too large for
+// that to fit in 64 bits, and infinities and NaNs, go to snprintf.
+static char* put_fixed2(char* p, double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    int exponent = (int)(bits >> 52 & 0x7ff);
+    uint64_t mantissa = bits & ((1ULL << 52) - 1);
+
+    if (exponent == 0x7ff || exponent - 1075 > 3) return p + snprintf(p, TRANSACTION_TEXT_MAX / 4, "%.2f", value);
+    if (exponent) mantissa |= 1ULL << 52;
+    else exponent = 1;
+
+    int shift = exponent - 1075;
+    uint64_t scaled = mantissa * 100, cents = 0;
+    if (shift >= 0) {
+        cents = scaled << shift;
+    } else if (shift > -64) {
+        uint64_t rest = scaled & ((1ULL << -shift) - 1), half = 1ULL << (-shift - 1);
+        cents = scaled >> -shift;
+        if (rest > half || (rest == half && (cents & 1))) cents++;
+    }
+
+    if (bits >> 63) *p++ = '-';
+    p = put_u64(p, cents / 100);
+    *p++ = '.';
+    memcpy(p, DIGIT_PAIRS + cents % 100 * 2, 2);
+    return p + 2;
+}
+
+// An amount that parses back to the same double, or null in JSON when it
+// is not finite
+static char* put_exact_amount(char* p, double amount, int json) {
+    if (amount > -CENTS_LIMIT && amount < CENTS_LIMIT) {
+        double scaled = amount * 100;
+        int64_t cents = (int64_t)(scaled < 0 ? scaled - 0.5 : scaled + 0.5);
+        double decoded = (double)cents / 100.0;
+        if (memcmp(&decoded, &amount, sizeof(amount)) == 0) return put_fixed2(p, amount);
+    }
+    if (json && !isfinite(amount)) return PUT_LITERAL(p, "null");
+    return p + snprintf(p, 32, "%.17g", amount);
+}
+
+static char* put_text_name(char* p, AccountId id) {
+    size_t length;
+    const char* name = account_name(id, &length);
+    if (!name) return PUT_LITERAL(p, "(null)");
+
+    memcpy(p, name, length);
+    return p + length;
+}
+
+static char* put_json_name(char* p, AccountId id) {
+    size_t length;
+    const char* name = account_name(id, &length);
+    if (!name) return PUT_LITERAL(p, "null");
+
+    *p++ = '"';
+    for (size_t i = 0; i < length; i++) {
+        uint8_t c = (uint8_t)name[i];
+        if (c == '"' || c == '\\') {
+            *p++ = '\\';
+            *p++ = (char)c;
+        } else if (c < 0x20) {
+            p = PUT_LITERAL(p, "\\u00");
+            memcpy(p, HEX_PAIRS + c * 2, 2);
+            p += 2;
+        } else {
+            *p++ = (char)c;
+        }
+    }
+    *p++ = '"';
+    return p;
+}
+
+static char* put_csv_name(char* p, AccountId id) {
+    size_t length;
+    const char* name = account_name(id, &length);
+    if (!name) return p;
+    if (strcspn(name, ",\"\r\n") == length) {
+        memcpy(p, name, length);
+        return p + length;
+    }
+
+    *p++ = '"';
+    for (size_t i = 0; i < length; i++) {
+        if (name[i] == '"') *p++ = '"';
+        *p++ = name[i];
+    }
+    *p++ = '"';
+    return p;
+}
+
+static char* put_text_block(char* p, const Block* block) {
+    p = PUT_LITERAL(p, "\nBlock #");
+    p = put_u64(p, block->index);
+    p = PUT_LITERAL(p, "\nTimestamp: ");
+    p = put_i64(p, (int64_t)block->timestamp);
+    p = PUT_LITERAL(p, "\nNonce: ");
+    p = put_u64(p, block->nonce);
+    p = PUT_LITERAL(p, "\nPrevious Hash: ");
+    p = put_hex(p, block->previous_hash);
+    p = PUT_LITERAL(p, "\nHash: ");
+    p = put_hex(p, block->hash);
+    return PUT_LITERAL(p, "\nTransactions:\n");
+}
+
+static char* put_text_transaction(char* p, const Transaction* tx, int position) {
+    p = PUT_LITERAL(p, "  ");
+    p = put_u64(p, (uint64_t)position + 1);
+    p = PUT_LITERAL(p, ". ");
+    p = put_text_name(p, tx->sender);
+    p = PUT_LITERAL(p, " -> ");
+    p = put_text_name(p, tx->receiver);
+    p = PUT_LITERAL(p, ": ");
+    p = put_fixed2(p, tx->amount);
+    *p++ = '\n';
+    return p;
+}
+
+static char* put_json_block(char* p, const Block* block) {
+    p = PUT_LITERAL(p, "{\"index\":");
+    p = put_u64(p, block->index);
+    p = PUT_LITERAL(p, ",\"timestamp\":");
+    p = put_i64(p, (int64_t)block->timestamp);
+    p = PUT_LITERAL(p, ",\"nonce\":");
+    p = put_u64(p, block->nonce);
+    p = PUT_LITERAL(p, ",\"previous_hash\":\"");
+    p = put_hex(p, block->previous_hash);
+    p = PUT_LITERAL(p, "\",\"hash\":\"");
+    p = put_hex(p, block->hash);
+    return PUT_LITERAL(p, "\",\"transactions\":[");
+}
+
+static char* put_json_transaction(char* p, const Transaction* tx, int position) {
+    if (position > 0) *p++ = ',';
+    p = PUT_LITERAL(p, "{\"sender\":");
+    p = put_json_name(p, tx->sender);
+    p = PUT_LITERAL(p, ",\"receiver\":");
+    p = put_json_name(p, tx->receiver);
+    p = PUT_LITERAL(p, ",\"amount\":");
+    p = put_exact_amount(p, tx->amount, 1);
+    p = PUT_LITERAL(p, ",\"timestamp\":");
+    p = put_i64(p, (int64_t)tx->timestamp);
+    *p++ = '}';
+    return p;
+}
+
+static char* put_csv_transaction(char* p, const Block* block, const Transaction* tx, int position) {
+    p = put_u64(p, block->index);
+    *p++ = ',';
+    p = put_u64(p, (uint64_t)position);
+    *p++ = ',';
+    p = put_i64(p, (int64_t)tx->timestamp);
+    *p++ = ',';
+    p = put_csv_name(p, tx->sender);
+    *p++ = ',';
+    p = put_csv_name(p, tx->receiver);
+    *p++ = ',';
+    p = put_exact_amount(p, tx->amount, 0);
+    *p++ = '\n';
+    return p;
+}
+
+static int write_block(ExportBuffer* buffer, const Block* block, ChainExportFormat format) {
+    char* p = buffer_space(buffer, BLOCK_TEXT_MAX);
+    if (!p) return 0;
+    if (format == CHAINEXPORT_TEXT) p = put_text_block(p, block);
+    else if (format == CHAINEXPORT_JSONL) p = put_json_block(p, block);
+    buffer->used = (size_t)(p - buffer->data);
+
+    for (int i = 0; i < block->transaction_count; i++) {
+        const Transaction* tx = &block->transactions[i];
+        if (!(p = buffer_space(buffer, TRANSACTION_TEXT_MAX))) return 0;
+        if (format == CHAINEXPORT_TEXT) p = put_text_transaction(p, tx, i);
+        else if (format == CHAINEXPORT_JSONL) p = put_json_transaction(p, tx, i);
+        else p = put_csv_transaction(p, block, tx, i);
+        buffer->used = (size_t)(p - buffer->data);
+    }
+
+    if (format == CHAINEXPORT_CSV) return 1;
+    if (!(p = buffer_space(buffer, 4))) return 0;
+    p = format == CHAINEXPORT_TEXT ? PUT_LITERAL(p, "\n") : PUT_LITERAL(p, "]}\n");
+    buffer->used = (size_t)(p - buffer->data);
+    return 1;
+}
+
+// One round of threaded export: slice s holds the blocks from
+// first + s * slice_blocks, formatted into its own growing buffer
+typedef struct {
+    Block* const* blocks;
+    size_t first;
+    size_t end;
+    size_t slice_blocks;
+    ChainExportFormat format;
+    ExportBuffer* slices;
+    int slice_count;
+    atomic_int next_slice;
+    atomic_int failed;
+} ExportJob;
+
+static void* export_worker(void* arg) {
+    ExportJob* job = (ExportJob*)arg;
+
+    for (;;) {
+        int s = atomic_fetch_add(&job->next_slice, 1);
+        if (s >= job->slice_count || atomic_load(&job->failed)) break;
+
+        size_t start = job->first + (size_t)s * job->slice_blocks;
+        size_t stop = start + job->slice_blocks < job->end ? start + job->slice_blocks : job->end;
+        for (size_t h = start; h < stop; h++) {
+            if (!write_block(&job->slices[s], job->blocks[h], job->format)) {
+                atomic_store(&job->failed, 1);
+                break;
+            }
+        }
+    }
+    return NULL;
+}
+
+// Formats num_threads * SLICES_PER_THREAD slices at a time, then writes
+// them out in order through the caller's buffer
+static int write_threaded(ExportBuffer* buffer, Block* const* blocks, size_t count, ChainExportFormat format,
+                          int num_threads, size_t slice_blocks) {
+    int slice_count = num_threads * SLICES_PER_THREAD;
+    ExportBuffer* slices = (ExportBuffer*)calloc((size_t)slice_count, sizeof(ExportBuffer));
+    pthread_t* threads = (pthread_t*)malloc((size_t)(num_threads - 1) * sizeof(pthread_t));
+    int ok = slices && threads && buffer_flush(buffer);
+
+    ExportJob job;
+    job.blocks = blocks;
+    job.end = count;
+    job.slice_blocks = slice_blocks;
+    job.format = format;
+    job.slices = slices;
+    job.slice_count = slice_count;
+    for (size_t first = 0; ok && first < count; first += (size_t)slice_count * slice_blocks) {
+        job.first = first;
+        atomic_init(&job.next_slice, 0);
+        atomic_init(&job.failed, 0);
+        for (int s = 0; s < slice_count; s++) slices[s].used = 0;
+
+        int started = 0;
+        for (; started < num_threads - 1; started++) {
+            if (pthread_create(&threads[started], NULL, export_worker, &job) != 0) break;
+        }
+        // The calling thread works too
+        export_worker(&job);
+        for (int i = 0; i < started; i++)
+            pthread_join(threads[i], NULL);
+
+        ok = !atomic_load(&job.failed);
+        for (int s = 0; ok && s < slice_count; s++) {
+            if (slices[s].used > 0 && fwrite(slices[s].data, 1, slices[s].used, buffer->out) != slices[s].used) {
+                ok = 0;
+                break;
+            }
+            buffer->written += slices[s].used;
+        }
+    }
+
+    for (int s = 0; slices && s < slice_count; s++) free(slices[s].data);
+    free(slices);
+    free(threads);
+    if (!ok) buffer->failed = 1;
+    return ok;
+}
+
+// Writes every block of the chain to out in the chosen format; NULL
+// options write text on the caller's thread. Returns 0 if a write fails.
+int chainexport_write(Blockchain* chain, FILE* out, const ChainExportOptions* options, uint64_t* bytes_written) {
+    if (bytes_written) *bytes_written = 0;
+    if (!chain || !out) return 0;
+
+    ChainExportFormat format = options ? options->format : CHAINEXPORT_TEXT;
+    int num_threads = options ? options->num_threads : 1;
+    size_t buffer_size = options && options->buffer_size ? options->buffer_size : CHAINEXPORT_DEFAULT_BUFFER_SIZE;
+    size_t slice_blocks = options && options->slice_blocks ? options->slice_blocks : CHAINEXPORT_DEFAULT_SLICE_BLOCKS;
+    if (format != CHAINEXPORT_TEXT && format != CHAINEXPORT_JSONL && format != CHAINEXPORT_CSV) return 0;
+
+    ExportBuffer buffer = { (char*)malloc(buffer_size), 0, buffer_size, out, 0, 0 };
+    if (!buffer.data) return 0;
+
+    if (format == CHAINEXPORT_CSV) {
+        char* p = buffer_space(&buffer, BLOCK_TEXT_MAX);
+        if (p) {
+            p = PUT_LITERAL(p, "block,position,timestamp,sender,receiver,amount\n");
+            buffer.used = (size_t)(p - buffer.data);
+        }
+    }
+
+    // Only worth threads when every thread gets a slice
+    Block* const* blocks = chain->blocks;
+    size_t count = chain->block_count;
+    if (num_threads > 1 && count > slice_blocks) {
+        write_threaded(&buffer, blocks, count, format, num_threads, slice_blocks);
+    } else {
+        for (size_t h = 0; h < count; h++)
+            if (!write_block(&buffer, blocks[h], format)) break;
+    }
+
+    int ok = !buffer.failed && buffer_flush(&buffer);
+    free(buffer.data);
+    if (bytes_written) *bytes_written = buffer.written;
+    return ok;
+}
+
+int chainexport_save(Blockchain* chain, const char* filename, const ChainExportOptions* options) {
+    FILE* file = filename ? fopen(filename, "wb") : NULL;
+    if (!file) return 0;
+
+    int ok = chainexport_write(chain, file, options, NULL);
+    if (fclose(file) != 0) ok = 0;
+    return ok;
+}
+
+const char* chainexport_format_name(ChainExportFormat format) {
+    switch (format) {
+    case CHAINEXPORT_TEXT:
+        return "text";
+    case CHAINEXPORT_JSONL:
+        return "jsonl";
+    case CHAINEXPORT_CSV:
+        return "csv";
+    }
+    return "unknown";
+}
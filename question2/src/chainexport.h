@@ -0,0 +1,47 @@
+#ifndef CHAINEXPORT_H
+#define CHAINEXPORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "blockchain.h"
+
+// Streaming export of every block, tip included, for indexers and other
+// tools. Output is built in large buffers with table-driven hex and
+// number formatting, and written with one fwrite per buffer.
+//
+//   text:  exactly what print_block prints for each block
+//   jsonl: one JSON object per block and line, with index, timestamp,
+//          nonce, previous_hash, hash and a transactions array of sender,
+//          receiver, amount and timestamp
+//   csv:   a header, then one row per transaction: block, position (from
+//          0), timestamp, sender, receiver, amount; fields holding a
+//          comma, quote or line break are quoted (RFC 4180)
+//
+// JSON and CSV amounts read back as the same double: whole cents print
+// with two decimals, anything else with 17 significant digits. Names are
+// written as stored; JSON escapes quotes, backslashes and control bytes.
+// An ID with no name prints as (null) in text, null in JSON and an empty
+// CSV field.
+#define CHAINEXPORT_DEFAULT_BUFFER_SIZE (1 << 20)
+#define CHAINEXPORT_DEFAULT_SLICE_BLOCKS 1024
+
+typedef enum {
+    CHAINEXPORT_TEXT = 0,
+    CHAINEXPORT_JSONL,
+    CHAINEXPORT_CSV
+} ChainExportFormat;
+
+typedef struct ChainExportOptions {
+    ChainExportFormat format;
+    int num_threads;      // formatting threads; 1 or less formats on the caller's thread
+    size_t buffer_size;   // bytes gathered per write; 0 for the default
+    size_t slice_blocks;  // blocks per unit of threaded work; 0 for the default
+} ChainExportOptions;
+
+// Function declarations
+int chainexport_write(Blockchain* chain, FILE* out, const ChainExportOptions* options, uint64_t* bytes_written);
+int chainexport_save(Blockchain* chain, const char* filename, const ChainExportOptions* options);
+const char* chainexport_format_name(ChainExportFormat format);
+
+#endif // CHAINEXPORT_H
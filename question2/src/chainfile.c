@@ -0,0 +1,519 @@
+#include "chainfile.h"
+#include "metrics.h"
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define RECORD_ALIGNMENT 8
+// Transactions converted at a time while writing records
+#define WRITE_CHUNK 256
+
+_Static_assert(sizeof(ChainFileHeader) == 64, "chain file header must stay 64 bytes");
+_Static_assert(sizeof(ChainFileBlock) % RECORD_ALIGNMENT == 0, "block records must keep 8-byte alignment");
+_Static_assert(sizeof(ChainFileNamedTransaction) == 144, "version 1 transactions must keep their layout");
+// Records are written from and read as Transaction arrays
+_Static_assert(sizeof(ChainFileTransaction) == sizeof(Transaction) &&
+               offsetof(ChainFileTransaction, sender) == offsetof(Transaction, sender) &&
+               offsetof(ChainFileTransaction, receiver) == offsetof(Transaction, receiver) &&
+               offsetof(ChainFileTransaction, amount) == offsetof(Transaction, amount) &&
+               offsetof(ChainFileTransaction, timestamp) == offsetof(Transaction, timestamp) &&
+               sizeof(time_t) == sizeof(int64_t), "stored transactions must match Transaction");
+
+int chainfile_is_chainfile(const char* filename) {
+    char magic[CHAINFILE_MAGIC_SIZE];
+
+    FILE* file = fopen(filename, "rb");
+    if (!file) return 0;
+
+    int match = fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+                memcmp(magic, CHAINFILE_MAGIC, CHAINFILE_MAGIC_SIZE) == 0;
+    fclose(file);
+    return match;
+}
+
+// Bytes a record takes in the file, padding included
+size_t chainfile_record_size(uint32_t transaction_count) {
+    size_t size = sizeof(ChainFileBlock) + (size_t)transaction_count * sizeof(ChainFileTransaction);
+    return (size + RECORD_ALIGNMENT - 1) / RECORD_ALIGNMENT * RECORD_ALIGNMENT;
+}
+
+void chainfile_fill_record(const Block* block, ChainFileBlock* record) {
+    memset(record, 0, sizeof(ChainFileBlock));
+    record->index = block->index;
+    record->transaction_count = (uint32_t)block->transaction_count;
+    record->timestamp = (int64_t)block->timestamp;
+    record->nonce = block->nonce;
+    memcpy(record->previous_hash, block->previous_hash, SHA256_DIGEST_SIZE);
+    memcpy(record->hash, block->hash, SHA256_DIGEST_SIZE);
+    memcpy(record->merkle_root, block->tx_tree.root, SHA256_DIGEST_SIZE);
+}
+
+// Fills in a block around a record and transactions it does not own; the
+// block is read-only and its Merkle tree holds only the stored root
+void chainfile_block_view(const ChainFileBlock* record, const Transaction* transactions, Block* block) {
+    memset(block, 0, sizeof(Block));
+    block->index = record->index;
+    block->timestamp = (time_t)record->timestamp;
+    block->transactions = (Transaction*)transactions;
+    block->transaction_count = (int)record->transaction_count;
+    block->transaction_capacity = TRANSACTIONS_BORROWED;
+    block->nonce = record->nonce;
+    memcpy(block->previous_hash, record->previous_hash, SHA256_DIGEST_SIZE);
+    memcpy(block->hash, record->hash, SHA256_DIGEST_SIZE);
+    merkle_init(&block->tx_tree);
+    merkle_set_root(&block->tx_tree, record->merkle_root, record->transaction_count);
+}
+
+static void copy_name(char* dst, AccountId id) {
+    size_t len = 0;
+    const char* name = account_name(id, &len);
+    memset(dst, 0, ACCOUNT_NAME_SIZE);
+    if (name) memcpy(dst, name, len);
+}
+
+void chainfile_fill_named_transaction(const Transaction* tx, ChainFileNamedTransaction* stored) {
+    copy_name(stored->sender, tx->sender);
+    copy_name(stored->receiver, tx->receiver);
+    stored->amount = tx->amount;
+    stored->timestamp = (int64_t)tx->timestamp;
+}
+
+// Converts version 1 transactions, interning their names; 0 if a name
+// could not be interned
+int chainfile_read_named_transactions(const ChainFileNamedTransaction* stored, size_t count, Transaction* txs) {
+    for (size_t i = 0; i < count; i++) {
+        txs[i].sender = account_intern(stored[i].sender);
+        txs[i].receiver = account_intern(stored[i].receiver);
+        if (txs[i].sender == ACCOUNT_NONE || txs[i].receiver == ACCOUNT_NONE) return 0;
+        txs[i].amount = stored[i].amount;
+        txs[i].timestamp = (time_t)stored[i].timestamp;
+    }
+    return 1;
+}
+
+void chainfile_free_names(ChainFileNames* names) {
+    if (!names) return;
+
+    free(names->ids);
+    names->ids = NULL;
+    names->count = 0;
+    names->identity = 1;
+}
+
+// Interns the count names of a name table; 0 if the table is cut short or
+// a name cannot be interned
+int chainfile_read_names(const uint8_t* table, size_t len, uint32_t count, ChainFileNames* names) {
+    char name[ACCOUNT_NAME_SIZE];
+    size_t offset = 0;
+
+    names->ids = NULL;
+    names->count = 0;
+    names->identity = 1;
+    // Every entry takes at least its length byte
+    if (count > len) return 0;
+    names->ids = (AccountId*)malloc((count ? count : 1) * sizeof(AccountId));
+    if (!names->ids) return 0;
+    names->count = count;
+
+    for (uint32_t i = 0; i < count; i++) {
+        size_t length = offset < len ? table[offset] : 0;
+        if (offset >= len || length > ACCOUNT_NAME_MAX || len - offset - 1 < length) {
+            chainfile_free_names(names);
+            return 0;
+        }
+        memcpy(name, table + offset + 1, length);
+        name[length] = '\0';
+        offset += 1 + length;
+
+        names->ids[i] = account_intern(name);
+        if (names->ids[i] == ACCOUNT_NONE) {
+            chainfile_free_names(names);
+            return 0;
+        }
+        if (names->ids[i] != i) names->identity = 0;
+    }
+    return 1;
+}
+
+// A record's transactions in this process's account IDs: the stored array
+// itself when the file's IDs are the process's, otherwise converted into
+// scratch, which must hold count. NULL if one names an account the file's
+// table does not have.
+const Transaction* chainfile_transactions(const ChainFileNames* names, const ChainFileTransaction* stored,
+                                          size_t count, Transaction* scratch) {
+    for (size_t i = 0; i < count; i++) {
+        if (stored[i].sender >= names->count || stored[i].receiver >= names->count) return NULL;
+        if (names->identity) continue;
+
+        scratch[i].sender = names->ids[stored[i].sender];
+        scratch[i].receiver = names->ids[stored[i].receiver];
+        scratch[i].amount = stored[i].amount;
+        scratch[i].timestamp = (time_t)stored[i].timestamp;
+    }
+    return names->identity ? (const Transaction*)stored : scratch;
+}
+
+// Writes the names of the count accounts, in file ID order, padded to the
+// record alignment; returns the bytes written, or 0 on failure
+static uint64_t write_names(FILE* file, const AccountId* accounts, uint32_t count) {
+    static const uint8_t padding[RECORD_ALIGNMENT];
+    uint64_t written = 0;
+
+    for (uint32_t i = 0; i < count; i++) {
+        size_t length = 0;
+        const char* name = account_name(accounts[i], &length);
+        uint8_t prefix = (uint8_t)length;
+        if (!name || fwrite(&prefix, 1, 1, file) != 1 || fwrite(name, 1, length, file) != length) return 0;
+        written += 1 + length;
+    }
+
+    size_t pad = (size_t)((RECORD_ALIGNMENT - written % RECORD_ALIGNMENT) % RECORD_ALIGNMENT);
+    if (pad > 0 && fwrite(padding, 1, pad, file) != pad) return 0;
+    return written + pad;
+}
+
+// The file's own account IDs: file_ids maps a process ID to its file ID
+// and accounts maps back. File IDs are dense and follow the process IDs'
+// order, so a chain that uses every account interned so far keeps its IDs.
+typedef struct {
+    uint32_t* file_ids;   // by process ID, up to the largest one used
+    AccountId* accounts;  // by file ID
+    uint32_t count;
+    int identity;  // every file ID is the process ID, so records are written as they are
+} NameTable;
+
+static void free_name_table(NameTable* table) {
+    free(table->file_ids);
+    free(table->accounts);
+}
+
+static int build_name_table(Blockchain* chain, size_t count, NameTable* table) {
+    uint32_t limit = 0;
+    memset(table, 0, sizeof(NameTable));
+    for (size_t h = 0; h < count; h++) {
+        const Block* block = get_block_by_index(chain, h);
+        for (int i = 0; i < block->transaction_count; i++) {
+            const Transaction* tx = &block->transactions[i];
+            if (tx->sender >= limit) limit = tx->sender + 1;
+            if (tx->receiver >= limit) limit = tx->receiver + 1;
+        }
+    }
+
+    table->file_ids = (uint32_t*)calloc(limit ? limit : 1, sizeof(uint32_t));
+    table->accounts = (AccountId*)malloc((limit ? limit : 1) * sizeof(AccountId));
+    if (!table->file_ids || !table->accounts) {
+        free_name_table(table);
+        return 0;
+    }
+
+    // Mark the IDs in use, then number them in order
+    for (size_t h = 0; h < count; h++) {
+        const Block* block = get_block_by_index(chain, h);
+        for (int i = 0; i < block->transaction_count; i++) {
+            table->file_ids[block->transactions[i].sender] = 1;
+            table->file_ids[block->transactions[i].receiver] = 1;
+        }
+    }
+    for (uint32_t id = 0; id < limit; id++) {
+        if (!table->file_ids[id]) continue;
+        table->file_ids[id] = table->count;
+        table->accounts[table->count++] = id;
+    }
+    table->identity = table->count == limit;
+    return 1;
+}
+
+// Writes a block's transactions with their account IDs in the file's
+// numbering, converting through a stack buffer unless the two agree
+static int write_transactions(FILE* file, const NameTable* table, const Block* block) {
+    size_t count = (size_t)block->transaction_count;
+    if (table->identity)
+        return count == 0 || fwrite(block->transactions, sizeof(ChainFileTransaction), count, file) == count;
+
+    ChainFileTransaction chunk[WRITE_CHUNK];
+    for (size_t start = 0; start < count; start += WRITE_CHUNK) {
+        size_t n = count - start < WRITE_CHUNK ? count - start : WRITE_CHUNK;
+        for (size_t i = 0; i < n; i++) {
+            const Transaction* tx = &block->transactions[start + i];
+            chunk[i].sender = table->file_ids[tx->sender];
+            chunk[i].receiver = table->file_ids[tx->receiver];
+            chunk[i].amount = tx->amount;
+            chunk[i].timestamp = (int64_t)tx->timestamp;
+        }
+        if (fwrite(chunk, sizeof(ChainFileTransaction), n, file) != n) return 0;
+    }
+    return 1;
+}
+
+static void checkpoint_digest(int32_t difficulty, uint64_t height, const uint8_t hash[], uint8_t digest[]) {
+    static const char domain[] = "BLKCHAIN checkpoint";
+    SHA256_CTX ctx;
+
+    sha256_init(&ctx);
+    sha256_update(&ctx, (const uint8_t*)domain, sizeof(domain) - 1);
+    sha256_update(&ctx, (const uint8_t*)&difficulty, sizeof(difficulty));
+    sha256_update(&ctx, (const uint8_t*)&height, sizeof(height));
+    sha256_update(&ctx, hash, SHA256_DIGEST_SIZE);
+    sha256_final(&ctx, digest);
+}
+
+int chainfile_save(Blockchain* chain, const char* filename) {
+    if (!chain || !filename) return 0;
+
+    size_t count = get_block_count(chain);
+    uint64_t* offsets = (uint64_t*)malloc((count ? count : 1) * sizeof(uint64_t));
+    if (!offsets) return 0;
+
+    FILE* file = fopen(filename, "wb");
+    if (!file) {
+        free(offsets);
+        return 0;
+    }
+
+    // The header is written last, once the offset table's position is known
+    ChainFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CHAINFILE_MAGIC, CHAINFILE_MAGIC_SIZE);
+    header.version = CHAINFILE_VERSION;
+    header.header_size = sizeof(ChainFileHeader);
+    header.difficulty = chain->difficulty;
+    header.record_header_size = sizeof(ChainFileBlock);
+    header.transaction_size = sizeof(ChainFileTransaction);
+    header.block_count = count;
+
+    // The name table holds only the accounts this chain's transactions
+    // name, and records refer to them by their position in it
+    NameTable names;
+    if (!build_name_table(chain, count, &names)) {
+        fclose(file);
+        free(offsets);
+        return 0;
+    }
+    header.name_count = names.count;
+
+    static const uint8_t padding[RECORD_ALIGNMENT];
+    uint64_t offset = sizeof(header);
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1;
+
+    for (size_t h = 0; h < count && ok; h++) {
+        const Block* block = get_block_by_index(chain, h);
+        ChainFileBlock record;
+        chainfile_fill_record(block, &record);
+
+        size_t size = chainfile_record_size(record.transaction_count);
+        size_t body = sizeof(record) + (size_t)block->transaction_count * sizeof(ChainFileTransaction);
+
+        offsets[h] = offset;
+        ok = fwrite(&record, sizeof(record), 1, file) == 1;
+        ok = ok && write_transactions(file, &names, block);
+        ok = ok && (size == body || fwrite(padding, 1, size - body, file) == size - body);
+        offset += size;
+    }
+
+    header.index_offset = offset;
+    ok = ok && (count == 0 || fwrite(offsets, sizeof(uint64_t), count, file) == count);
+    offset += count * sizeof(uint64_t);
+
+    header.names_offset = offset;
+    if (ok && header.name_count > 0) {
+        uint64_t names_size = write_names(file, names.accounts, header.name_count);
+        ok = names_size > 0;
+        offset += names_size;
+    }
+
+    if (chain->checkpoint_height >= 0) {
+        ChainFileCheckpoint checkpoint;
+        checkpoint.height = (uint64_t)chain->checkpoint_height;
+        memcpy(checkpoint.hash, chain->checkpoint_hash, SHA256_DIGEST_SIZE);
+        checkpoint_digest(header.difficulty, checkpoint.height, checkpoint.hash, checkpoint.digest);
+        header.checkpoint_offset = offset;
+        ok = ok && fwrite(&checkpoint, sizeof(checkpoint), 1, file) == 1;
+        offset += sizeof(checkpoint);
+    }
+    ok = ok && fseek(file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, file) == 1;
+    ok = (fclose(file) == 0) && ok;
+    if (ok) METRIC_ADD(METRIC_SAVE_BYTES, offset);
+
+    free_name_table(&names);
+    free(offsets);
+    return ok;
+}
+
+// Opening checks the header and the offset table's bounds and interns the
+// name table, which costs time in the number of accounts but not in the
+// chain's length; records are checked when they are first read
+ChainFile* chainfile_open(const char* filename) {
+    if (!filename) return NULL;
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ChainFileHeader)) {
+        close(fd);
+        return NULL;
+    }
+
+    size_t size = (size_t)st.st_size;
+    void* map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+
+    const ChainFileHeader* header = (const ChainFileHeader*)map;
+    int valid = memcmp(header->magic, CHAINFILE_MAGIC, CHAINFILE_MAGIC_SIZE) == 0 &&
+                header->version == CHAINFILE_VERSION &&
+                header->header_size == sizeof(ChainFileHeader) &&
+                header->record_header_size == sizeof(ChainFileBlock) &&
+                header->transaction_size == sizeof(ChainFileTransaction) &&
+                header->index_offset % RECORD_ALIGNMENT == 0 &&
+                header->index_offset >= sizeof(ChainFileHeader) &&
+                header->index_offset <= size &&
+                header->block_count <= (size - header->index_offset) / sizeof(uint64_t) &&
+                header->names_offset % RECORD_ALIGNMENT == 0 &&
+                header->names_offset >= header->index_offset + header->block_count * sizeof(uint64_t) &&
+                header->names_offset <= size;
+
+    ChainFile* file = valid ? (ChainFile*)malloc(sizeof(ChainFile)) : NULL;
+    size_t slots = file ? (header->block_count ? header->block_count : 1) : 0;
+    Block** blocks = file ? (Block**)calloc(slots, sizeof(Block*)) : NULL;
+    Transaction** converted = blocks ? (Transaction**)calloc(slots, sizeof(Transaction*)) : NULL;
+    if (!converted || !chainfile_read_names((const uint8_t*)map + header->names_offset, size - header->names_offset,
+                                            header->name_count, &file->names)) {
+        free(converted);
+        free(blocks);
+        free(file);
+        munmap(map, size);
+        close(fd);
+        return NULL;
+    }
+
+    file->fd = fd;
+    file->map = (const uint8_t*)map;
+    file->size = size;
+    file->header = header;
+    file->offsets = (const uint64_t*)(file->map + header->index_offset);
+    file->blocks = blocks;
+    file->converted = converted;
+    arena_init(&file->block_arena, sizeof(Block));
+    return file;
+}
+
+size_t chainfile_block_count(const ChainFile* file) {
+    return file ? (size_t)file->header->block_count : 0;
+}
+
+// The stored checkpoint, if the file has one and it is intact
+int chainfile_checkpoint(const ChainFile* file, uint64_t* height, uint8_t hash[]) {
+    if (!file) return 0;
+
+    uint64_t offset = file->header->checkpoint_offset;
+    if (offset == 0 || offset % RECORD_ALIGNMENT != 0 || offset > file->size ||
+        file->size - offset < sizeof(ChainFileCheckpoint))
+        return 0;
+
+    const ChainFileCheckpoint* checkpoint = (const ChainFileCheckpoint*)(file->map + offset);
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    checkpoint_digest(file->header->difficulty, checkpoint->height, checkpoint->hash, digest);
+    if (memcmp(digest, checkpoint->digest, SHA256_DIGEST_SIZE) != 0 ||
+        checkpoint->height >= file->header->block_count)
+        return 0;
+
+    if (height) *height = checkpoint->height;
+    if (hash) memcpy(hash, checkpoint->hash, SHA256_DIGEST_SIZE);
+    return 1;
+}
+
+int chainfile_difficulty(const ChainFile* file) {
+    return file ? file->header->difficulty : 0;
+}
+
+// Bounds-checked view of the record at height; NULL if it is corrupt
+const ChainFileBlock* chainfile_record(const ChainFile* file, size_t height,
+                                      const ChainFileTransaction** transactions) {
+    if (!file || height >= file->header->block_count) return NULL;
+
+    uint64_t offset = file->offsets[height];
+    uint64_t limit = file->header->index_offset;
+    if (offset % RECORD_ALIGNMENT != 0 || offset < sizeof(ChainFileHeader) ||
+        offset > limit || limit - offset < sizeof(ChainFileBlock))
+        return NULL;
+
+    const ChainFileBlock* record = (const ChainFileBlock*)(file->map + offset);
+    if (record->transaction_count > INT32_MAX ||
+        (uint64_t)record->transaction_count * sizeof(ChainFileTransaction) > limit - offset - sizeof(ChainFileBlock))
+        return NULL;
+
+    if (transactions)
+        *transactions = (const ChainFileTransaction*)(file->map + offset + sizeof(ChainFileBlock));
+    return record;
+}
+
+// Materializes the block at height on first use. The block and its
+// transactions belong to the file and stay valid, read-only, until close.
+// Like a sealed block it keeps only its Merkle root, taken from the record.
+Block* chainfile_get_block(ChainFile* file, size_t height) {
+    if (!file || height >= file->header->block_count) return NULL;
+    if (file->blocks[height]) return file->blocks[height];
+
+    const ChainFileTransaction* stored;
+    const ChainFileBlock* record = chainfile_record(file, height, &stored);
+    if (!record) return NULL;
+
+    size_t count = record->transaction_count;
+    Transaction* converted = NULL;
+    if (!file->names.identity) {
+        converted = (Transaction*)malloc(count ? count * sizeof(Transaction) : 1);
+        if (!converted) return NULL;
+    }
+
+    const Transaction* transactions = chainfile_transactions(&file->names, stored, count, converted);
+    Block* block = transactions ? (Block*)arena_alloc(&file->block_arena) : NULL;
+    if (!block) {
+        free(converted);
+        return NULL;
+    }
+
+    chainfile_block_view(record, transactions, block);
+    file->converted[height] = converted;
+
+    // Link to whichever neighbours are already materialized
+    if (height > 0 && file->blocks[height - 1]) file->blocks[height - 1]->next = block;
+    if (height + 1 < file->header->block_count) block->next = file->blocks[height + 1];
+
+    file->blocks[height] = block;
+    return block;
+}
+
+void chainfile_close(ChainFile* file) {
+    if (!file) return;
+
+    // Mapped blocks hold no Merkle levels and borrow their transactions,
+    // so only the converted copies are freed
+    for (size_t h = 0; h < file->header->block_count; h++)
+        free(file->converted[h]);
+    free(file->converted);
+    chainfile_free_names(&file->names);
+    arena_free(&file->block_arena);
+    free(file->blocks);
+    munmap((void*)file->map, file->size);
+    close(file->fd);
+    free(file);
+}
+
+// Rewrites a version 1 file, or anything else load_blockchain reads, in
+// the current format
+int convert_legacy_chain(const char* legacy_filename, const char* filename) {
+    Blockchain* chain = load_blockchain(legacy_filename);
+    if (!chain) return 0;
+
+    int ok = chainfile_save(chain, filename);
+    free_blockchain(chain);
+    return ok;
+}
@@ -0,0 +1,126 @@
+#ifndef CHAINFILE_H
+#define CHAINFILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "blockchain.h"
+
+// Chain file format, version 4:
+//   ChainFileHeader
+//   one record per block, 8-byte aligned: ChainFileBlock followed by its
+//   transactions as ChainFileTransaction structs
+//   offset table: uint64_t file offset of every record, by height
+//   name table: the account names the records refer to, and only those,
+//   by the file's own account IDs (0 to name_count - 1), each as a length
+//   byte and its bytes, padded to 8 bytes
+//   optionally a ChainFileCheckpoint
+// All integers are in host byte order. Files written before the header
+// existed (version 1) start directly with the difficulty and are still
+// read by load_blockchain, which checks their blocks against the original
+// hashes and then hashes and mines them afresh. Version 3 records had no
+// Merkle root and are no longer read.
+#define CHAINFILE_MAGIC "BLKCHAIN"
+#define CHAINFILE_MAGIC_SIZE 8
+#define CHAINFILE_VERSION 4
+
+typedef struct {
+    char magic[CHAINFILE_MAGIC_SIZE];
+    uint32_t version;
+    uint32_t header_size;
+    int32_t difficulty;
+    uint32_t record_header_size;  // sizeof(ChainFileBlock) when written
+    uint64_t block_count;
+    uint64_t index_offset;        // where the offset table starts
+    uint32_t transaction_size;    // sizeof(ChainFileTransaction) when written
+    uint32_t name_count;          // entries in the name table
+    uint64_t checkpoint_offset;   // where the checkpoint is, 0 if there is none
+    uint64_t names_offset;        // where the name table starts
+} ChainFileHeader;
+
+typedef struct {
+    uint32_t index;
+    uint32_t transaction_count;
+    int64_t timestamp;
+    uint64_t nonce;
+    uint8_t previous_hash[SHA256_DIGEST_SIZE];
+    uint8_t hash[SHA256_DIGEST_SIZE];
+    // As saved, so a mapped block need not rehash its transactions; the
+    // block hash covers it. Records decoded from the log or a pack file
+    // leave it zero, and loading rebuilds the tree.
+    uint8_t merkle_root[SHA256_DIGEST_SIZE];
+} ChainFileBlock;
+
+// A transaction as records store it. The account IDs index the file's
+// name table; the layout is Transaction's, so when those IDs are the
+// process's own a record's transactions are used where they lie.
+typedef struct {
+    uint32_t sender;
+    uint32_t receiver;
+    double amount;
+    int64_t timestamp;
+} ChainFileTransaction;
+
+// A transaction as version 1 files store it, with the account names
+// spelled out and zero-padded
+typedef struct {
+    char sender[ACCOUNT_NAME_SIZE];
+    char receiver[ACCOUNT_NAME_SIZE];
+    double amount;
+    int64_t timestamp;
+} ChainFileNamedTransaction;
+
+// A file's name table, interned: ids[i] is what the file's account i is
+// in this process
+typedef struct {
+    AccountId* ids;
+    uint32_t count;
+    int identity;  // every ids[i] == i, so records need no conversion
+} ChainFileNames;
+
+// The last block a full validation vouched for. The digest binds height,
+// hash and difficulty together so a damaged checkpoint is ignored.
+typedef struct {
+    uint64_t height;
+    uint8_t hash[SHA256_DIGEST_SIZE];
+    uint8_t digest[SHA256_DIGEST_SIZE];
+} ChainFileCheckpoint;
+
+// A chain file mapped read-only. Its name table is interned on open and
+// blocks are materialized on first access. A block's transactions are the
+// record's own when the file's account IDs are the process's, otherwise a
+// converted copy the file keeps; either way the block only borrows them.
+typedef struct {
+    int fd;
+    const uint8_t* map;
+    size_t size;
+    const ChainFileHeader* header;
+    const uint64_t* offsets;
+    ChainFileNames names;
+    Block** blocks;  // materialized blocks by height, NULL until first use
+    Transaction** converted;  // copies made for blocks by height, if any
+    Arena block_arena;
+} ChainFile;
+
+// Function declarations
+int chainfile_is_chainfile(const char* filename);
+void chainfile_fill_record(const Block* block, ChainFileBlock* record);
+void chainfile_block_view(const ChainFileBlock* record, const Transaction* transactions, Block* block);
+void chainfile_fill_named_transaction(const Transaction* tx, ChainFileNamedTransaction* stored);
+int chainfile_read_named_transactions(const ChainFileNamedTransaction* stored, size_t count, Transaction* txs);
+int chainfile_read_names(const uint8_t* table, size_t len, uint32_t count, ChainFileNames* names);
+void chainfile_free_names(ChainFileNames* names);
+const Transaction* chainfile_transactions(const ChainFileNames* names, const ChainFileTransaction* stored,
+                                          size_t count, Transaction* scratch);
+size_t chainfile_record_size(uint32_t transaction_count);
+int chainfile_save(Blockchain* chain, const char* filename);
+ChainFile* chainfile_open(const char* filename);
+size_t chainfile_block_count(const ChainFile* file);
+int chainfile_checkpoint(const ChainFile* file, uint64_t* height, uint8_t hash[]);
+int chainfile_difficulty(const ChainFile* file);
+const ChainFileBlock* chainfile_record(const ChainFile* file, size_t height,
+                                      const ChainFileTransaction** transactions);
+Block* chainfile_get_block(ChainFile* file, size_t height);
+void chainfile_close(ChainFile* file);
+int convert_legacy_chain(const char* legacy_filename, const char* filename);
+
+#endif // CHAINFILE_H
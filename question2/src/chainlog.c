@@ -0,0 +1,330 @@
+#include "chainlog.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+static int64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// An entry's checksum: the first 8 bytes of SHA-256 over its block
+uint64_t chainlog_checksum(const uint8_t* data, size_t len) {
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    uint64_t checksum;
+
+    sha256(data, len, digest);
+    memcpy(&checksum, digest, sizeof(checksum));
+    return checksum;
+}
+
+// Writes every iovec at offset, retrying after short writes
+static int write_all_at(int fd, struct iovec* iov, int count, uint64_t offset) {
+    while (count > 0) {
+        ssize_t written = pwritev(fd, iov, count, (off_t)offset);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        offset += (uint64_t)written;
+        while (count > 0 && (size_t)written >= iov->iov_len) {
+            written -= (ssize_t)iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (uint8_t*)iov->iov_base + written;
+            iov->iov_len -= (size_t)written;
+        }
+    }
+    return 1;
+}
+
+static int write_header(ChainLog* log) {
+    ChainFileHeader header;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CHAINLOG_MAGIC, CHAINFILE_MAGIC_SIZE);
+    header.version = CHAINLOG_VERSION;
+    header.header_size = sizeof(ChainFileHeader);
+    header.difficulty = log->difficulty;
+    // Entries hold encoded blocks, not ChainFileBlock records or
+    // ChainFileTransaction records
+    header.record_header_size = 0;
+    header.transaction_size = 0;
+
+    struct iovec iov = { &header, sizeof(header) };
+    if (ftruncate(log->fd, 0) != 0 || !write_all_at(log->fd, &iov, 1, 0) || fdatasync(log->fd) != 0)
+        return 0;
+    log->size = sizeof(header);
+    return 1;
+}
+
+static ChainLog* open_failed(ChainLog* log) {
+    if (log->fd >= 0) close(log->fd);
+    pthread_mutex_destroy(&log->lock);
+    pthread_cond_destroy(&log->wake);
+    free(log);
+    return NULL;
+}
+
+// Syncs the log once its oldest unsynced block is sync_interval_ms old,
+// so the interval holds even when no further block is appended to check it
+static void* flusher_thread(void* arg) {
+    ChainLog* log = (ChainLog*)arg;
+
+    pthread_mutex_lock(&log->lock);
+    while (!log->stopping) {
+        if (log->synced_blocks == log->appended_blocks) {
+            pthread_cond_wait(&log->wake, &log->lock);
+            continue;
+        }
+
+        int64_t due = log->first_unsynced_ms + log->options.sync_interval_ms;
+        if (now_ms() < due) {
+            struct timespec deadline = { (time_t)(due / 1000), (long)(due % 1000) * 1000000 };
+            pthread_cond_timedwait(&log->wake, &log->lock, &deadline);
+            continue;
+        }
+
+        pthread_mutex_unlock(&log->lock);
+        int ok = chainlog_sync(log);
+        pthread_mutex_lock(&log->lock);
+        // After a failed sync, try again an interval later rather than spin
+        if (!ok) log->first_unsynced_ms = now_ms();
+    }
+    pthread_mutex_unlock(&log->lock);
+    return NULL;
+}
+
+// Starts the flusher for a log with a time-based sync policy. Without it,
+// the interval is only checked when the next block is appended.
+static void start_flusher(ChainLog* log) {
+    if (log->options.sync_interval_ms <= 0) return;
+
+    log->has_flusher = pthread_create(&log->flusher, NULL, flusher_thread, log) == 0;
+}
+
+// Decodes an entry into a record and the log's transaction array; 0 if
+// the bytes do not hold exactly one block
+static int decode_entry(ChainLog* log, const uint8_t* data, size_t len, ChainFileBlock* record) {
+    Block block;
+    uint32_t count;
+
+    memset(&block, 0, sizeof(block));
+    size_t offset = decode_block_fixed(data, len, &block, &count);
+    if (offset == 0 || count > INT32_MAX || count > (len - offset) / TRANSACTION_ENCODED_MIN) return 0;
+
+    if (count > log->transaction_capacity) {
+        Transaction* transactions = (Transaction*)realloc(log->transactions, count * sizeof(Transaction));
+        if (!transactions) return 0;
+        log->transactions = transactions;
+        log->transaction_capacity = count;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        size_t used = decode_transaction(data + offset, len - offset, &log->transactions[i]);
+        if (used == 0) return 0;
+        offset += used;
+    }
+    if (offset != len) return 0;
+
+    block.transaction_count = (int)count;
+    chainfile_fill_record(&block, record);
+    return 1;
+}
+
+// Opens or creates a log. An existing log keeps its own difficulty and
+// must be replayed before blocks can be appended to it.
+ChainLog* chainlog_open(const char* filename, int difficulty, const ChainLogOptions* options) {
+    if (!filename) return NULL;
+
+    ChainLog* log = (ChainLog*)calloc(1, sizeof(ChainLog));
+    if (!log) return NULL;
+
+    // The flusher's deadlines are on the same clock as now_ms
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_mutex_init(&log->lock, NULL);
+    pthread_cond_init(&log->wake, &attr);
+    pthread_condattr_destroy(&attr);
+
+    byte_buffer_init(&log->buffer);
+    log->fd = open(filename, O_RDWR | O_CREAT, 0644);
+    log->difficulty = difficulty;
+    if (options) log->options = *options;
+    else log->options.sync_every = 1;
+
+    struct stat st;
+    if (log->fd < 0 || fstat(log->fd, &st) != 0) return open_failed(log);
+
+    // A log that never got a whole header holds no blocks yet
+    if ((uint64_t)st.st_size < sizeof(ChainFileHeader)) {
+        if (!write_header(log)) return open_failed(log);
+        start_flusher(log);
+        return log;
+    }
+
+    ChainFileHeader header;
+    if (pread(log->fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+        memcmp(header.magic, CHAINLOG_MAGIC, CHAINFILE_MAGIC_SIZE) != 0 ||
+        header.version != CHAINLOG_VERSION ||
+        header.header_size != sizeof(ChainFileHeader))
+        return open_failed(log);
+
+    log->difficulty = header.difficulty;
+    start_flusher(log);
+    return log;
+}
+
+// Hands every intact entry to fn in order, then cuts off a torn tail: an
+// entry whose length or checksum does not check out, and all after it
+int chainlog_replay(ChainLog* log, chainlog_replay_fn fn, void* context) {
+    if (!log) return 0;
+    if (log->size != 0) return 1;
+
+    struct stat st;
+    if (fstat(log->fd, &st) != 0) return 0;
+
+    uint64_t size = (uint64_t)st.st_size;
+    uint8_t* map = (uint8_t*)mmap(NULL, size, PROT_READ, MAP_SHARED, log->fd, 0);
+    if (map == MAP_FAILED) return 0;
+
+    uint64_t offset = sizeof(ChainFileHeader);
+    while (size - offset >= sizeof(ChainLogEntry)) {
+        ChainLogEntry entry;
+        ChainFileBlock record;
+        memcpy(&entry, map + offset, sizeof(entry));
+
+        uint64_t body = offset + sizeof(ChainLogEntry);
+        if (entry.length > size - body) break;
+        if (chainlog_checksum(map + body, entry.length) != entry.checksum) break;
+        if (!decode_entry(log, map + body, entry.length, &record)) break;
+
+        if (fn && !fn(context, &record, log->transactions)) {
+            munmap(map, size);
+            return 0;
+        }
+        offset = body + entry.length;
+    }
+    munmap(map, size);
+
+    if (offset < size && (ftruncate(log->fd, (off_t)offset) != 0 || fdatasync(log->fd) != 0))
+        return 0;
+    log->size = offset;
+    return 1;
+}
+
+// Safe to call from any thread. Blocks appended while fdatasync runs may
+// not be covered by it, so they stay counted as unsynced.
+int chainlog_sync(ChainLog* log) {
+    if (!log) return 0;
+
+    pthread_mutex_lock(&log->lock);
+    uint64_t target = log->appended_blocks;
+    int done = log->synced_blocks >= target;
+    int64_t started = now_ms();
+    pthread_mutex_unlock(&log->lock);
+    if (done) return 1;
+
+    if (fdatasync(log->fd) != 0) return 0;
+
+    pthread_mutex_lock(&log->lock);
+    if (log->synced_blocks < target) log->synced_blocks = target;
+    if (log->synced_blocks < log->appended_blocks) log->first_unsynced_ms = started;
+    log->syncs++;
+    pthread_mutex_unlock(&log->lock);
+    return 1;
+}
+
+// Records blocks written to the log; the first one after a sync starts
+// the interval clock
+static void count_appended(ChainLog* log, int blocks, int64_t now) {
+    if (log->synced_blocks == log->appended_blocks) {
+        log->first_unsynced_ms = now;
+        pthread_cond_signal(&log->wake);
+    }
+    log->appended_blocks += (uint64_t)blocks;
+}
+
+// Counts blocks that reached the log other than through chainlog_append,
+// as the background writer (chainwriter.h) writes them; synced says they
+// were already forced to disk
+void chainlog_note_written(ChainLog* log, int blocks, int synced) {
+    pthread_mutex_lock(&log->lock);
+    if (synced) {
+        // fdatasync covers the whole file, earlier blocks included
+        log->syncs++;
+        log->appended_blocks += (uint64_t)blocks;
+        log->synced_blocks = log->appended_blocks;
+    } else if (blocks > 0) {
+        count_appended(log, blocks, now_ms());
+    }
+    pthread_mutex_unlock(&log->lock);
+}
+
+// Writes one entry in a single call, then syncs if the policy says so.
+// A failed write is cut off again so later entries stay reachable; if
+// that fails too, the log takes no more entries.
+int chainlog_append(ChainLog* log, const Block* block) {
+    if (!log || !block || log->size == 0 || log->failed || block->transaction_count < 0) return 0;
+
+    if (!encode_block(block, &log->buffer) || log->buffer.size > UINT32_MAX) return 0;
+
+    ChainLogEntry entry;
+    entry.length = (uint32_t)log->buffer.size;
+    entry.reserved = 0;
+    entry.checksum = chainlog_checksum(log->buffer.data, log->buffer.size);
+
+    struct iovec iov[2] = {
+        { &entry, sizeof(entry) },
+        { log->buffer.data, log->buffer.size }
+    };
+    if (!write_all_at(log->fd, iov, 2, log->size)) {
+        if (ftruncate(log->fd, (off_t)log->size) != 0) log->failed = 1;
+        return 0;
+    }
+
+    log->size += sizeof(entry) + entry.length;
+    log->blocks_written++;
+    log->bytes_written += sizeof(entry) + entry.length;
+
+    int64_t now = now_ms();
+    const ChainLogOptions* options = &log->options;
+    pthread_mutex_lock(&log->lock);
+    count_appended(log, 1, now);
+    uint64_t unsynced = log->appended_blocks - log->synced_blocks;
+    int due = (options->sync_every > 0 && unsynced >= (uint64_t)options->sync_every) ||
+              (options->sync_interval_ms > 0 && now - log->first_unsynced_ms >= options->sync_interval_ms);
+    pthread_mutex_unlock(&log->lock);
+
+    return due ? chainlog_sync(log) : 1;
+}
+
+void chainlog_close(ChainLog* log) {
+    if (!log) return;
+
+    if (log->has_flusher) {
+        pthread_mutex_lock(&log->lock);
+        log->stopping = 1;
+        pthread_cond_signal(&log->wake);
+        pthread_mutex_unlock(&log->lock);
+        pthread_join(log->flusher, NULL);
+    }
+
+    chainlog_sync(log);
+    close(log->fd);
+    pthread_mutex_destroy(&log->lock);
+    pthread_cond_destroy(&log->wake);
+    byte_buffer_free(&log->buffer);
+    free(log->transactions);
+    free(log);
+}
@@ -0,0 +1,72 @@
+#ifndef CHAINLOG_H
+#define CHAINLOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "blockchain.h"
+#include "chainfile.h"
+#include "encoding.h"
+
+// Append-only chain log:
+//   ChainFileHeader with the log magic (block_count and index_offset unused)
+//   one entry per sealed block: ChainLogEntry, then the block in the
+//   canonical encoding from encoding.h, the bytes its hashes are built from
+// An entry whose length or checksum does not check out ends the log; on
+// open it and everything after it is cut off, so a write torn by a crash
+// costs at most the blocks that were not yet synced.
+#define CHAINLOG_MAGIC "BLKCHLOG"
+#define CHAINLOG_VERSION 2
+
+typedef struct {
+    uint32_t length;    // bytes of encoded block that follow
+    uint32_t reserved;
+    uint64_t checksum;  // first 8 bytes of SHA-256 over those bytes
+} ChainLogEntry;
+
+// When appended blocks are forced to disk with fdatasync. A sync covers
+// every block written before it, so batching trades the blocks a crash can
+// lose for fewer syncs. A log with sync_interval_ms set runs a flusher
+// thread, so a block is synced within the interval even if the chain goes
+// idle after it.
+typedef struct ChainLogOptions {
+    int sync_every;        // sync once this many blocks are unsynced; 1 syncs each block, 0 never by count
+    int sync_interval_ms;  // also sync once the oldest unsynced block is this old; 0 never by time
+} ChainLogOptions;
+
+typedef struct ChainLog {
+    int fd;
+    int difficulty;
+    uint64_t size;           // end of the last intact entry; 0 until replayed
+    ChainLogOptions options;
+    // The flusher thread reads and clears these, so they are changed under lock
+    pthread_mutex_t lock;
+    pthread_cond_t wake;  // the flusher waits here for blocks or its deadline
+    uint64_t appended_blocks;  // since open; those past synced_blocks are not yet synced
+    uint64_t synced_blocks;
+    int64_t first_unsynced_ms;
+    uint64_t syncs;
+    pthread_t flusher;
+    int has_flusher;
+    int stopping;
+    uint64_t blocks_written;
+    uint64_t bytes_written;
+    int failed;  // a failed append could not be cut off, so the file may end in a torn entry
+    ByteBuffer buffer;          // encoding of the block being appended
+    Transaction* transactions;  // decoded transactions of the entry being replayed
+    size_t transaction_capacity;
+} ChainLog;
+
+// Called for each intact entry in order; returning 0 stops the replay
+typedef int (*chainlog_replay_fn)(void* context, const ChainFileBlock* record, const Transaction* transactions);
+
+// Function declarations
+ChainLog* chainlog_open(const char* filename, int difficulty, const ChainLogOptions* options);
+int chainlog_replay(ChainLog* log, chainlog_replay_fn fn, void* context);
+int chainlog_append(ChainLog* log, const Block* block);
+int chainlog_sync(ChainLog* log);
+void chainlog_note_written(ChainLog* log, int blocks, int synced);
+void chainlog_close(ChainLog* log);
+uint64_t chainlog_checksum(const uint8_t* data, size_t len);
+
+#endif // CHAINLOG_H
@@ -0,0 +1,542 @@
+#include "chainpack.h"
+#include "encoding.h"
+#include "lz.h"
+#include "metrics.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define VARINT_MAX 10
+// Most bytes a block's fields and one transaction can take in a segment
+#define BLOCK_PACKED_MAX (4 * VARINT_MAX + 1 + 2 * SHA256_DIGEST_SIZE)
+#define TRANSACTION_PACKED_MAX (3 * VARINT_MAX + 1 + 8)
+#define TRANSACTION_PACKED_MIN 4
+
+#define BLOCK_HAS_PREVIOUS_HASH 1u
+// Larger amounts are stored whole, before cents lose precision
+#define CENTS_LIMIT 1e15
+
+static void put_le32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static void put_le64(uint8_t* p, uint64_t v) {
+    put_le32(p, (uint32_t)v);
+    put_le32(p + 4, (uint32_t)(v >> 32));
+}
+
+static uint32_t get_le32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t get_le64(const uint8_t* p) {
+    return (uint64_t)get_le32(p) | ((uint64_t)get_le32(p + 4) << 32);
+}
+
+static size_t put_varint(uint8_t* p, uint64_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        p[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+// Advances *p past one varint; 0 if it runs past end or is too long
+static int get_varint(const uint8_t** p, const uint8_t* end, uint64_t* v) {
+    uint64_t value = 0;
+
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (*p >= end) return 0;
+        uint8_t byte = *(*p)++;
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *v = value;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static uint64_t zigzag(int64_t v) {
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static int64_t unzigzag(uint64_t v) {
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+// Timestamp deltas wrap instead of overflowing, and decode back exactly
+static uint64_t time_delta(int64_t t, int64_t base) {
+    return zigzag((int64_t)((uint64_t)t - (uint64_t)base));
+}
+
+static int64_t add_time_delta(int64_t base, uint64_t delta) {
+    return (int64_t)((uint64_t)base + (uint64_t)unzigzag(delta));
+}
+
+// Amounts like 10.50 are stored as cents when dividing back by 100 gives
+// exactly the same double
+static size_t put_amount(uint8_t* p, double amount) {
+    if (amount > -CENTS_LIMIT && amount < CENTS_LIMIT) {
+        double scaled = amount * 100;
+        int64_t cents = (int64_t)(scaled < 0 ? scaled - 0.5 : scaled + 0.5);
+        double decoded = (double)cents / 100.0;
+        if (memcmp(&decoded, &amount, sizeof(amount)) == 0) return put_varint(p, zigzag(cents) << 1 | 1);
+    }
+
+    uint64_t bits;
+    memcpy(&bits, &amount, sizeof(bits));
+    p[0] = 0;
+    put_le64(p + 1, bits);
+    return 9;
+}
+
+static int get_amount(const uint8_t** p, const uint8_t* end, double* amount) {
+    uint64_t v;
+    if (!get_varint(p, end, &v)) return 0;
+
+    if (v & 1) {
+        *amount = (double)unzigzag(v >> 1) / 100.0;
+        return 1;
+    }
+    if (v != 0 || end - *p < 8) return 0;
+
+    uint64_t bits = get_le64(*p);
+    memcpy(amount, &bits, sizeof(*amount));
+    *p += 8;
+    return 1;
+}
+
+int chainpack_is_chainpack(const char* filename) {
+    char magic[CHAINFILE_MAGIC_SIZE];
+
+    FILE* file = fopen(filename, "rb");
+    if (!file) return 0;
+
+    int match = fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+                memcmp(magic, CHAINPACK_MAGIC, CHAINFILE_MAGIC_SIZE) == 0;
+    fclose(file);
+    return match;
+}
+
+// State for writing one pack file
+typedef struct {
+    FILE* file;
+    int compress;
+    size_t segment_size;
+    uint64_t bytes_written;
+    // Dictionary of the segment being built: account IDs by position, and
+    // an open-addressing table of position + 1 (0 when free)
+    AccountId* accounts;
+    size_t name_count;
+    size_t name_capacity;
+    uint32_t* slots;
+    size_t slot_capacity;
+    // The segment's blocks, then the whole segment before and after LZ
+    ByteBuffer body;
+    ByteBuffer raw;
+    ByteBuffer stored;
+    uint32_t segment_blocks;
+    int64_t previous_index;
+    int64_t previous_timestamp;
+    const uint8_t* previous_hash;  // NULL at the start of a segment
+} PackWriter;
+
+// IDs are handed out in sequence, so spread them over the table
+static size_t id_hash(AccountId id) {
+    return (size_t)(((uint64_t)id * 0x9e3779b97f4a7c15ULL) >> 32);
+}
+
+static void place_name(uint32_t* slots, size_t capacity, AccountId account, uint32_t position) {
+    size_t i = id_hash(account) & (capacity - 1);
+    while (slots[i]) i = (i + 1) & (capacity - 1);
+    slots[i] = position + 1;
+}
+
+static int grow_slots(PackWriter* w) {
+    size_t capacity = w->slot_capacity ? w->slot_capacity * 2 : 256;
+    uint32_t* slots = (uint32_t*)calloc(capacity, sizeof(uint32_t));
+    if (!slots) return 0;
+
+    for (size_t position = 0; position < w->name_count; position++)
+        place_name(slots, capacity, w->accounts[position], (uint32_t)position);
+    free(w->slots);
+    w->slots = slots;
+    w->slot_capacity = capacity;
+    return 1;
+}
+
+// The account's position in the segment's dictionary, adding it if new;
+// -1 if there is no memory for it
+static long dictionary_position(PackWriter* w, AccountId account) {
+    if ((w->name_count + 1) > w->slot_capacity / 4 * 3 && !grow_slots(w)) return -1;
+
+    size_t i = id_hash(account) & (w->slot_capacity - 1);
+    while (w->slots[i]) {
+        size_t position = w->slots[i] - 1;
+        if (w->accounts[position] == account) return (long)position;
+        i = (i + 1) & (w->slot_capacity - 1);
+    }
+
+    if (w->name_count == w->name_capacity) {
+        size_t capacity = w->name_capacity ? w->name_capacity * 2 : 64;
+        AccountId* accounts = (AccountId*)realloc(w->accounts, capacity * sizeof(AccountId));
+        if (!accounts) return -1;
+        w->accounts = accounts;
+        w->name_capacity = capacity;
+    }
+
+    size_t position = w->name_count++;
+    w->accounts[position] = account;
+    w->slots[i] = (uint32_t)position + 1;
+    return (long)position;
+}
+
+static void start_segment(PackWriter* w) {
+    w->body.size = 0;
+    w->name_count = 0;
+    if (w->slots) memset(w->slots, 0, w->slot_capacity * sizeof(uint32_t));
+    w->segment_blocks = 0;
+    w->previous_index = -1;
+    w->previous_timestamp = 0;
+    w->previous_hash = NULL;
+}
+
+static int pack_block(PackWriter* w, const Block* block) {
+    size_t count = block->transaction_count > 0 ? (size_t)block->transaction_count : 0;
+    if (!byte_buffer_reserve(&w->body, w->body.size + BLOCK_PACKED_MAX + count * TRANSACTION_PACKED_MAX))
+        return 0;
+
+    uint8_t* p = w->body.data + w->body.size;
+    int64_t timestamp = (int64_t)block->timestamp;
+    p += put_varint(p, zigzag((int64_t)block->index - w->previous_index - 1));
+    p += put_varint(p, time_delta(timestamp, w->previous_timestamp));
+    p += put_varint(p, block->nonce);
+
+    int linked = w->previous_hash && memcmp(w->previous_hash, block->previous_hash, SHA256_DIGEST_SIZE) == 0;
+    *p++ = linked ? 0 : BLOCK_HAS_PREVIOUS_HASH;
+    if (!linked) {
+        memcpy(p, block->previous_hash, SHA256_DIGEST_SIZE);
+        p += SHA256_DIGEST_SIZE;
+    }
+    memcpy(p, block->hash, SHA256_DIGEST_SIZE);
+    p += SHA256_DIGEST_SIZE;
+    p += put_varint(p, count);
+
+    for (size_t i = 0; i < count; i++) {
+        const Transaction* tx = &block->transactions[i];
+        long sender = dictionary_position(w, tx->sender);
+        long receiver = dictionary_position(w, tx->receiver);
+        if (sender < 0 || receiver < 0) return 0;
+
+        p += put_varint(p, (uint64_t)sender);
+        p += put_varint(p, (uint64_t)receiver);
+        p += put_amount(p, tx->amount);
+        p += put_varint(p, time_delta((int64_t)tx->timestamp, timestamp));
+    }
+
+    w->body.size = (size_t)(p - w->body.data);
+    w->segment_blocks++;
+    w->previous_index = block->index;
+    w->previous_timestamp = timestamp;
+    w->previous_hash = block->hash;
+    return 1;
+}
+
+// Writes the dictionary and blocks built so far as one segment, compressed
+// if that makes it smaller
+static int flush_segment(PackWriter* w) {
+    if (w->segment_blocks == 0) return 1;
+
+    if (!byte_buffer_reserve(&w->raw, VARINT_MAX + w->name_count * (1 + ACCOUNT_NAME_MAX) + w->body.size))
+        return 0;
+    uint8_t* p = w->raw.data;
+    p += put_varint(p, w->name_count);
+    for (size_t position = 0; position < w->name_count; position++) {
+        size_t len = 0;
+        const char* name = account_name(w->accounts[position], &len);
+        *p++ = (uint8_t)len;
+        if (name) memcpy(p, name, len);
+        p += len;
+    }
+    memcpy(p, w->body.data, w->body.size);
+    w->raw.size = (size_t)(p - w->raw.data) + w->body.size;
+    if (w->raw.size > UINT32_MAX) return 0;
+
+    uint8_t codec = CHAINPACK_STORED;
+    const uint8_t* payload = w->raw.data;
+    size_t stored_size = w->raw.size;
+    if (w->compress && byte_buffer_reserve(&w->stored, lz_compress_bound(w->raw.size))) {
+        size_t n = lz_compress(w->raw.data, w->raw.size, w->stored.data, w->stored.capacity);
+        if (n > 0 && n < w->raw.size) {
+            codec = CHAINPACK_LZ;
+            payload = w->stored.data;
+            stored_size = n;
+        }
+    }
+
+    uint8_t header[CHAINPACK_SEGMENT_HEADER_SIZE];
+    header[0] = codec;
+    put_le32(header + 1, (uint32_t)w->raw.size);
+    put_le32(header + 5, (uint32_t)stored_size);
+    put_le32(header + 9, w->segment_blocks);
+    if (fwrite(header, sizeof(header), 1, w->file) != 1 ||
+        fwrite(payload, 1, stored_size, w->file) != stored_size)
+        return 0;
+
+    w->bytes_written += sizeof(header) + stored_size;
+    start_segment(w);
+    return 1;
+}
+
+int chainpack_save(Blockchain* chain, const char* filename, const ChainPackOptions* options) {
+    if (!chain || !filename) return 0;
+
+    PackWriter w;
+    memset(&w, 0, sizeof(w));
+    w.compress = options ? options->compress : 1;
+    w.segment_size = options && options->segment_size ? options->segment_size : CHAINPACK_DEFAULT_SEGMENT_SIZE;
+    byte_buffer_init(&w.body);
+    byte_buffer_init(&w.raw);
+    byte_buffer_init(&w.stored);
+    start_segment(&w);
+
+    w.file = fopen(filename, "wb");
+    if (!w.file) return 0;
+
+    uint8_t header[CHAINPACK_HEADER_SIZE + CHAINPACK_CHECKPOINT_SIZE];
+    size_t count = get_block_count(chain);
+    uint32_t flags = chain->checkpoint_height >= 0 ? CHAINPACK_HAS_CHECKPOINT : 0;
+    memset(header, 0, sizeof(header));
+    memcpy(header, CHAINPACK_MAGIC, CHAINFILE_MAGIC_SIZE);
+    put_le32(header + 8, CHAINPACK_VERSION);
+    put_le32(header + 12, (uint32_t)(int32_t)chain->difficulty);
+    put_le64(header + 16, count);
+    put_le32(header + 24, flags);
+    if (flags & CHAINPACK_HAS_CHECKPOINT) {
+        put_le64(header + CHAINPACK_HEADER_SIZE, (uint64_t)chain->checkpoint_height);
+        memcpy(header + CHAINPACK_HEADER_SIZE + 8, chain->checkpoint_hash, SHA256_DIGEST_SIZE);
+    }
+    size_t header_size = CHAINPACK_HEADER_SIZE + (flags ? CHAINPACK_CHECKPOINT_SIZE : 0);
+    int ok = fwrite(header, 1, header_size, w.file) == header_size;
+    w.bytes_written = header_size;
+
+    for (size_t h = 0; h < count && ok; h++) {
+        ok = pack_block(&w, get_block_by_index(chain, h));
+        if (ok && w.body.size >= w.segment_size) ok = flush_segment(&w);
+    }
+    ok = ok && flush_segment(&w);
+    ok = (fclose(w.file) == 0) && ok;
+    if (ok) METRIC_ADD(METRIC_SAVE_BYTES, w.bytes_written);
+
+    free(w.accounts);
+    free(w.slots);
+    byte_buffer_free(&w.body);
+    byte_buffer_free(&w.raw);
+    byte_buffer_free(&w.stored);
+    return ok;
+}
+
+// Reads the whole file and checks its header; blocks are decoded by
+// chainpack_read
+ChainPack* chainpack_open(const char* filename) {
+    if (!filename) return NULL;
+
+    FILE* file = fopen(filename, "rb");
+    if (!file) return NULL;
+
+    long size = -1;
+    if (fseek(file, 0, SEEK_END) == 0) size = ftell(file);
+    ChainPack* pack = NULL;
+    if (size >= (long)CHAINPACK_HEADER_SIZE && fseek(file, 0, SEEK_SET) == 0)
+        pack = (ChainPack*)malloc(sizeof(ChainPack));
+    if (pack) pack->data = (uint8_t*)malloc((size_t)size);
+    if (!pack || !pack->data || fread(pack->data, 1, (size_t)size, file) != (size_t)size) {
+        if (pack) free(pack->data);
+        free(pack);
+        fclose(file);
+        return NULL;
+    }
+    fclose(file);
+
+    const uint8_t* data = pack->data;
+    pack->size = (size_t)size;
+    pack->difficulty = (int)(int32_t)get_le32(data + 12);
+    pack->block_count = get_le64(data + 16);
+    pack->has_checkpoint = (get_le32(data + 24) & CHAINPACK_HAS_CHECKPOINT) != 0;
+    int ok = memcmp(data, CHAINPACK_MAGIC, CHAINFILE_MAGIC_SIZE) == 0 && get_le32(data + 8) == CHAINPACK_VERSION;
+
+    if (ok && pack->has_checkpoint) {
+        ok = pack->size >= CHAINPACK_HEADER_SIZE + CHAINPACK_CHECKPOINT_SIZE;
+        if (ok) {
+            pack->checkpoint_height = get_le64(data + CHAINPACK_HEADER_SIZE);
+            memcpy(pack->checkpoint_hash, data + CHAINPACK_HEADER_SIZE + 8, SHA256_DIGEST_SIZE);
+        }
+    }
+    if (!ok) {
+        chainpack_close(pack);
+        return NULL;
+    }
+
+    METRIC_ADD(METRIC_LOAD_BYTES, pack->size);
+    return pack;
+}
+
+// Buffers reused from one segment to the next while reading
+typedef struct {
+    AccountId* accounts;  // the segment's dictionary, interned
+    size_t name_capacity;
+    Transaction* transactions;
+    size_t transaction_capacity;
+} PackReader;
+
+static int read_names(PackReader* r, const uint8_t** p, const uint8_t* end, uint64_t* count) {
+    if (!get_varint(p, end, count) || *count > (uint64_t)(end - *p)) return 0;
+
+    if (*count > r->name_capacity) {
+        AccountId* accounts = (AccountId*)realloc(r->accounts, (size_t)*count * sizeof(AccountId));
+        if (!accounts) return 0;
+        r->accounts = accounts;
+        r->name_capacity = (size_t)*count;
+    }
+
+    // Each name is interned once per segment, not once per transaction
+    for (uint64_t position = 0; position < *count; position++) {
+        char name[ACCOUNT_NAME_SIZE];
+        if (*p >= end) return 0;
+        size_t len = *(*p)++;
+        if (len > ACCOUNT_NAME_MAX || len > (size_t)(end - *p)) return 0;
+        memcpy(name, *p, len);
+        name[len] = '\0';
+        *p += len;
+        r->accounts[position] = account_intern(name);
+        if (r->accounts[position] == ACCOUNT_NONE) return 0;
+    }
+    return 1;
+}
+
+static int read_segment(PackReader* r, const uint8_t* p, size_t len, uint32_t block_count,
+                        chainpack_block_fn fn, void* context) {
+    const uint8_t* end = p + len;
+    uint64_t name_count;
+    if (!read_names(r, &p, end, &name_count)) return 0;
+
+    int64_t previous_index = -1, previous_timestamp = 0;
+    uint8_t previous_hash[SHA256_DIGEST_SIZE];
+    for (uint32_t b = 0; b < block_count; b++) {
+        ChainFileBlock record;
+        uint64_t index_delta, timestamp_delta, count;
+        memset(&record, 0, sizeof(record));
+
+        if (!get_varint(&p, end, &index_delta) || !get_varint(&p, end, &timestamp_delta) ||
+            !get_varint(&p, end, &record.nonce) || p >= end)
+            return 0;
+        int64_t step = unzigzag(index_delta);
+        if (step < -previous_index - 1 || step > (int64_t)UINT32_MAX - previous_index - 1) return 0;
+        int64_t index = previous_index + 1 + step;
+        record.index = (uint32_t)index;
+        record.timestamp = add_time_delta(previous_timestamp, timestamp_delta);
+
+        uint8_t flags = *p++;
+        if (flags & BLOCK_HAS_PREVIOUS_HASH) {
+            if (end - p < SHA256_DIGEST_SIZE) return 0;
+            memcpy(record.previous_hash, p, SHA256_DIGEST_SIZE);
+            p += SHA256_DIGEST_SIZE;
+        } else {
+            if (b == 0) return 0;
+            memcpy(record.previous_hash, previous_hash, SHA256_DIGEST_SIZE);
+        }
+        if (end - p < SHA256_DIGEST_SIZE) return 0;
+        memcpy(record.hash, p, SHA256_DIGEST_SIZE);
+        p += SHA256_DIGEST_SIZE;
+
+        if (!get_varint(&p, end, &count) || count > INT32_MAX || count > (uint64_t)(end - p) / TRANSACTION_PACKED_MIN)
+            return 0;
+        if (count > r->transaction_capacity) {
+            Transaction* transactions = (Transaction*)realloc(r->transactions, (size_t)count * sizeof(Transaction));
+            if (!transactions) return 0;
+            r->transactions = transactions;
+            r->transaction_capacity = (size_t)count;
+        }
+
+        for (uint64_t i = 0; i < count; i++) {
+            Transaction* tx = &r->transactions[i];
+            uint64_t sender, receiver, tx_delta;
+            if (!get_varint(&p, end, &sender) || !get_varint(&p, end, &receiver) || sender >= name_count ||
+                receiver >= name_count || !get_amount(&p, end, &tx->amount) || !get_varint(&p, end, &tx_delta))
+                return 0;
+            tx->sender = r->accounts[sender];
+            tx->receiver = r->accounts[receiver];
+            tx->timestamp = (time_t)add_time_delta(record.timestamp, tx_delta);
+        }
+
+        record.transaction_count = (uint32_t)count;
+        if (!fn(context, &record, r->transactions)) return 0;
+        previous_index = index;
+        previous_timestamp = record.timestamp;
+        memcpy(previous_hash, record.hash, SHA256_DIGEST_SIZE);
+    }
+    return p == end;
+}
+
+// Decodes every block in order and hands it to fn. Returns 0 if the file
+// is damaged or fn stops the read.
+int chainpack_read(ChainPack* pack, chainpack_block_fn fn, void* context) {
+    if (!pack || !fn) return 0;
+
+    PackReader reader;
+    memset(&reader, 0, sizeof(reader));
+    ByteBuffer raw;
+    byte_buffer_init(&raw);
+
+    size_t offset = CHAINPACK_HEADER_SIZE + (pack->has_checkpoint ? CHAINPACK_CHECKPOINT_SIZE : 0);
+    uint64_t blocks = 0;
+    int ok = 1;
+    while (ok && blocks < pack->block_count) {
+        if (pack->size - offset < CHAINPACK_SEGMENT_HEADER_SIZE) {
+            ok = 0;
+            break;
+        }
+        const uint8_t* header = pack->data + offset;
+        uint8_t codec = header[0];
+        size_t raw_size = get_le32(header + 1);
+        size_t stored_size = get_le32(header + 5);
+        uint32_t segment_blocks = get_le32(header + 9);
+        offset += CHAINPACK_SEGMENT_HEADER_SIZE;
+        if (stored_size > pack->size - offset || segment_blocks > pack->block_count - blocks) {
+            ok = 0;
+            break;
+        }
+
+        // Stored segments are read in place
+        const uint8_t* segment = pack->data + offset;
+        if (codec == CHAINPACK_LZ) {
+            ok = byte_buffer_reserve(&raw, raw_size) &&
+                 lz_decompress(segment, stored_size, raw.data, raw_size) == raw_size;
+            segment = raw.data;
+        } else {
+            ok = codec == CHAINPACK_STORED && raw_size == stored_size;
+        }
+
+        ok = ok && read_segment(&reader, segment, raw_size, segment_blocks, fn, context);
+        offset += stored_size;
+        blocks += segment_blocks;
+    }
+
+    free(reader.accounts);
+    free(reader.transactions);
+    byte_buffer_free(&raw);
+    return ok && blocks == pack->block_count && offset == pack->size;
+}
+
+void chainpack_close(ChainPack* pack) {
+    if (!pack) return;
+
+    free(pack->data);
+    free(pack);
+}
@@ -0,0 +1,70 @@
+#ifndef CHAINPACK_H
+#define CHAINPACK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "blockchain.h"
+#include "chainfile.h"
+
+// Compact chain file for storage and transfer. Unlike the version 4 chain
+// file it cannot be mapped in place, but it is smaller:
+// account names go into a per-segment dictionary, numbers are varints,
+// timestamps and indexes are stored as deltas, amounts that are whole
+// cents take a varint, and each segment may be LZ-compressed (lz.h).
+//
+//   header: magic, u32 version, i32 difficulty, u64 block count, u32
+//           flags, u32 reserved
+//   checkpoint, if flagged: u64 height, block hash
+//   segments, each: u8 codec, u32 raw size, u32 stored size, u32 block
+//           count, then the stored bytes
+//
+// A segment decodes on its own. Raw, it holds varint name count, each
+// name as u8 length and bytes, then each block:
+//   varint zigzag(index - previous index - 1), varint zigzag(timestamp -
+//   previous timestamp), varint nonce, u8 flags, previous hash unless it
+//   is the hash of the block before, hash, varint transaction count
+// and each transaction:
+//   varint sender, varint receiver (dictionary positions), amount as
+//   varint zigzag(cents) << 1 | 1 or a 0 byte and the f64, varint
+//   zigzag(timestamp - block timestamp)
+// All fixed-width integers are little-endian.
+#define CHAINPACK_MAGIC "BLKCPACK"
+#define CHAINPACK_VERSION 1
+#define CHAINPACK_HEADER_SIZE (CHAINFILE_MAGIC_SIZE + 4 + 4 + 8 + 4 + 4)
+#define CHAINPACK_CHECKPOINT_SIZE (8 + SHA256_DIGEST_SIZE)
+#define CHAINPACK_SEGMENT_HEADER_SIZE (1 + 4 + 4 + 4)
+#define CHAINPACK_HAS_CHECKPOINT 1u
+#define CHAINPACK_DEFAULT_SEGMENT_SIZE (64 * 1024)
+
+typedef enum {
+    CHAINPACK_STORED = 0,
+    CHAINPACK_LZ = 1
+} ChainPackCodec;
+
+typedef struct ChainPackOptions {
+    int compress;         // LZ-compress each segment that shrinks by it
+    size_t segment_size;  // raw bytes after which a segment is closed; 0 for the default
+} ChainPackOptions;
+
+// A pack file read into memory
+typedef struct {
+    uint8_t* data;
+    size_t size;
+    int difficulty;
+    uint64_t block_count;
+    int has_checkpoint;
+    uint64_t checkpoint_height;
+    uint8_t checkpoint_hash[SHA256_DIGEST_SIZE];
+} ChainPack;
+
+// Called for each block in order; returning 0 stops the read
+typedef int (*chainpack_block_fn)(void* context, const ChainFileBlock* record, const Transaction* transactions);
+
+// Function declarations
+int chainpack_is_chainpack(const char* filename);
+int chainpack_save(Blockchain* chain, const char* filename, const ChainPackOptions* options);
+ChainPack* chainpack_open(const char* filename);
+int chainpack_read(ChainPack* pack, chainpack_block_fn fn, void* context);
+void chainpack_close(ChainPack* pack);
+
+#endif // CHAINPACK_H
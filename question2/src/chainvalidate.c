@@ -0,0 +1,420 @@
+#include "chainvalidate.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+// A run of whole block records read from the file
+typedef struct {
+    uint8_t* data;
+    size_t capacity;
+    size_t used;
+    uint64_t first_height;
+    uint8_t previous_hash[SHA256_DIGEST_SIZE];  // hash of the block before the first one
+} ValidationBatch;
+
+// Bounded FIFO of batches; pop returns NULL once it is closed and drained
+typedef struct {
+    ValidationBatch** items;
+    int capacity;
+    int head;
+    int count;
+    int closed;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+} BatchQueue;
+
+typedef struct {
+    int fd;
+    int difficulty;
+    uint64_t block_count;
+    ChainFileNames names;  // the file's name table, interned
+    uint64_t records_size;  // bytes of records between the header and the offset table
+    BatchQueue free_batches;
+    BatchQueue full_batches;
+    atomic_uint_least64_t first_invalid;  // UINT64_MAX while every block checked out
+    atomic_uint_least64_t blocks_checked;
+    uint64_t bytes_read;
+} FileValidator;
+
+static int queue_init(BatchQueue* queue, int capacity) {
+    queue->items = (ValidationBatch**)malloc((size_t)capacity * sizeof(ValidationBatch*));
+    if (!queue->items) return 0;
+
+    queue->capacity = capacity;
+    queue->head = 0;
+    queue->count = 0;
+    queue->closed = 0;
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->changed, NULL);
+    return 1;
+}
+
+static void queue_free(BatchQueue* queue) {
+    pthread_mutex_destroy(&queue->lock);
+    pthread_cond_destroy(&queue->changed);
+    free(queue->items);
+}
+
+static void queue_push(BatchQueue* queue, ValidationBatch* batch) {
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count == queue->capacity)
+        pthread_cond_wait(&queue->changed, &queue->lock);
+    queue->items[(queue->head + queue->count) % queue->capacity] = batch;
+    queue->count++;
+    pthread_cond_broadcast(&queue->changed);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+static ValidationBatch* queue_pop(BatchQueue* queue) {
+    ValidationBatch* batch = NULL;
+
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count == 0 && !queue->closed)
+        pthread_cond_wait(&queue->changed, &queue->lock);
+    if (queue->count > 0) {
+        batch = queue->items[queue->head];
+        queue->head = (queue->head + 1) % queue->capacity;
+        queue->count--;
+        pthread_cond_broadcast(&queue->changed);
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return batch;
+}
+
+static void queue_close(BatchQueue* queue) {
+    pthread_mutex_lock(&queue->lock);
+    queue->closed = 1;
+    pthread_cond_broadcast(&queue->changed);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+// Keeps the lowest bad height seen by any thread
+static void record_failure(FileValidator* validator, uint64_t height) {
+    uint64_t known = atomic_load(&validator->first_invalid);
+    while (height < known && !atomic_compare_exchange_weak(&validator->first_invalid, &known, height))
+        ;
+}
+
+// verify_block rebuilds the root from the transactions; the stored one,
+// which mapped blocks use instead, must give the same block hash
+static int stored_root_matches(const Block* block) {
+    uint8_t hash[SHA256_DIGEST_SIZE];
+
+    compute_block_hash(block, block->tx_tree.root, hash);
+    return memcmp(hash, block->hash, SHA256_DIGEST_SIZE) == 0;
+}
+
+static void* hashing_worker(void* arg) {
+    FileValidator* validator = (FileValidator*)arg;
+    ValidationBatch* batch;
+    // Used only when the file's account IDs are not the process's
+    Transaction* scratch = NULL;
+    size_t capacity = 0;
+
+    while ((batch = queue_pop(&validator->full_batches)) != NULL) {
+        const uint8_t* previous_hash = batch->first_height > 0 ? batch->previous_hash : NULL;
+        uint64_t height = batch->first_height;
+        uint64_t checked = 0;
+
+        for (size_t offset = 0; offset < batch->used; height++) {
+            if (height >= atomic_load(&validator->first_invalid)) break;
+
+            const ChainFileBlock* record = (const ChainFileBlock*)(batch->data + offset);
+            if (!validator->names.identity && record->transaction_count > capacity) {
+                Transaction* grown = (Transaction*)realloc(scratch, record->transaction_count * sizeof(Transaction));
+                if (!grown) {
+                    record_failure(validator, height);
+                    break;
+                }
+                scratch = grown;
+                capacity = record->transaction_count;
+            }
+
+            Block block;
+            const Transaction* transactions = chainfile_transactions(
+                &validator->names, (const ChainFileTransaction*)(record + 1), record->transaction_count, scratch);
+            if (transactions) chainfile_block_view(record, transactions, &block);
+            // The last block was saved as the tip, which is mined only when sealed
+            int difficulty = height + 1 == validator->block_count ? 0 : validator->difficulty;
+            if (!transactions || !verify_block(&block, previous_hash, difficulty) || !stored_root_matches(&block)) {
+                record_failure(validator, height);
+                break;
+            }
+
+            previous_hash = record->hash;
+            offset += chainfile_record_size(record->transaction_count);
+            checked++;
+        }
+
+        atomic_fetch_add(&validator->blocks_checked, checked);
+        queue_push(&validator->free_batches, batch);
+    }
+    free(scratch);
+    return NULL;
+}
+
+// Fills batch from len up to its capacity or the end of the records
+static int fill_batch(FileValidator* validator, ValidationBatch* batch, size_t* len, uint64_t* remaining) {
+    while (*len < batch->capacity && *remaining > 0) {
+        size_t want = batch->capacity - *len;
+        if (want > *remaining) want = (size_t)*remaining;
+
+        ssize_t n = read(validator->fd, batch->data + *len, want);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return 0;
+        // A file cut short ends at the first incomplete record
+        if (n == 0) {
+            *remaining = 0;
+            break;
+        }
+
+        *len += (size_t)n;
+        *remaining -= (uint64_t)n;
+        validator->bytes_read += (uint64_t)n;
+    }
+    return 1;
+}
+
+// Cuts the file into batches of whole records and queues them. A record
+// split by the end of a read is carried over to the start of the next batch.
+static void read_batches(FileValidator* validator) {
+    uint64_t remaining = validator->records_size;
+    uint64_t height = 0;
+    uint8_t previous_hash[SHA256_DIGEST_SIZE];
+    ValidationBatch* batch = queue_pop(&validator->free_batches);
+    size_t len = 0;
+
+    memset(previous_hash, 0, sizeof(previous_hash));
+    while (height < atomic_load(&validator->first_invalid)) {
+        if (!fill_batch(validator, batch, &len, &remaining)) {
+            record_failure(validator, height);
+            break;
+        }
+        if (len == 0) break;
+
+        // Find where the last whole record in the batch ends
+        size_t end = 0;
+        uint64_t count = 0;
+        size_t needed = 0;
+        while (len - end >= sizeof(ChainFileBlock)) {
+            const ChainFileBlock* record = (const ChainFileBlock*)(batch->data + end);
+            size_t size = chainfile_record_size(record->transaction_count);
+            if (size > len - end) {
+                needed = size;
+                break;
+            }
+            end += size;
+            count++;
+        }
+        if (needed == 0 && len - end > 0) needed = sizeof(ChainFileBlock);
+
+        if (count == 0) {
+            // The next record runs past the end of the file, or past a whole batch
+            if (needed > len + remaining || height >= validator->block_count) {
+                record_failure(validator, height);
+                break;
+            }
+            uint8_t* data = (uint8_t*)realloc(batch->data, needed);
+            if (!data) {
+                record_failure(validator, height);
+                break;
+            }
+            batch->data = data;
+            batch->capacity = needed;
+            continue;
+        }
+        if (height + count > validator->block_count) {
+            record_failure(validator, validator->block_count);
+            break;
+        }
+
+        ValidationBatch* next = queue_pop(&validator->free_batches);
+        if (len - end > next->capacity) {
+            uint8_t* data = (uint8_t*)realloc(next->data, len - end);
+            if (!data) {
+                record_failure(validator, height);
+                queue_push(&validator->free_batches, next);
+                break;
+            }
+            next->data = data;
+            next->capacity = len - end;
+        }
+        memcpy(next->data, batch->data + end, len - end);
+        len -= end;
+
+        batch->used = end;
+        batch->first_height = height;
+        memcpy(batch->previous_hash, previous_hash, SHA256_DIGEST_SIZE);
+
+        // The last record's hash links the next batch to this one
+        size_t last = 0;
+        for (size_t offset = 0; offset < end; ) {
+            last = offset;
+            offset += chainfile_record_size(((const ChainFileBlock*)(batch->data + offset))->transaction_count);
+        }
+        memcpy(previous_hash, ((const ChainFileBlock*)(batch->data + last))->hash, SHA256_DIGEST_SIZE);
+
+        height += count;
+        queue_push(&validator->full_batches, batch);
+        batch = next;
+    }
+
+    if (height < validator->block_count) record_failure(validator, height);
+    queue_push(&validator->free_batches, batch);
+}
+
+// Reads and interns the name table, which lies after the records; no
+// name is longer than ACCOUNT_NAME_MAX, which bounds the read
+static int read_names(FileValidator* validator, const ChainFileHeader* header) {
+    struct stat st;
+    if (fstat(validator->fd, &st) != 0 || header->names_offset > (uint64_t)st.st_size) return 0;
+
+    uint64_t len = (uint64_t)st.st_size - header->names_offset;
+    uint64_t longest = (uint64_t)header->name_count * (1 + ACCOUNT_NAME_MAX);
+    if (len > longest) len = longest;
+
+    uint8_t* table = (uint8_t*)malloc(len ? (size_t)len : 1);
+    if (!table) return 0;
+
+    size_t got = 0;
+    while (got < len) {
+        ssize_t n = pread(validator->fd, table + got, (size_t)len - got, (off_t)(header->names_offset + got));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        got += (size_t)n;
+    }
+
+    int ok = got == len && chainfile_read_names(table, (size_t)len, header->name_count, &validator->names);
+    validator->bytes_read += got;
+    free(table);
+    return ok;
+}
+
+static int read_header(FileValidator* validator) {
+    ChainFileHeader header;
+    size_t got = 0;
+
+    while (got < sizeof(header)) {
+        ssize_t n = read(validator->fd, (uint8_t*)&header + got, sizeof(header) - got);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return 0;
+        got += (size_t)n;
+    }
+    validator->bytes_read = got;
+
+    if (memcmp(header.magic, CHAINFILE_MAGIC, CHAINFILE_MAGIC_SIZE) != 0 ||
+        header.version != CHAINFILE_VERSION ||
+        header.header_size != sizeof(ChainFileHeader) ||
+        header.record_header_size != sizeof(ChainFileBlock) ||
+        header.transaction_size != sizeof(ChainFileTransaction) ||
+        header.index_offset < sizeof(ChainFileHeader))
+        return 0;
+
+    validator->difficulty = header.difficulty;
+    validator->block_count = header.block_count;
+    validator->records_size = header.index_offset - sizeof(ChainFileHeader);
+    return read_names(validator, &header);
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Validates a chain file without loading it: the calling thread reads
+// batches of records while the workers hash them. Returns 1 if every
+// block is valid; report says where the first problem is and how fast
+// the file was read.
+int validate_chain_file(const char* filename, const FileValidationOptions* options, FileValidationReport* report) {
+    FileValidator validator;
+    double start = now_seconds();
+
+    if (report) {
+        memset(report, 0, sizeof(FileValidationReport));
+        report->first_invalid = 0;
+    }
+    if (!filename) return 0;
+
+    validator.fd = open(filename, O_RDONLY);
+    if (validator.fd < 0) return 0;
+    if (!read_header(&validator)) {
+        close(validator.fd);
+        return 0;
+    }
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(validator.fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    int num_threads = options ? options->num_threads : 0;
+    size_t batch_size = options ? options->batch_size : 0;
+    int depth = options ? options->queue_depth : 0;
+    if (num_threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        num_threads = cpus > 0 ? (int)cpus : 1;
+    }
+    if (batch_size < sizeof(ChainFileBlock)) batch_size = FILE_VALIDATION_BATCH_SIZE;
+    // The reader holds one batch and carries the next, so at least two
+    if (depth < 2) depth = 2 * num_threads + 1;
+
+    ValidationBatch* batches = (ValidationBatch*)calloc((size_t)depth, sizeof(ValidationBatch));
+    pthread_t* threads = (pthread_t*)malloc((size_t)num_threads * sizeof(pthread_t));
+    int queues = batches && threads && queue_init(&validator.free_batches, depth);
+    if (queues && !queue_init(&validator.full_batches, depth)) {
+        queue_free(&validator.free_batches);
+        queues = 0;
+    }
+
+    int allocated = 0;
+    for (; queues && allocated < depth; allocated++) {
+        batches[allocated].data = (uint8_t*)malloc(batch_size);
+        if (!batches[allocated].data) break;
+        batches[allocated].capacity = batch_size;
+        queue_push(&validator.free_batches, &batches[allocated]);
+    }
+
+    atomic_init(&validator.first_invalid, UINT64_MAX);
+    atomic_init(&validator.blocks_checked, 0);
+
+    int started = 0;
+    if (queues && allocated == depth) {
+        for (; started < num_threads; started++) {
+            if (pthread_create(&threads[started], NULL, hashing_worker, &validator) != 0) break;
+        }
+    }
+
+    if (started > 0) {
+        read_batches(&validator);
+        queue_close(&validator.full_batches);
+        for (int i = 0; i < started; i++)
+            pthread_join(threads[i], NULL);
+    } else {
+        record_failure(&validator, 0);
+    }
+
+    if (queues) {
+        queue_free(&validator.free_batches);
+        queue_free(&validator.full_batches);
+    }
+    for (int i = 0; i < allocated; i++)
+        free(batches[i].data);
+    free(batches);
+    free(threads);
+    chainfile_free_names(&validator.names);
+    close(validator.fd);
+
+    uint64_t bad = atomic_load(&validator.first_invalid);
+    if (report) {
+        report->blocks = atomic_load(&validator.blocks_checked);
+        report->first_invalid = bad == UINT64_MAX ? -1 : (long)bad;
+        report->bytes = validator.bytes_read;
+        report->seconds = now_seconds() - start;
+        if (report->seconds > 0) report->mb_per_second = report->bytes / 1e6 / report->seconds;
+    }
+    return bad == UINT64_MAX;
+}
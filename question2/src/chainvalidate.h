@@ -0,0 +1,30 @@
+#ifndef CHAINVALIDATE_H
+#define CHAINVALIDATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "chainfile.h"
+
+#define FILE_VALIDATION_BATCH_SIZE (4 << 20)
+
+// Streaming validation settings. Memory use is queue_depth * batch_size
+// whatever the chain's length; only a single block larger than a batch
+// makes its batch grow to fit it.
+typedef struct {
+    int num_threads;    // hashing workers; 0 or less uses one per CPU
+    size_t batch_size;  // bytes per read; 0 picks FILE_VALIDATION_BATCH_SIZE
+    int queue_depth;    // batches in flight; 0 picks two per worker plus one
+} FileValidationOptions;
+
+typedef struct {
+    uint64_t blocks;     // blocks hashed and found valid
+    long first_invalid;  // height of the first bad or unreadable block, -1 if none
+    uint64_t bytes;      // bytes read from the file
+    double seconds;
+    double mb_per_second;
+} FileValidationReport;
+
+// Function declarations
+int validate_chain_file(const char* filename, const FileValidationOptions* options, FileValidationReport* report);
+
+#endif // CHAINVALIDATE_H
@@ -0,0 +1,398 @@
+#include "chainwriter.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+
+#define RING_ENTRIES 4
+#define MAX_WRITE (1u << 30)  // bytes per write request
+
+#if defined(__linux__) && defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define HAVE_IO_URING 1
+
+// A submission and a completion ring shared with the kernel, set up and
+// driven with the raw io_uring_setup and io_uring_enter syscalls
+typedef struct IoRing {
+    int fd;
+    uint8_t* sq_ring;
+    size_t sq_ring_size;
+    uint8_t* cq_ring;
+    size_t cq_ring_size;
+    struct io_uring_sqe* sqes;
+    size_t sqes_size;
+    unsigned* sq_tail;  // the kernel moves the heads, this side the tails
+    unsigned sq_mask;
+    unsigned* sq_array;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned cq_mask;
+    struct io_uring_cqe* cqes;
+} IoRing;
+
+static void ring_close(IoRing* ring) {
+    if (!ring) return;
+
+    if (ring->sqes && ring->sqes != MAP_FAILED) munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_ring && ring->cq_ring != MAP_FAILED && ring->cq_ring != ring->sq_ring)
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    if (ring->sq_ring && ring->sq_ring != MAP_FAILED) munmap(ring->sq_ring, ring->sq_ring_size);
+    close(ring->fd);
+    free(ring);
+}
+
+// NULL where the kernel has no io_uring or refuses it, as sandboxes may
+static IoRing* ring_open(void) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = (int)syscall(__NR_io_uring_setup, RING_ENTRIES, &params);
+    if (fd < 0) return NULL;
+
+    IoRing* ring = (IoRing*)calloc(1, sizeof(IoRing));
+    if (!ring) {
+        close(fd);
+        return NULL;
+    }
+    ring->fd = fd;
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    // Newer kernels map both rings at once
+    int single_map = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_map && ring->cq_ring_size > ring->sq_ring_size) ring->sq_ring_size = ring->cq_ring_size;
+
+    ring->sq_ring = (uint8_t*)mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                                   IORING_OFF_SQ_RING);
+    ring->cq_ring = single_map ? ring->sq_ring
+                               : (uint8_t*)mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE,
+                                                MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    ring->sqes = (struct io_uring_sqe*)mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                            fd, IORING_OFF_SQES);
+    if (ring->sq_ring == MAP_FAILED || ring->cq_ring == MAP_FAILED || ring->sqes == MAP_FAILED) {
+        ring_close(ring);
+        return NULL;
+    }
+
+    ring->sq_tail = (unsigned*)(ring->sq_ring + params.sq_off.tail);
+    ring->sq_mask = *(unsigned*)(ring->sq_ring + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned*)(ring->sq_ring + params.sq_off.array);
+    ring->cq_head = (unsigned*)(ring->cq_ring + params.cq_off.head);
+    ring->cq_tail = (unsigned*)(ring->cq_ring + params.cq_off.tail);
+    ring->cq_mask = *(unsigned*)(ring->cq_ring + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)(ring->cq_ring + params.cq_off.cqes);
+    return ring;
+}
+
+// Writes len bytes at offset and, if sync is set, an fdatasync linked to
+// run once the write completes in full, with one syscall for both. The
+// results are the kernel's: bytes or -errno, and 0 or -errno (-ECANCELED
+// after a short write). Returns 0 if the ring itself failed.
+static int ring_write(IoRing* ring, int fd, const uint8_t* data, size_t len, uint64_t offset, int sync,
+                      int* written, int* synced) {
+    unsigned tail = *ring->sq_tail;
+    unsigned count = sync ? 2 : 1;
+
+    for (unsigned i = 0; i < count; i++) {
+        unsigned index = (tail + i) & ring->sq_mask;
+        struct io_uring_sqe* sqe = &ring->sqes[index];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->fd = fd;
+        sqe->user_data = i;
+        if (i == 0) {
+            sqe->opcode = IORING_OP_WRITE;
+            sqe->addr = (uint64_t)(uintptr_t)data;
+            sqe->len = (uint32_t)len;
+            sqe->off = offset;
+            if (sync) sqe->flags = IOSQE_IO_LINK;
+        } else {
+            sqe->opcode = IORING_OP_FSYNC;
+            sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+        }
+        ring->sq_array[index] = index;
+    }
+    // The kernel reads the entries only after it sees the new tail
+    __atomic_store_n(ring->sq_tail, tail + count, __ATOMIC_RELEASE);
+
+    int results[2] = { 0, 0 };
+    unsigned to_submit = count, completed = 0;
+    while (completed < count) {
+        long consumed = syscall(__NR_io_uring_enter, ring->fd, to_submit, count - completed, IORING_ENTER_GETEVENTS,
+                                NULL, 0);
+        if (consumed < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) return 0;
+        if (consumed > 0) to_submit -= (unsigned)consumed < to_submit ? (unsigned)consumed : to_submit;
+
+        unsigned head = *ring->cq_head;
+        unsigned end = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != end; head++) {
+            const struct io_uring_cqe* cqe = &ring->cqes[head & ring->cq_mask];
+            if (cqe->user_data < 2) results[cqe->user_data] = cqe->res;
+            completed++;
+        }
+        __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    *written = results[0];
+    *synced = results[1];
+    return 1;
+}
+#else
+typedef struct IoRing {
+    int fd;
+} IoRing;
+
+static void ring_close(IoRing* ring) {
+    (void)ring;
+}
+
+static IoRing* ring_open(void) {
+    return NULL;
+}
+#endif
+
+// Writes a batch at offset and syncs it unless syncing is skipped,
+// retrying after short writes
+static int write_batch(ChainWriter* writer, const uint8_t* data, size_t size, uint64_t offset) {
+    int fd = writer->log->fd;
+    int sync = !writer->options.skip_sync;
+    size_t done = 0;
+
+    while (done < size) {
+        size_t chunk = size - done < MAX_WRITE ? size - done : MAX_WRITE;
+        int last = done + chunk == size;
+
+#ifdef HAVE_IO_URING
+        if (writer->backend == CHAINWRITER_BACKEND_IO_URING) {
+            int written, synced;
+            if (!ring_write(writer->ring, fd, data + done, chunk, offset + done, sync && last, &written, &synced))
+                return 0;
+
+            // Kernels before 5.6 have io_uring but not its plain write
+            if (written == -EINVAL && writer->batches_written == 0 && done == 0) {
+                writer->backend = CHAINWRITER_BACKEND_PWRITE;
+                continue;
+            }
+            if (written == -EINTR || written == -EAGAIN) continue;
+            if (written <= 0) return 0;
+
+            done += (size_t)written;
+            if (sync && last && (size_t)written == chunk && synced < 0) return 0;
+            continue;
+        }
+#endif
+        ssize_t written = pwrite(fd, data + done, chunk, (off_t)(offset + done));
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return 0;
+
+        done += (size_t)written;
+        if (sync && done == size && fdatasync(fd) != 0) return 0;
+    }
+    return 1;
+}
+
+// Fills in the checksums, off the producer's thread, then appends the
+// batch to the log. A failed write is cut off again; if that fails too,
+// the log is marked failed. Either way the caller marks the writer failed.
+static int write_entries(ChainWriter* writer, ByteBuffer* batch) {
+    ChainLog* log = writer->log;
+    uint64_t blocks = 0;
+
+    for (size_t offset = 0; offset < batch->size; blocks++) {
+        ChainLogEntry entry;
+        memcpy(&entry, batch->data + offset, sizeof(entry));
+        entry.checksum = chainlog_checksum(batch->data + offset + sizeof(entry), entry.length);
+        memcpy(batch->data + offset, &entry, sizeof(entry));
+        offset += sizeof(entry) + entry.length;
+    }
+
+    if (!write_batch(writer, batch->data, batch->size, log->size)) {
+        if (ftruncate(log->fd, (off_t)log->size) != 0) log->failed = 1;
+        return 0;
+    }
+
+    log->size += batch->size;
+    log->blocks_written += blocks;
+    log->bytes_written += batch->size;
+    chainlog_note_written(log, (int)blocks, !writer->options.skip_sync);
+
+    writer->batches_written++;
+    writer->blocks_written += blocks;
+    writer->bytes_written += batch->size;
+    return 1;
+}
+
+// Takes whatever batch has gathered, leaves the other one to the
+// producer, and writes it; until told to stop with nothing left
+static void* writer_thread(void* arg) {
+    ChainWriter* writer = (ChainWriter*)arg;
+
+    pthread_mutex_lock(&writer->lock);
+    for (;;) {
+        ByteBuffer* batch = &writer->batches[writer->filling];
+        while (batch->size == 0 && !writer->stopping)
+            pthread_cond_wait(&writer->wake, &writer->lock);
+        if (batch->size == 0) break;
+
+        writer->filling ^= 1;
+        uint64_t first = writer->filling_first, end = writer->submitted_end;
+        writer->filling_first = end;
+        int failed = writer->failed;
+        // A producer held back by max_pending has an empty batch again
+        pthread_cond_broadcast(&writer->written);
+        pthread_mutex_unlock(&writer->lock);
+
+        // The callback runs before any waiter is woken for the same blocks
+        int ok = !failed && write_entries(writer, batch);
+        if (writer->options.on_durable) writer->options.on_durable(writer->options.context, first, end, ok);
+
+        pthread_mutex_lock(&writer->lock);
+        batch->size = 0;
+        if (ok) writer->durable_end = end;
+        else writer->failed = 1;
+        pthread_cond_broadcast(&writer->written);
+    }
+    pthread_mutex_unlock(&writer->lock);
+    return NULL;
+}
+
+static void free_writer(ChainWriter* writer) {
+    ring_close(writer->ring);
+    byte_buffer_free(&writer->batches[0]);
+    byte_buffer_free(&writer->batches[1]);
+    byte_buffer_free(&writer->encoded);
+    pthread_cond_destroy(&writer->written);
+    pthread_cond_destroy(&writer->wake);
+    pthread_mutex_destroy(&writer->lock);
+    free(writer);
+}
+
+// Starts a writer thread that appends to a replayed log from now on; the
+// next block submitted is at next_height. What the log holds already is
+// synced first, so every height below next_height counts as durable.
+ChainWriter* chainwriter_start(ChainLog* log, uint64_t next_height, const ChainWriterOptions* options) {
+    if (!log || log->size == 0 || !chainlog_sync(log)) return NULL;
+
+    ChainWriter* writer = (ChainWriter*)calloc(1, sizeof(ChainWriter));
+    if (!writer) return NULL;
+
+    writer->log = log;
+    if (options) writer->options = *options;
+    if (writer->options.max_pending == 0) writer->options.max_pending = CHAINWRITER_DEFAULT_MAX_PENDING;
+    writer->backend = writer->options.backend;
+    if (writer->backend == CHAINWRITER_BACKEND_IO_URING && !(writer->ring = ring_open()))
+        writer->backend = CHAINWRITER_BACKEND_PWRITE;
+
+    writer->filling_first = next_height;
+    writer->submitted_end = next_height;
+    writer->durable_end = next_height;
+    byte_buffer_init(&writer->batches[0]);
+    byte_buffer_init(&writer->batches[1]);
+    byte_buffer_init(&writer->encoded);
+    pthread_mutex_init(&writer->lock, NULL);
+    pthread_cond_init(&writer->wake, NULL);
+    pthread_cond_init(&writer->written, NULL);
+
+    if (pthread_create(&writer->thread, NULL, writer_thread, writer) != 0) {
+        free_writer(writer);
+        return NULL;
+    }
+    return writer;
+}
+
+// Encodes the block into the batch being filled and returns; the block
+// may change or be freed as soon as this returns. Blocks must come in
+// height order. Waits only while max_pending bytes are already queued.
+int chainwriter_submit(ChainWriter* writer, const Block* block) {
+    if (!writer || !block || block->transaction_count < 0) return 0;
+    if (!encode_block(block, &writer->encoded) || writer->encoded.size > UINT32_MAX) return 0;
+
+    ChainLogEntry entry;
+    entry.length = (uint32_t)writer->encoded.size;
+    entry.reserved = 0;
+    entry.checksum = 0;  // filled in on the writer thread
+    size_t need = sizeof(entry) + entry.length;
+
+    pthread_mutex_lock(&writer->lock);
+    ByteBuffer* batch = &writer->batches[writer->filling];
+    while (!writer->failed && batch->size > 0 && batch->size + need > writer->options.max_pending) {
+        pthread_cond_wait(&writer->written, &writer->lock);
+        batch = &writer->batches[writer->filling];
+    }
+
+    int ok = !writer->failed && byte_buffer_reserve(batch, batch->size + need);
+    if (ok) {
+        if (batch->size == 0) writer->filling_first = block->index;
+        memcpy(batch->data + batch->size, &entry, sizeof(entry));
+        memcpy(batch->data + batch->size + sizeof(entry), writer->encoded.data, entry.length);
+        batch->size += need;
+        writer->submitted_end = (uint64_t)block->index + 1;
+        pthread_cond_signal(&writer->wake);
+    }
+    pthread_mutex_unlock(&writer->lock);
+    return ok;
+}
+
+// The future for a submitted block: waits until the block at height is
+// durable. Returns 0 if it was never submitted or could not be written.
+int chainwriter_wait(ChainWriter* writer, uint64_t height) {
+    if (!writer) return 0;
+
+    pthread_mutex_lock(&writer->lock);
+    while (height < writer->submitted_end && height >= writer->durable_end && !writer->failed)
+        pthread_cond_wait(&writer->written, &writer->lock);
+    int ok = height < writer->durable_end;
+    pthread_mutex_unlock(&writer->lock);
+    return ok;
+}
+
+// Waits until every block submitted so far is durable
+int chainwriter_flush(ChainWriter* writer) {
+    if (!writer) return 0;
+
+    pthread_mutex_lock(&writer->lock);
+    while (writer->durable_end < writer->submitted_end && !writer->failed)
+        pthread_cond_wait(&writer->written, &writer->lock);
+    int ok = !writer->failed;
+    pthread_mutex_unlock(&writer->lock);
+    return ok;
+}
+
+// Writes out what is left, stops the thread and frees the writer; the
+// log is left to its owner. Returns 0 if any batch failed.
+int chainwriter_stop(ChainWriter* writer) {
+    if (!writer) return 1;
+
+    pthread_mutex_lock(&writer->lock);
+    writer->stopping = 1;
+    pthread_cond_signal(&writer->wake);
+    pthread_mutex_unlock(&writer->lock);
+    pthread_join(writer->thread, NULL);
+
+    int ok = !writer->failed;
+    free_writer(writer);
+    return ok;
+}
+
+int chainwriter_backend_supported(CHAINWRITER_BACKEND backend) {
+    if (backend == CHAINWRITER_BACKEND_PWRITE) return 1;
+    if (backend != CHAINWRITER_BACKEND_IO_URING) return 0;
+
+    IoRing* ring = ring_open();
+    int supported = ring != NULL;
+    ring_close(ring);
+    return supported;
+}
+
+const char* chainwriter_backend_name(CHAINWRITER_BACKEND backend) {
+    switch (backend) {
+    case CHAINWRITER_BACKEND_IO_URING:
+        return "io_uring";
+    case CHAINWRITER_BACKEND_PWRITE:
+        return "pwrite";
+    }
+    return "unknown";
+}
@@ -0,0 +1,79 @@
+#ifndef CHAINWRITER_H
+#define CHAINWRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "chainlog.h"
+#include "encoding.h"
+
+// Background persistence for a chain log (chainlog.h). The thread sealing
+// blocks only encodes each one into an in-memory batch, and a writer
+// thread appends whole batches to the log and syncs them, so the producer
+// does not wait on the disk. There are two batch buffers: the producer
+// fills one while the other is written, and whatever gathers during a
+// write goes out with the next one. Entry checksums are computed on the
+// writer thread. The log format is unchanged, so open_blockchain_log
+// recovers whatever reached the disk.
+//
+// Batches go to disk through io_uring where the kernel allows it: the
+// write and an fdatasync linked after it are submitted with one syscall.
+// Otherwise the writer thread calls pwrite and fdatasync.
+//
+// A block is durable once the batch holding it is synced. The producer
+// finds out through on_durable, which runs on the writer thread before
+// anyone waiting for those blocks is woken, or by waiting on a height in
+// chainwriter_wait. Only one thread may submit blocks.
+#define CHAINWRITER_DEFAULT_MAX_PENDING (64 << 20)
+
+typedef enum {
+    CHAINWRITER_BACKEND_IO_URING = 0,
+    CHAINWRITER_BACKEND_PWRITE
+} CHAINWRITER_BACKEND;
+
+// Called on the writer thread once the blocks at heights first_height to
+// end_height - 1 are durable, or with ok 0 if writing them failed
+typedef void (*chainwriter_durable_fn)(void* context, uint64_t first_height, uint64_t end_height, int ok);
+
+typedef struct ChainWriterOptions {
+    CHAINWRITER_BACKEND backend;  // io_uring falls back to pwrite where the kernel refuses it
+    size_t max_pending;  // bytes waiting for the writer before submitting blocks; 0 for the default
+    int skip_sync;       // count a block durable once written, without fdatasync
+    chainwriter_durable_fn on_durable;
+    void* context;
+} ChainWriterOptions;
+
+struct IoRing;
+
+typedef struct ChainWriter {
+    ChainLog* log;  // written at log->size by the writer thread only
+    ChainWriterOptions options;
+    CHAINWRITER_BACKEND backend;  // the one in use
+    struct IoRing* ring;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;     // the writer waits here for blocks
+    pthread_cond_t written;  // the producer waits here for room or durability
+    ByteBuffer batches[2];
+    int filling;             // the batch blocks are added to
+    uint64_t filling_first;  // height of its first block
+    uint64_t submitted_end;  // heights below this have been submitted
+    uint64_t durable_end;    // heights below this are durable
+    int stopping;
+    int failed;
+    ByteBuffer encoded;  // the producer's encoding of the block being submitted
+    uint64_t batches_written;
+    uint64_t blocks_written;
+    uint64_t bytes_written;
+} ChainWriter;
+
+// Function declarations
+ChainWriter* chainwriter_start(ChainLog* log, uint64_t next_height, const ChainWriterOptions* options);
+int chainwriter_submit(ChainWriter* writer, const Block* block);
+int chainwriter_wait(ChainWriter* writer, uint64_t height);
+int chainwriter_flush(ChainWriter* writer);
+int chainwriter_stop(ChainWriter* writer);
+int chainwriter_backend_supported(CHAINWRITER_BACKEND backend);
+const char* chainwriter_backend_name(CHAINWRITER_BACKEND backend);
+
+#endif // CHAINWRITER_H
@@ -0,0 +1,142 @@
+#include "encoding.h"
+#include <stdlib.h>
+#include <string.h>
+
+static void put_le32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static void put_le64(uint8_t* p, uint64_t v) {
+    put_le32(p, (uint32_t)v);
+    put_le32(p + 4, (uint32_t)(v >> 32));
+}
+
+static uint32_t get_le32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t get_le64(const uint8_t* p) {
+    return (uint64_t)get_le32(p) | ((uint64_t)get_le32(p + 4) << 32);
+}
+
+void byte_buffer_init(ByteBuffer* buffer) {
+    buffer->data = NULL;
+    buffer->size = 0;
+    buffer->capacity = 0;
+}
+
+int byte_buffer_reserve(ByteBuffer* buffer, size_t capacity) {
+    if (capacity <= buffer->capacity) return 1;
+
+    size_t grown = buffer->capacity ? buffer->capacity * 2 : 256;
+    if (grown < capacity) grown = capacity;
+
+    uint8_t* data = (uint8_t*)realloc(buffer->data, grown);
+    if (!data) return 0;
+
+    buffer->data = data;
+    buffer->capacity = grown;
+    return 1;
+}
+
+void byte_buffer_free(ByteBuffer* buffer) {
+    free(buffer->data);
+    byte_buffer_init(buffer);
+}
+
+// The account's name with its length in front; an ID with no name
+// encodes as the empty name
+static size_t write_account(uint8_t* p, AccountId id) {
+    size_t len = 0;
+    const char* name = account_name(id, &len);
+    p[0] = (uint8_t)len;
+    if (name) memcpy(p + 1, name, len);
+    return 1 + len;
+}
+
+// Writes at most TRANSACTION_ENCODED_MAX bytes and returns how many
+size_t encode_transaction(const Transaction* tx, uint8_t out[]) {
+    uint64_t amount_bits;
+    size_t n = 0;
+
+    n += write_account(out + n, tx->sender);
+    n += write_account(out + n, tx->receiver);
+    memcpy(&amount_bits, &tx->amount, sizeof(amount_bits));
+    put_le64(out + n, amount_bits);
+    put_le64(out + n + 8, (uint64_t)(int64_t)tx->timestamp);
+    return n + 16;
+}
+
+// Interns the length-prefixed name at p; 0 if it is cut short or there
+// is no room to intern it
+static size_t read_account(const uint8_t* p, size_t len, AccountId* id) {
+    char name[ACCOUNT_NAME_SIZE];
+    if (len < 1 || p[0] > ACCOUNT_NAME_MAX || len - 1 < p[0]) return 0;
+
+    memcpy(name, p + 1, p[0]);
+    name[p[0]] = '\0';
+    *id = account_intern(name);
+    return *id != ACCOUNT_NONE ? 1 + (size_t)p[0] : 0;
+}
+
+// Returns the bytes consumed, or 0 if data does not hold a whole transaction
+size_t decode_transaction(const uint8_t* data, size_t len, Transaction* tx) {
+    uint64_t amount_bits;
+
+    memset(tx, 0, sizeof(Transaction));
+    size_t n = read_account(data, len, &tx->sender);
+    if (n == 0) return 0;
+    size_t m = read_account(data + n, len - n, &tx->receiver);
+    if (m == 0 || len - n - m < 16) return 0;
+    n += m;
+
+    amount_bits = get_le64(data + n);
+    memcpy(&tx->amount, &amount_bits, sizeof(tx->amount));
+    tx->timestamp = (time_t)(int64_t)get_le64(data + n + 8);
+    return n + 16;
+}
+
+void encode_block_header(const Block* block, const uint8_t merkle_root[], uint8_t out[]) {
+    put_le32(out, block->index);
+    put_le64(out + 4, (uint64_t)(int64_t)block->timestamp);
+    memcpy(out + 12, merkle_root, SHA256_DIGEST_SIZE);
+    memcpy(out + 12 + SHA256_DIGEST_SIZE, block->previous_hash, SHA256_DIGEST_SIZE);
+    put_le64(out + BLOCK_HEADER_NONCE_OFFSET, block->nonce);
+}
+
+// Replaces buffer's contents with the whole block
+int encode_block(const Block* block, ByteBuffer* buffer) {
+    size_t count = block->transaction_count > 0 ? (size_t)block->transaction_count : 0;
+    if (!byte_buffer_reserve(buffer, BLOCK_ENCODED_FIXED_SIZE + count * TRANSACTION_ENCODED_MAX)) return 0;
+
+    uint8_t* out = buffer->data;
+    put_le32(out, block->index);
+    put_le64(out + 4, (uint64_t)(int64_t)block->timestamp);
+    put_le64(out + 12, block->nonce);
+    memcpy(out + 20, block->previous_hash, SHA256_DIGEST_SIZE);
+    memcpy(out + 20 + SHA256_DIGEST_SIZE, block->hash, SHA256_DIGEST_SIZE);
+    put_le32(out + 20 + 2 * SHA256_DIGEST_SIZE, (uint32_t)count);
+
+    size_t n = BLOCK_ENCODED_FIXED_SIZE;
+    for (size_t i = 0; i < count; i++)
+        n += encode_transaction(&block->transactions[i], out + n);
+    buffer->size = n;
+    return 1;
+}
+
+// Reads the fields before the transactions into block; the transactions
+// follow at the returned offset. Returns 0 if data is too short.
+size_t decode_block_fixed(const uint8_t* data, size_t len, Block* block, uint32_t* transaction_count) {
+    if (len < BLOCK_ENCODED_FIXED_SIZE) return 0;
+
+    block->index = get_le32(data);
+    block->timestamp = (time_t)(int64_t)get_le64(data + 4);
+    block->nonce = get_le64(data + 12);
+    memcpy(block->previous_hash, data + 20, SHA256_DIGEST_SIZE);
+    memcpy(block->hash, data + 20 + SHA256_DIGEST_SIZE, SHA256_DIGEST_SIZE);
+    *transaction_count = get_le32(data + 20 + 2 * SHA256_DIGEST_SIZE);
+    return BLOCK_ENCODED_FIXED_SIZE;
+}
@@ -0,0 +1,45 @@
+#ifndef ENCODING_H
+#define ENCODING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "blockchain.h"
+
+// Canonical byte encodings shared by hashing and persistence. Integers are
+// little-endian and fixed-width whatever the host, amounts are IEEE-754
+// doubles stored as their 64-bit pattern, and strings carry a one-byte
+// length instead of a terminator, so two different transactions never
+// encode to the same bytes. Accounts are encoded by name, not by ID, so a
+// hash does not depend on the order names were interned in.
+//
+// Transaction: u8 sender length, sender, u8 receiver length, receiver,
+//              f64 amount, i64 timestamp
+// Block header (what the block hash covers, nonce last for midstates):
+//              u32 index, i64 timestamp, merkle root, previous hash, u64 nonce
+// Block:       u32 index, i64 timestamp, u64 nonce, previous hash, hash,
+//              u32 transaction count, then each transaction
+#define TRANSACTION_ENCODED_MAX (2 * (1 + ACCOUNT_NAME_MAX) + 2 * 8)
+#define TRANSACTION_ENCODED_MIN (2 * 1 + 2 * 8)
+#define BLOCK_HEADER_ENCODED_SIZE (4 + 8 + 2 * SHA256_DIGEST_SIZE + 8)
+#define BLOCK_HEADER_NONCE_OFFSET (BLOCK_HEADER_ENCODED_SIZE - 8)
+#define BLOCK_ENCODED_FIXED_SIZE (4 + 8 + 8 + 2 * SHA256_DIGEST_SIZE + 4)
+
+// Growable byte buffer, reused across encodings to avoid reallocating
+typedef struct {
+    uint8_t* data;
+    size_t size;
+    size_t capacity;
+} ByteBuffer;
+
+// Function declarations
+void byte_buffer_init(ByteBuffer* buffer);
+int byte_buffer_reserve(ByteBuffer* buffer, size_t capacity);
+void byte_buffer_free(ByteBuffer* buffer);
+
+size_t encode_transaction(const Transaction* tx, uint8_t out[]);
+size_t decode_transaction(const uint8_t* data, size_t len, Transaction* tx);
+void encode_block_header(const Block* block, const uint8_t merkle_root[], uint8_t out[]);
+int encode_block(const Block* block, ByteBuffer* buffer);
+size_t decode_block_fixed(const uint8_t* data, size_t len, Block* block, uint32_t* transaction_count);
+
+#endif // ENCODING_H
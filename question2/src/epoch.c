@@ -0,0 +1,130 @@
+#include "epoch.h"
+#include <stdlib.h>
+#include <sched.h>
+
+EpochDomain* epoch_create(void) {
+    EpochDomain* domain = (EpochDomain*)aligned_alloc(64, sizeof(EpochDomain));
+    if (!domain) return NULL;
+
+    // Epochs start above EPOCH_QUIESCENT so a reader's slot can tell them apart
+    atomic_init(&domain->global, EPOCH_QUIESCENT + 1);
+    for (int i = 0; i < EPOCH_MAX_READERS; i++) {
+        atomic_init(&domain->readers[i].epoch, EPOCH_QUIESCENT);
+        atomic_init(&domain->readers[i].claimed, 0);
+    }
+    domain->retired = NULL;
+    domain->retired_count = 0;
+    return domain;
+}
+
+// Claims a reader slot for the calling thread. Returns -1 if all are taken.
+int epoch_register(EpochDomain* domain) {
+    if (!domain) return -1;
+
+    for (int i = 0; i < EPOCH_MAX_READERS; i++) {
+        int expected = 0;
+        if (atomic_compare_exchange_strong(&domain->readers[i].claimed, &expected, 1)) return i;
+    }
+    return -1;
+}
+
+void epoch_unregister(EpochDomain* domain, int reader) {
+    if (!domain || reader < 0 || reader >= EPOCH_MAX_READERS) return;
+
+    atomic_store_explicit(&domain->readers[reader].epoch, EPOCH_QUIESCENT, memory_order_release);
+    atomic_store_explicit(&domain->readers[reader].claimed, 0, memory_order_release);
+}
+
+// Reads may not nest; a reader exits before it enters again
+void epoch_enter(EpochDomain* domain, int reader) {
+    uint64_t epoch = atomic_load_explicit(&domain->global, memory_order_acquire);
+    atomic_store_explicit(&domain->readers[reader].epoch, epoch, memory_order_relaxed);
+    // Pairs with the fence in epoch_reclaim: either the writer sees this
+    // epoch, or this reader sees everything the writer unpublished before
+    atomic_thread_fence(memory_order_seq_cst);
+}
+
+void epoch_exit(EpochDomain* domain, int reader) {
+    atomic_store_explicit(&domain->readers[reader].epoch, EPOCH_QUIESCENT, memory_order_release);
+}
+
+// The oldest epoch any reader is inside, or UINT64_MAX if none is reading
+static uint64_t oldest_reader(EpochDomain* domain) {
+    uint64_t oldest = UINT64_MAX;
+
+    atomic_thread_fence(memory_order_seq_cst);
+    for (int i = 0; i < EPOCH_MAX_READERS; i++) {
+        uint64_t epoch = atomic_load_explicit(&domain->readers[i].epoch, memory_order_acquire);
+        if (epoch != EPOCH_QUIESCENT && epoch < oldest) oldest = epoch;
+    }
+    return oldest;
+}
+
+// Hands over an object the writer has already unpublished. release frees
+// it once it is safe to; NULL means free().
+void epoch_retire(EpochDomain* domain, void* object, void (*release)(void* object)) {
+    if (!object) return;
+    if (!release) release = free;
+    if (!domain) {
+        release(object);
+        return;
+    }
+
+    // Readers that enter from now on start in a later epoch and cannot see it
+    uint64_t epoch = atomic_fetch_add_explicit(&domain->global, 1, memory_order_acq_rel);
+
+    EpochRetired* entry = (EpochRetired*)malloc(sizeof(EpochRetired));
+    if (!entry) {
+        // No room to defer it, so wait for the readers that might hold it
+        while (oldest_reader(domain) <= epoch)
+            sched_yield();
+        release(object);
+        return;
+    }
+
+    entry->object = object;
+    entry->release = release;
+    entry->epoch = epoch;
+    entry->next = domain->retired;
+    domain->retired = entry;
+    domain->retired_count++;
+}
+
+// Frees every retired object no reader can still hold. Returns how many.
+size_t epoch_reclaim(EpochDomain* domain) {
+    if (!domain || !domain->retired) return 0;
+
+    // The list is newest first, so everything past the first object older
+    // than every reader can go
+    uint64_t oldest = oldest_reader(domain);
+    EpochRetired** link = &domain->retired;
+    while (*link && (*link)->epoch >= oldest)
+        link = &(*link)->next;
+
+    EpochRetired* entry = *link;
+    *link = NULL;
+    size_t freed = 0;
+    while (entry) {
+        EpochRetired* next = entry->next;
+        entry->release(entry->object);
+        free(entry);
+        entry = next;
+        freed++;
+    }
+    domain->retired_count -= freed;
+    return freed;
+}
+
+// Every reader must be gone
+void epoch_free(EpochDomain* domain) {
+    if (!domain) return;
+
+    EpochRetired* entry = domain->retired;
+    while (entry) {
+        EpochRetired* next = entry->next;
+        entry->release(entry->object);
+        free(entry);
+        entry = next;
+    }
+    free(domain);
+}
@@ -0,0 +1,46 @@
+#ifndef EPOCH_H
+#define EPOCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+// Epoch-based reclamation for one writer and many readers. A reader
+// announces the epoch it starts in before it touches shared objects and
+// clears it when it is done; it never waits for anything. The writer
+// unpublishes an object first, then retires it, and the object is freed
+// once no reader that could still hold it remains inside a read.
+
+#define EPOCH_MAX_READERS 64
+#define EPOCH_QUIESCENT 0  // a reader's epoch while it is outside a read
+
+typedef struct {
+    _Alignas(64) atomic_uint_fast64_t epoch;
+    atomic_int claimed;
+} EpochReader;
+
+typedef struct EpochRetired {
+    void* object;
+    void (*release)(void* object);
+    uint64_t epoch;  // global epoch the object was retired in
+    struct EpochRetired* next;
+} EpochRetired;
+
+typedef struct {
+    _Alignas(64) atomic_uint_fast64_t global;
+    EpochReader readers[EPOCH_MAX_READERS];
+    EpochRetired* retired;  // writer only; newest first
+    size_t retired_count;
+} EpochDomain;
+
+// Function declarations
+EpochDomain* epoch_create(void);
+int epoch_register(EpochDomain* domain);
+void epoch_unregister(EpochDomain* domain, int reader);
+void epoch_enter(EpochDomain* domain, int reader);
+void epoch_exit(EpochDomain* domain, int reader);
+void epoch_retire(EpochDomain* domain, void* object, void (*release)(void* object));
+size_t epoch_reclaim(EpochDomain* domain);
+void epoch_free(EpochDomain* domain);
+
+#endif // EPOCH_H
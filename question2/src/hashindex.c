@@ -0,0 +1,96 @@
+#include "hashindex.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define HASH_INDEX_MIN_CAPACITY 64
+
+static size_t slot_for(const uint8_t key[], size_t capacity) {
+    uint64_t h;
+    memcpy(&h, key, sizeof(h));
+    return (size_t)h & (capacity - 1);
+}
+
+void hash_index_init(HashIndex* index) {
+    index->entries = NULL;
+    index->capacity = 0;
+    index->count = 0;
+    index->release_entries = NULL;
+    index->release_context = NULL;
+}
+
+// Places an entry known to be absent into a table with room for it
+static void place(HashIndexEntry* entries, size_t capacity, const uint8_t key[], uint64_t value) {
+    size_t i = slot_for(key, capacity);
+    while (atomic_load_explicit(&entries[i].value, memory_order_relaxed) != HASH_INDEX_EMPTY)
+        i = (i + 1) & (capacity - 1);
+    memcpy(entries[i].key, key, SHA256_DIGEST_SIZE);
+    atomic_store_explicit(&entries[i].value, value, memory_order_relaxed);
+}
+
+// Grows the table so that count entries fit under the load limit
+int hash_index_reserve(HashIndex* index, size_t count) {
+    if (!index) return 0;
+
+    size_t capacity = index->capacity ? index->capacity : HASH_INDEX_MIN_CAPACITY;
+    while (count > capacity / 4 * 3) capacity *= 2;
+    if (capacity == index->capacity) return 1;
+
+    HashIndexEntry* entries = (HashIndexEntry*)malloc(capacity * sizeof(HashIndexEntry));
+    if (!entries) return 0;
+    for (size_t i = 0; i < capacity; i++)
+        atomic_init(&entries[i].value, HASH_INDEX_EMPTY);
+
+    for (size_t i = 0; i < index->capacity; i++) {
+        uint64_t value = atomic_load_explicit(&index->entries[i].value, memory_order_relaxed);
+        if (value != HASH_INDEX_EMPTY) place(entries, capacity, index->entries[i].key, value);
+    }
+
+    if (index->release_entries && index->entries)
+        index->release_entries(index->release_context, index->entries);
+    else
+        free(index->entries);
+    index->entries = entries;
+    index->capacity = capacity;
+    return 1;
+}
+
+// Adds key -> value unless key is already present, in which case the
+// existing value is kept. Returns 0 only when the table cannot grow.
+int hash_index_insert(HashIndex* index, const uint8_t key[], uint64_t value) {
+    if (!index || !key || value == HASH_INDEX_EMPTY) return 0;
+    if (!hash_index_reserve(index, index->count + 1)) return 0;
+
+    size_t i = slot_for(key, index->capacity);
+    while (atomic_load_explicit(&index->entries[i].value, memory_order_relaxed) != HASH_INDEX_EMPTY) {
+        if (memcmp(index->entries[i].key, key, SHA256_DIGEST_SIZE) == 0) return 1;
+        i = (i + 1) & (index->capacity - 1);
+    }
+
+    // The key must be in place before a concurrent find can see the slot filled
+    memcpy(index->entries[i].key, key, SHA256_DIGEST_SIZE);
+    atomic_store_explicit(&index->entries[i].value, value, memory_order_release);
+    index->count++;
+    return 1;
+}
+
+int hash_index_find(const HashIndex* index, const uint8_t key[], uint64_t* value) {
+    if (!index || !key || index->capacity == 0) return 0;
+
+    size_t i = slot_for(key, index->capacity);
+    uint64_t found;
+    while ((found = atomic_load_explicit(&index->entries[i].value, memory_order_acquire)) != HASH_INDEX_EMPTY) {
+        if (memcmp(index->entries[i].key, key, SHA256_DIGEST_SIZE) == 0) {
+            if (value) *value = found;
+            return 1;
+        }
+        i = (i + 1) & (index->capacity - 1);
+    }
+    return 0;
+}
+
+void hash_index_free(HashIndex* index) {
+    if (!index) return;
+
+    free(index->entries);
+    hash_index_init(index);
+}
@@ -0,0 +1,39 @@
+#ifndef HASHINDEX_H
+#define HASHINDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include "sha256.h"
+
+// Open-addressing hash table keyed by SHA-256 digests. Keys are already
+// uniformly distributed, so their first eight bytes serve as the hash.
+// Linear probing over a power-of-two table kept at most 3/4 full.
+// An entry's key is written before its value is published, and a filled
+// slot never changes, so one inserting thread and any number of finding
+// threads may share a table.
+typedef struct {
+    uint8_t key[SHA256_DIGEST_SIZE];
+    _Atomic uint64_t value;  // HASH_INDEX_EMPTY marks a free slot
+} HashIndexEntry;
+
+typedef struct {
+    HashIndexEntry* entries;
+    size_t capacity;
+    size_t count;
+    // Called with the old table when the index grows, instead of free(),
+    // for tables other threads may still be reading
+    void (*release_entries)(void* context, HashIndexEntry* entries);
+    void* release_context;
+} HashIndex;
+
+#define HASH_INDEX_EMPTY UINT64_MAX
+
+// Function declarations
+void hash_index_init(HashIndex* index);
+int hash_index_reserve(HashIndex* index, size_t count);
+int hash_index_insert(HashIndex* index, const uint8_t key[], uint64_t value);
+int hash_index_find(const HashIndex* index, const uint8_t key[], uint64_t* value);
+void hash_index_free(HashIndex* index);
+
+#endif // HASHINDEX_H
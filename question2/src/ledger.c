@@ -0,0 +1,121 @@
+#include "ledger.h"
+#include <stdlib.h>
+#include <float.h>
+
+#define LEDGER_MIN_CAPACITY 64
+
+// IDs are handed out in sequence, so spread them over the table
+static size_t id_hash(AccountId id) {
+    return (size_t)(((uint64_t)id * 0x9e3779b97f4a7c15ULL) >> 32);
+}
+
+// The slot holding id, or the free slot where it would go
+static LedgerAccount* slot_for(const Ledger* ledger, AccountId id) {
+    size_t i = id_hash(id) & (ledger->capacity - 1);
+    while (ledger->accounts[i].used && ledger->accounts[i].id != id) i = (i + 1) & (ledger->capacity - 1);
+    return &ledger->accounts[i];
+}
+
+// Finds id's account, creating it with a zero balance if it is new; the
+// table must already have room for one more account
+static LedgerAccount* get_or_insert(Ledger* ledger, AccountId id) {
+    LedgerAccount* account = slot_for(ledger, id);
+
+    if (!account->used) {
+        account->id = id;
+        account->used = 1;
+        account->balance = 0;
+        account->nonce = 0;
+        ledger->count++;
+    }
+    return account;
+}
+
+// Positive and finite; NaN fails the first comparison
+static int valid_amount(double amount) {
+    return amount > 0 && amount <= DBL_MAX;
+}
+
+void ledger_init(Ledger* ledger) {
+    ledger->accounts = NULL;
+    ledger->capacity = 0;
+    ledger->count = 0;
+}
+
+// Grows the table so that count accounts fit under the load limit
+int ledger_reserve(Ledger* ledger, size_t count) {
+    if (!ledger) return 0;
+
+    size_t capacity = ledger->capacity ? ledger->capacity : LEDGER_MIN_CAPACITY;
+    while (count > capacity / 4 * 3) capacity *= 2;
+    if (capacity == ledger->capacity) return 1;
+
+    LedgerAccount* accounts = (LedgerAccount*)calloc(capacity, sizeof(LedgerAccount));
+    if (!accounts) return 0;
+
+    Ledger grown = { accounts, capacity, ledger->count };
+    for (size_t i = 0; i < ledger->capacity; i++) {
+        const LedgerAccount* account = &ledger->accounts[i];
+        if (account->used) *slot_for(&grown, account->id) = *account;
+    }
+
+    free(ledger->accounts);
+    *ledger = grown;
+    return 1;
+}
+
+const LedgerAccount* ledger_find(const Ledger* ledger, AccountId id) {
+    if (!ledger || id == ACCOUNT_NONE || ledger->capacity == 0) return NULL;
+
+    const LedgerAccount* account = slot_for(ledger, id);
+    return account->used ? account : NULL;
+}
+
+// Accounts that never received anything hold 0
+double ledger_balance(const Ledger* ledger, AccountId id) {
+    const LedgerAccount* account = ledger_find(ledger, id);
+    return account ? account->balance : 0;
+}
+
+// Creates amount out of nothing for receiver
+int ledger_mint(Ledger* ledger, AccountId receiver, double amount) {
+    if (!ledger || receiver == ACCOUNT_NONE || !valid_amount(amount)) return 0;
+    if (!ledger_reserve(ledger, ledger->count + 1)) return 0;
+
+    get_or_insert(ledger, receiver)->balance += amount;
+    return 1;
+}
+
+// Moves amount from sender to receiver. Returns 0 and changes nothing if
+// sender's balance does not cover it.
+int ledger_transfer(Ledger* ledger, AccountId sender, AccountId receiver, double amount) {
+    if (!ledger || sender == ACCOUNT_NONE || receiver == ACCOUNT_NONE || !valid_amount(amount)) return 0;
+    // Grow before taking pointers into the table, as growing moves them
+    if (!ledger_reserve(ledger, ledger->count + 1)) return 0;
+
+    LedgerAccount* from = slot_for(ledger, sender);
+    if (!from->used || from->balance < amount) return 0;
+
+    from->balance -= amount;
+    from->nonce++;
+    get_or_insert(ledger, receiver)->balance += amount;
+    return 1;
+}
+
+// Hands out sender's nonce and counts one more transfer sent, leaving the
+// balances alone; for numbering transfers in chain order without checking
+// that they are covered
+int ledger_take_nonce(Ledger* ledger, AccountId sender, uint64_t* nonce) {
+    if (!ledger || sender == ACCOUNT_NONE || !nonce) return 0;
+    if (!ledger_reserve(ledger, ledger->count + 1)) return 0;
+
+    *nonce = get_or_insert(ledger, sender)->nonce++;
+    return 1;
+}
+
+void ledger_free(Ledger* ledger) {
+    if (!ledger) return;
+
+    free(ledger->accounts);
+    ledger_init(ledger);
+}
@@ -0,0 +1,34 @@
+#ifndef LEDGER_H
+#define LEDGER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "accounts.h"
+
+// Account state: balance and nonce per account ID, in an open-addressing
+// table (linear probing, power-of-two capacity, at most 3/4 full) so that
+// lookups and transfers cost O(1) whatever the chain length.
+typedef struct {
+    AccountId id;
+    uint32_t used;  // 0 marks a free slot
+    double balance;
+    uint64_t nonce;  // transfers this account has sent
+} LedgerAccount;
+
+typedef struct {
+    LedgerAccount* accounts;
+    size_t capacity;
+    size_t count;
+} Ledger;
+
+// Function declarations
+void ledger_init(Ledger* ledger);
+int ledger_reserve(Ledger* ledger, size_t count);
+const LedgerAccount* ledger_find(const Ledger* ledger, AccountId id);
+double ledger_balance(const Ledger* ledger, AccountId id);
+int ledger_mint(Ledger* ledger, AccountId receiver, double amount);
+int ledger_transfer(Ledger* ledger, AccountId sender, AccountId receiver, double amount);
+int ledger_take_nonce(Ledger* ledger, AccountId sender, uint64_t* nonce);
+void ledger_free(Ledger* ledger);
+
+#endif // LEDGER_H
@@ -0,0 +1,172 @@
+#include "lz.h"
+#include <string.h>
+
+#define HASH_BITS 14
+#define LAST_LITERALS 5  // a block always ends in at least this many literals
+#define MATCH_LIMIT 12   // and no match starts closer than this to its end
+#define SKIP_TRIGGER 6   // after 2^SKIP_TRIGGER misses, probe every other byte, and so on
+
+static uint32_t read32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint64_t read64(const uint8_t* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static size_t hash4(uint32_t v) {
+    return (size_t)((v * 2654435761u) >> (32 - HASH_BITS));
+}
+
+// Worst case: nothing matches and everything is one run of literals
+size_t lz_compress_bound(size_t len) {
+    return len + len / 255 + 16;
+}
+
+// Writes a length that did not fit in its nibble
+static uint8_t* put_length(uint8_t* op, size_t len) {
+    while (len >= 255) {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = (uint8_t)len;
+    return op;
+}
+
+static uint8_t* put_sequence(uint8_t* op, const uint8_t* literals, size_t literal_count, size_t offset,
+                             size_t match_length) {
+    uint8_t* token = op++;
+    *token = (uint8_t)((literal_count >= 15 ? 15 : literal_count) << 4);
+    if (literal_count >= 15) op = put_length(op, literal_count - 15);
+    memcpy(op, literals, literal_count);
+    op += literal_count;
+    if (offset == 0) return op;  // the closing run of literals
+
+    size_t extra = match_length - LZ_MIN_MATCH;
+    *token |= (uint8_t)(extra >= 15 ? 15 : extra);
+    op[0] = (uint8_t)offset;
+    op[1] = (uint8_t)(offset >> 8);
+    op += 2;
+    if (extra >= 15) op = put_length(op, extra - 15);
+    return op;
+}
+
+// How far the bytes at a and b agree, stopping at limit
+static const uint8_t* match_end(const uint8_t* a, const uint8_t* b, const uint8_t* limit) {
+    while (a + 8 <= limit) {
+        uint64_t diff = read64(a) ^ read64(b);
+        if (diff) return a + (__builtin_ctzll(diff) >> 3);
+        a += 8;
+        b += 8;
+    }
+    while (a < limit && *a == *b) {
+        a++;
+        b++;
+    }
+    return a;
+}
+
+// Greedy single-probe compression. Returns the compressed size, or 0 if
+// dst is smaller than lz_compress_bound(len).
+size_t lz_compress(const uint8_t* src, size_t len, uint8_t* dst, size_t capacity) {
+    if (!src || !dst || len > UINT32_MAX || capacity < lz_compress_bound(len)) return 0;
+
+    uint32_t table[1 << HASH_BITS];
+    memset(table, 0, sizeof(table));
+
+    const uint8_t* ip = src;
+    const uint8_t* anchor = src;
+    const uint8_t* end = src + len;
+    uint8_t* op = dst;
+
+    if (len >= MATCH_LIMIT) {
+        const uint8_t* last_start = end - MATCH_LIMIT;
+        const uint8_t* last_byte = end - LAST_LITERALS;
+        size_t misses = 0;
+
+        while (ip <= last_start) {
+            uint32_t sequence = read32(ip);
+            size_t h = hash4(sequence);
+            const uint8_t* ref = src + table[h];
+            table[h] = (uint32_t)(ip - src);
+
+            if (ref >= ip || (size_t)(ip - ref) > LZ_MAX_OFFSET || read32(ref) != sequence) {
+                // Incompressible stretches, such as hashes, are skipped faster
+                ip += 1 + (misses++ >> SKIP_TRIGGER);
+                continue;
+            }
+            misses = 0;
+
+            const uint8_t* matched = match_end(ip + LZ_MIN_MATCH, ref + LZ_MIN_MATCH, last_byte);
+            while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+                ip--;
+                ref--;
+            }
+
+            op = put_sequence(op, anchor, (size_t)(ip - anchor), (size_t)(ip - ref), (size_t)(matched - ip));
+            ip = matched;
+            anchor = ip;
+        }
+    }
+
+    op = put_sequence(op, anchor, (size_t)(end - anchor), 0, 0);
+    return (size_t)(op - dst);
+}
+
+// Reads the bytes extending a length past its nibble
+static int get_length(const uint8_t** ip, const uint8_t* end, size_t* len) {
+    uint8_t byte;
+    do {
+        if (*ip >= end || *len > SIZE_MAX / 2) return 0;
+        byte = *(*ip)++;
+        *len += byte;
+    } while (byte == 255);
+    return 1;
+}
+
+// Returns the decompressed size, or 0 if src is not a well-formed block
+// or its output does not fit in capacity bytes
+size_t lz_decompress(const uint8_t* src, size_t len, uint8_t* dst, size_t capacity) {
+    if (!src || !dst) return 0;
+
+    const uint8_t* ip = src;
+    const uint8_t* end = src + len;
+    uint8_t* op = dst;
+    uint8_t* op_end = dst + capacity;
+
+    while (ip < end) {
+        unsigned token = *ip++;
+
+        size_t literals = token >> 4;
+        if (literals == 15 && !get_length(&ip, end, &literals)) return 0;
+        if (literals > (size_t)(end - ip) || literals > (size_t)(op_end - op)) return 0;
+        memcpy(op, ip, literals);
+        ip += literals;
+        op += literals;
+        if (ip == end) return (size_t)(op - dst);
+
+        if (end - ip < 2) return 0;
+        size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op - dst)) return 0;
+
+        size_t match = token & 15;
+        if (match == 15 && !get_length(&ip, end, &match)) return 0;
+        match += LZ_MIN_MATCH;
+        if (match > (size_t)(op_end - op)) return 0;
+
+        // Overlapping matches repeat the last offset bytes, so copy forward
+        const uint8_t* ref = op - offset;
+        if (offset >= match) {
+            memcpy(op, ref, match);
+            op += match;
+        } else {
+            for (size_t i = 0; i < match; i++) *op++ = ref[i];
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,22 @@
+#ifndef LZ_H
+#define LZ_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Byte-oriented LZ77 block codec in the style of LZ4. A block is a series
+// of sequences, each a token byte (literal count in the high nibble, match
+// length - LZ_MIN_MATCH in the low one, 15 meaning more length bytes
+// follow, each adding up to 255), the literals, then a two-byte
+// little-endian match offset into the last 64 KB of output. The last
+// sequence has literals only. Decoding checks every length and offset
+// against its buffers, so damaged input fails instead of overrunning.
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_OFFSET 65535
+
+// Function declarations
+size_t lz_compress_bound(size_t len);
+size_t lz_compress(const uint8_t* src, size_t len, uint8_t* dst, size_t capacity);
+size_t lz_decompress(const uint8_t* src, size_t len, uint8_t* dst, size_t capacity);
+
+#endif // LZ_H
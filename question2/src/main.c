@@ -1,6 +1,35 @@
 #include <stdio.h>
 #include <string.h>
 #include "blockchain.h"
+#include "metrics.h"
+#include "chainfile.h"
+#include "chainlog.h"
+#include "chainvalidate.h"
+#include "mempool.h"
+#include "txcolumns.h"
+#include "chainexport.h"
+#include "chainwriter.h"
+#include <pthread.h>
+
+void print_accounts(Blockchain* chain) {
+    const char* names[] = { "King", "Jack", "Kraed" };
+
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        double balance;
+        uint64_t nonce;
+        get_account(chain, names[i], &balance, &nonce);
+        printf("  %s: %.2f (nonce %llu)\n", names[i], balance, (unsigned long long)nonce);
+    }
+}
+
+static long file_size(const char* filename) {
+    FILE* file = fopen(filename, "rb");
+    if (!file) return -1;
+
+    long size = fseek(file, 0, SEEK_END) == 0 ? ftell(file) : -1;
+    fclose(file);
+    return size;
+}
 
 void test_blockchain() {
     // Create a new blockchain with difficulty 4
@@ -21,30 +50,30 @@ void test_blockchain() {
         free_blockchain(chain);
         return;
     }
-    calculate_block_hash(chain->genesis);
+    mine_tip(chain);
 
     // Add a new block with transactions
     add_block(chain);
-    if (!add_transaction(chain->latest, "Kraed", "King", 7.5)) {
+    if (!submit_transaction(chain, "Kraed", "King", 4.5)) {
         printf("Failed to add transaction to block\n");
         free_blockchain(chain);
         return;
     }
-    if (!add_transaction(chain->latest, "Jack", "King", 3.0)) {
+    if (!submit_transaction(chain, "Jack", "King", 3.0)) {
         printf("Failed to add transaction to block\n");
         free_blockchain(chain);
         return;
     }
-    calculate_block_hash(chain->latest);
+    mine_tip(chain);
 
     // Add another block
     add_block(chain);
-    if (!add_transaction(chain->latest, "King", "Kraed", 2.5)) {
+    if (!submit_transaction(chain, "King", "Kraed", 2.5)) {
         printf("Failed to add transaction to block\n");
         free_blockchain(chain);
         return;
     }
-    calculate_block_hash(chain->latest);
+    mine_tip(chain);
 
     // Print the blockchain
     printf("Blockchain Contents:\n");
@@ -58,6 +87,63 @@ void test_blockchain() {
         printf("Blockchain is invalid!\n");
     }
 
+    // Validate again on worker threads
+    ValidationOptions options = { 4, 0, 0 };
+    long first_invalid;
+    printf("Validating blockchain on %d threads...\n", options.num_threads);
+    if (validate_chain_parallel(chain, &options, &first_invalid)) {
+        printf("Blockchain is valid!\n");
+    } else {
+        printf("Blockchain is invalid at block %ld!\n", first_invalid);
+    }
+
+    // Only sealed blocks are held to the target, and add_block mines a tip
+    // that was only hashed, as callers that never call mine_tip leave it
+    Blockchain* fresh = create_blockchain(4);
+    if (fresh) {
+        int fresh_valid = validate_chain(fresh);
+        add_transaction(fresh->latest, "King", "Jack", 1.0);
+        calculate_block_hash(fresh->latest);
+        add_block(fresh);
+        printf("New chain is %s, and %s after add_block without mine_tip\n", fresh_valid ? "valid" : "invalid",
+               validate_chain(fresh) ? "valid" : "invalid");
+        free_blockchain(fresh);
+    }
+
+    // Prove that one transaction is in block #1 without the others
+    MerkleProof proof;
+    Block* block = get_block_by_index(chain, 1);
+    if (get_transaction_proof(block, 1, &proof)) {
+        printf("Merkle proof for transaction 2 of block #%u (%d hashes): %s\n",
+               block->index, proof.length,
+               verify_transaction_proof(block->tx_tree.root, &block->transactions[1], &proof)
+                   ? "verified" : "REJECTED");
+    }
+
+    // Genesis transactions minted the coins; later ones must be covered
+    printf("\nAccount balances:\n");
+    print_accounts(chain);
+    printf("Kraed sending 100.00 to Jack: %s\n",
+           submit_transaction(chain, "Kraed", "Jack", 100.0) ? "accepted" : "rejected (overspend)");
+
+    // An overspend added without the check is left out of the ledger, which
+    // goes on applying later transactions and says so
+    Blockchain* spent = create_blockchain(1);
+    if (spent) {
+        double before = 0, after = 0;
+        add_transaction(spent->genesis, "Mint", "Kraed", 5.0);
+        add_block(spent);
+        add_transaction(spent->latest, "Kraed", "Jack", 100.0);
+        add_block(spent);
+        get_account(spent, "Jack", &before, NULL);
+        int status = submit_transaction(spent, "Kraed", "Jack", 2.0);
+        get_account(spent, "Jack", &after, NULL);
+        printf("After an unchecked overspend, Kraed sending 2.00 to Jack: %s, Jack %.2f -> %.2f%s\n",
+               status ? "accepted" : "rejected", before, after,
+               status == LEDGER_SKIPPED ? " (ledger skipped a transaction)" : "");
+        free_blockchain(spent);
+    }
+
     // Save the blockchain to a file
     printf("\nSaving blockchain to file...\n");
     if (!save_blockchain(chain, "blockchain.dat")) {
@@ -66,27 +152,460 @@ void test_blockchain() {
         return;
     }
 
+    // The compact format is for storage and transfer
+    if (save_compact_blockchain(chain, "blockchain.pack", NULL)) {
+        Blockchain* packed = load_blockchain("blockchain.pack");
+        printf("Compact copy: %ld bytes instead of %ld, loads back %s\n", file_size("blockchain.pack"),
+               file_size("blockchain.dat"), packed && validate_chain(packed) ? "valid" : "invalid");
+        free_blockchain(packed);
+        remove("blockchain.pack");
+    }
+
     // Free the current blockchain
     free_blockchain(chain);
 
-    // Load the blockchain from file
+    // Check the saved file without loading it
+    FileValidationReport report;
+    int file_valid = validate_chain_file("blockchain.dat", NULL, &report);
+    printf("Chain file is %s: %llu blocks checked, %.1f MB/s\n", file_valid ? "valid" : "invalid",
+           (unsigned long long)report.blocks, report.mb_per_second);
+    if (!file_valid) printf("First invalid block: %ld\n", report.first_invalid);
+
+    // Map the file and read one block in place without loading the rest
+    ChainFile* file = chainfile_open("blockchain.dat");
+    if (!file) {
+        printf("Failed to map blockchain file\n");
+        return;
+    }
+    Block* mapped = chainfile_get_block(file, chainfile_block_count(file) - 1);
+    printf("Mapped chain file v%u: %zu blocks, tip #%u has %d transactions\n",
+           file->header->version, chainfile_block_count(file),
+           mapped ? mapped->index : 0, mapped ? mapped->transaction_count : 0);
+    chainfile_close(file);
+
+    // Load the blockchain from file, re-checking only blocks after the
+    // checkpoint the earlier validation left
     printf("Loading blockchain from file...\n");
-    chain = load_blockchain("blockchain.dat");
+    chain = load_verified_blockchain("blockchain.dat", NULL, 0, &first_invalid);
     if (!chain) {
         printf("Failed to load blockchain from file\n");
         return;
     }
+    printf("Verified blocks after checkpoint #%ld\n", chain->checkpoint_height);
+    printf("Account balances rebuilt on load:\n");
+    print_accounts(chain);
 
     printf("\nLoaded Blockchain Contents:\n");
     print_blockchain(chain);
     free_blockchain(chain);
 }
 
+void test_blockchain_log() {
+    // Start from an empty log so every run shows the same thing
+    remove("blockchain.log");
+
+    ChainLogOptions options = { 2, 100 };  // sync every 2 blocks or 100 ms
+    Blockchain* chain = open_blockchain_log("blockchain.log", 4, &options);
+    if (!chain) {
+        printf("Failed to open blockchain log\n");
+        return;
+    }
+
+    // Each add_block appends only the block it seals
+    for (int i = 0; i < 3; i++) {
+        add_transaction(chain->latest, "King", "Jack", 1.0 + i);
+        mine_tip(chain);
+        add_block(chain);
+    }
+    printf("Logged %zu of %zu blocks\n", chain->logged_blocks, get_block_count(chain));
+    free_blockchain(chain);
+
+    chain = open_blockchain_log("blockchain.log", 4, &options);
+    if (!chain) {
+        printf("Failed to reopen blockchain log\n");
+        return;
+    }
+    printf("Recovered %zu blocks from the log, chain is %s\n",
+           chain->logged_blocks, validate_chain(chain) ? "valid" : "invalid");
+
+    // Logged blocks stay as they were; what is added after reopening goes
+    // into a new tip, which is logged once it is sealed
+    add_transaction(chain->latest, "King", "Jack", 99.0);
+    mine_tip(chain);
+    add_block(chain);
+    free_blockchain(chain);
+
+    chain = open_blockchain_log("blockchain.log", 4, &options);
+    if (!chain) {
+        printf("Failed to reopen blockchain log\n");
+        return;
+    }
+    Block* last = get_block_by_index(chain, chain->logged_blocks - 1);
+    int kept = last && last->transaction_count == 1 && last->transactions[0].amount == 99.0;
+    printf("After one more block, recovered %zu blocks, chain is %s, new transfer %s\n", chain->logged_blocks,
+           validate_chain(chain) ? "valid" : "invalid", kept ? "kept" : "LOST");
+    free_blockchain(chain);
+    remove("blockchain.log");
+}
+
+#define DEMO_PRODUCERS 4
+#define DEMO_SUBMITS 5000
+
+static void* demo_producer(void* arg) {
+    Mempool* pool = (Mempool*)arg;
+    const char* names[] = { "King", "Jack", "Kraed" };
+
+    for (int i = 0; i < DEMO_SUBMITS; i++) {
+        while (!mempool_submit(pool, names[i % 3], names[(i + 1) % 3], 0.01, (double)(i % 10)))
+            ;
+    }
+    return NULL;
+}
+
+void test_mempool() {
+    Blockchain* chain = create_blockchain(4);
+    Mempool* pool = mempool_create(4096);
+    AssemblerOptions options = { ASSEMBLE_BY_FEE, 1000, 256 };
+    BlockAssembler* assembler = pool ? block_assembler_create(pool, &options) : NULL;
+    if (!chain || !assembler) {
+        printf("Failed to set up the mempool\n");
+        free_blockchain(chain);
+        mempool_free(pool);
+        return;
+    }
+
+    // The genesis block mints the coins the producers spend
+    submit_transaction(chain, "Mint", "King", 1000.0);
+    submit_transaction(chain, "Mint", "Jack", 1000.0);
+    submit_transaction(chain, "Mint", "Kraed", 1000.0);
+    mine_tip(chain);
+    add_block(chain);
+
+    printf("\n%d threads submitting %d transactions each to the mempool...\n", DEMO_PRODUCERS, DEMO_SUBMITS);
+    pthread_t threads[DEMO_PRODUCERS];
+    int started = 0;
+    while (started < DEMO_PRODUCERS && pthread_create(&threads[started], NULL, demo_producer, pool) == 0)
+        started++;
+
+    uint64_t expected = (uint64_t)started * DEMO_SUBMITS;
+    while (assembler->included + assembler->rejected < expected)
+        assemble_block(assembler, chain);
+    for (int i = 0; i < started; i++)
+        pthread_join(threads[i], NULL);
+
+    // assemble_block leaves an empty tip, which is mined like any other
+    mine_tip(chain);
+    printf("Assembled %llu blocks holding %llu transactions (%llu rejected), chain is %s\n",
+           (unsigned long long)assembler->blocks, (unsigned long long)assembler->included,
+           (unsigned long long)assembler->rejected, validate_chain(chain) ? "valid" : "invalid");
+
+    block_assembler_free(assembler);
+    mempool_free(pool);
+    free_blockchain(chain);
+}
+
+#define DEMO_READERS 2
+#define DEMO_APPENDS 2000
+
+typedef struct {
+    Blockchain* chain;
+    atomic_int* writing;
+    int snapshots;
+    int invalid;
+} DemoReader;
+
+// Validates whatever the chain holds, over and over, while blocks are added
+static void* demo_reader(void* arg) {
+    DemoReader* r = (DemoReader*)arg;
+    int slot = register_reader(r->chain);
+    ChainSnapshot snapshot;
+
+    while (slot >= 0 && atomic_load(r->writing)) {
+        if (read_snapshot(r->chain, slot, &snapshot) > 0) {
+            r->snapshots++;
+            if (!validate_snapshot(&snapshot)) r->invalid++;
+        }
+        release_snapshot(&snapshot);
+    }
+    unregister_reader(r->chain, slot);
+    return NULL;
+}
+
+void test_concurrent_readers() {
+    Blockchain* chain = create_blockchain(4);
+    if (!chain) return;
+
+    atomic_int writing;
+    atomic_init(&writing, 1);
+    pthread_t threads[DEMO_READERS];
+    DemoReader readers[DEMO_READERS];
+    int started = 0;
+    for (; started < DEMO_READERS; started++) {
+        readers[started] = (DemoReader){ chain, &writing, 0, 0 };
+        if (pthread_create(&threads[started], NULL, demo_reader, &readers[started]) != 0) break;
+    }
+
+    printf("\nAppending %d blocks while %d threads validate snapshots...\n", DEMO_APPENDS, started);
+    for (int i = 0; i < DEMO_APPENDS; i++) {
+        add_transaction(chain->latest, "King", "Jack", 1.0);
+        mine_tip(chain);
+        add_block(chain);
+    }
+    atomic_store(&writing, 0);
+
+    int snapshots = 0, invalid = 0;
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+        snapshots += readers[i].snapshots;
+        invalid += readers[i].invalid;
+    }
+    printf("Validated %d snapshots, %d invalid\n", snapshots, invalid);
+    free_blockchain(chain);
+}
+
+#define DEMO_COLUMN_BLOCKS 200
+#define DEMO_COLUMN_TRANSACTIONS 50
+
+// Compares scans of the columnar copy against a walk over the blocks.
+// Amounts are whole quarters, so every order of adding them is exact.
+void test_transaction_columns() {
+    Blockchain* chain = create_blockchain(0);
+    if (!chain) return;
+
+    const char* names[] = { "King", "Jack", "Kraed", "Mint" };
+    for (int b = 0; b < DEMO_COLUMN_BLOCKS; b++) {
+        for (int i = 0; i < DEMO_COLUMN_TRANSACTIONS; i++) {
+            int n = b * DEMO_COLUMN_TRANSACTIONS + i;
+            add_transaction(chain->latest, names[n % 4], names[(n / 4 + 1) % 4], (double)(n % 97) + 0.25);
+        }
+        mine_tip(chain);
+        add_block(chain);
+    }
+
+    const TxColumns* columns = enable_transaction_columns(chain) ? get_transaction_columns(chain) : NULL;
+    if (!columns) {
+        printf("Failed to build the transaction columns\n");
+        free_blockchain(chain);
+        return;
+    }
+
+    // The same questions answered by walking every block
+    AccountId king = account_lookup("King");
+    int64_t from = (int64_t)chain->genesis->transactions[0].timestamp, to = from + 1;
+    const double edges[] = { 0.0, 10.0, 50.0, 90.0, 100.0 };
+    double total = 0, window = 0;
+    size_t in_window = 0, king_rows = 0;
+    AccountFlow expected = { 0, 0, 0, 0 };
+    uint64_t buckets[4] = { 0 };
+    for (size_t h = 0; h < get_block_count(chain); h++) {
+        const Block* block = get_block_by_index(chain, h);
+        for (int i = 0; i < block->transaction_count; i++) {
+            const Transaction* tx = &block->transactions[i];
+            total += tx->amount;
+            if (tx->timestamp >= from && tx->timestamp < to) {
+                window += tx->amount;
+                in_window++;
+            }
+            if (tx->receiver == king) {
+                expected.received += tx->amount;
+                expected.receipts++;
+            }
+            if (tx->sender == king) {
+                expected.sent += tx->amount;
+                expected.payments++;
+            }
+            if (tx->sender == king || tx->receiver == king) king_rows++;
+            for (int k = 0; k < 4; k++)
+                if (tx->amount >= edges[k] && tx->amount < edges[k + 1]) buckets[k]++;
+        }
+    }
+
+    // Every backend must agree with the walk, and with each other bit for bit
+    TXCOLUMNS_BACKEND original = txcolumns_get_backend();
+    double first_total = 0;
+    int matched = 1, tested = 0;
+    char backends[64] = "";
+    for (int b = TXCOLUMNS_BACKEND_SCALAR; b <= TXCOLUMNS_BACKEND_AVX2; b++) {
+        if (!txcolumns_set_backend((TXCOLUMNS_BACKEND)b)) continue;
+
+        size_t begin = 0, end = 0, matched_rows = 0, rows[8];
+        AccountFlow flow;
+        uint64_t counts[4];
+        txcolumns_block_rows(columns, 0, columns->block_count, &begin, &end);
+        double sum = txcolumns_sum(columns, begin, end);
+        double window_sum = txcolumns_sum_between(columns, begin, end, from, to, &matched_rows);
+        txcolumns_account_flow(columns, begin, end, king, &flow);
+        size_t selected = txcolumns_select_account(columns, begin, end, king, rows, 8);
+
+        matched = matched && end - begin == (size_t)DEMO_COLUMN_BLOCKS * DEMO_COLUMN_TRANSACTIONS;
+        matched = matched && sum == total && window_sum == window && matched_rows == in_window;
+        matched = matched && flow.received == expected.received && flow.sent == expected.sent;
+        matched = matched && flow.receipts == expected.receipts && flow.payments == expected.payments;
+        matched = matched && selected == king_rows;
+        matched = matched && txcolumns_histogram(columns, begin, end, edges, 4, counts);
+        matched = matched && memcmp(counts, buckets, sizeof(counts)) == 0;
+        if (tested == 0) first_total = sum;
+        matched = matched && memcmp(&sum, &first_total, sizeof(sum)) == 0;
+
+        snprintf(backends + strlen(backends), sizeof(backends) - strlen(backends), "%s%s", tested ? ", " : "",
+                 txcolumns_backend_name((TXCOLUMNS_BACKEND)b));
+        tested++;
+    }
+    txcolumns_set_backend(original);
+
+    printf("\nColumnar copy of %zu transactions: scans %s the block walk (%s)\n", columns->count,
+           matched ? "match" : "DO NOT match", backends);
+    free_blockchain(chain);
+}
+
+#define DEMO_EXPORT_BLOCKS 300
+#define DEMO_EXPORT_TRANSACTIONS 20
+
+// The chain in a format, written to memory; NULL if the export failed
+static char* export_to_memory(Blockchain* chain, ChainExportFormat format, int num_threads, size_t* size) {
+    char* data = NULL;
+    FILE* out = open_memstream(&data, size);
+    if (!out) return NULL;
+
+    ChainExportOptions options = { format, num_threads, 4096, 16 };
+    int ok = chainexport_write(chain, out, &options, NULL);
+    fclose(out);
+    if (!ok) {
+        free(data);
+        return NULL;
+    }
+    return data;
+}
+
+static size_t count_lines(const char* data, size_t size) {
+    size_t lines = 0;
+    for (size_t i = 0; i < size; i++) lines += data[i] == '\n';
+    return lines;
+}
+
+// Checks the text export against print_block's output, and that threads
+// change none of the three formats
+void test_chain_export() {
+    Blockchain* chain = create_blockchain(0);
+    if (!chain) return;
+
+    // Names that need quoting, and amounts that are not whole cents
+    const char* names[] = { "King", "Jack", "Smith, Ann", "Say \"hi\"" };
+    const double amounts[] = { 10.50, 1.0 / 3, 0.125, 2.675, 1e20 };
+    for (int b = 0; b < DEMO_EXPORT_BLOCKS; b++) {
+        for (int i = 0; i < DEMO_EXPORT_TRANSACTIONS; i++) {
+            int n = b * DEMO_EXPORT_TRANSACTIONS + i;
+            add_transaction(chain->latest, names[n % 4], names[(n + 1) % 4], amounts[n % 5]);
+        }
+        mine_tip(chain);
+        add_block(chain);
+    }
+
+    char* expected = NULL;
+    size_t expected_size = 0;
+    FILE* out = open_memstream(&expected, &expected_size);
+    if (!out) {
+        free_blockchain(chain);
+        return;
+    }
+    for (size_t h = 0; h < get_block_count(chain); h++) fprint_block(out, get_block_by_index(chain, h));
+    fclose(out);
+
+    printf("\nExporting %zu blocks as text, JSON Lines and CSV...\n", get_block_count(chain));
+    int matched = 1;
+    for (int format = CHAINEXPORT_TEXT; format <= CHAINEXPORT_CSV; format++) {
+        size_t size = 0, threaded_size = 0;
+        char* serial = export_to_memory(chain, (ChainExportFormat)format, 1, &size);
+        char* threaded = export_to_memory(chain, (ChainExportFormat)format, 3, &threaded_size);
+
+        int same = serial && threaded && size == threaded_size && memcmp(serial, threaded, size) == 0;
+        if (format == CHAINEXPORT_TEXT)
+            same = same && size == expected_size && memcmp(serial, expected, size) == 0;
+        else if (format == CHAINEXPORT_JSONL)
+            same = same && count_lines(serial, size) == get_block_count(chain);
+        else
+            same = same && count_lines(serial, size) == (size_t)DEMO_EXPORT_BLOCKS * DEMO_EXPORT_TRANSACTIONS + 1;
+
+        printf("  %s: %zu bytes, %s\n", chainexport_format_name((ChainExportFormat)format), size,
+               !same ? "MISMATCH" : format == CHAINEXPORT_TEXT ? "same as print_block, with or without threads"
+                                                               : "same with or without threads");
+        matched = matched && same;
+        free(serial);
+        free(threaded);
+    }
+    if (!matched) printf("Export check failed\n");
+
+    free(expected);
+    free_blockchain(chain);
+}
+
+#define DEMO_BACKGROUND_BLOCKS 200
+
+// Runs on the writer thread as each batch reaches the disk
+static void count_durable(void* context, uint64_t first_height, uint64_t end_height, int ok) {
+    if (ok) atomic_fetch_add((atomic_ulong*)context, (unsigned long)(end_height - first_height));
+}
+
+// Appends blocks while a background thread writes the log, then checks
+// that reopening the log recovers all of them
+void test_background_log() {
+    remove("blockchain_background.log");
+
+    Blockchain* chain = open_blockchain_log("blockchain_background.log", 4, NULL);
+    atomic_ulong durable;
+    atomic_init(&durable, 0);
+    ChainWriterOptions options = { CHAINWRITER_BACKEND_IO_URING, 0, 0, count_durable, &durable };
+    if (!chain || !start_background_log(chain, &options)) {
+        printf("Failed to start the background log writer\n");
+        free_blockchain(chain);
+        return;
+    }
+
+    printf("\nAppending %d blocks with the log written in the background (%s)...\n", DEMO_BACKGROUND_BLOCKS,
+           chainwriter_backend_name(chain->writer->backend));
+    for (int i = 0; i < DEMO_BACKGROUND_BLOCKS; i++) {
+        add_transaction(chain->latest, "King", "Jack", 1.0 + i);
+        mine_tip(chain);
+        add_block(chain);
+    }
+
+    // The last sealed block is the one below the tip
+    size_t last = get_block_count(chain) - 2;
+    int durable_ok = wait_until_durable(chain, last);
+    printf("Block #%zu is %s; %lu blocks written in %llu batches\n", last, durable_ok ? "durable" : "NOT durable",
+           (unsigned long)atomic_load(&durable), (unsigned long long)chain->writer->batches_written);
+    free_blockchain(chain);
+
+    chain = open_blockchain_log("blockchain_background.log", 4, NULL);
+    if (!chain) {
+        printf("Failed to reopen blockchain log\n");
+        return;
+    }
+    printf("Recovered %zu blocks from the log, chain is %s\n",
+           chain->logged_blocks, validate_chain(chain) ? "valid" : "invalid");
+    free_blockchain(chain);
+    remove("blockchain_background.log");
+}
+
 int main() {
     printf("Enhanced Blockchain Implementation\n");
     printf("================================\n\n");
+
+    printf("SHA-256 backend: %s (self-test %s)\n\n",
+           sha256_backend_name(sha256_get_backend()),
+           sha256_self_test() ? "passed" : "FAILED");
     
     test_blockchain();
-    
+    test_blockchain_log();
+    test_mempool();
+    test_concurrent_readers();
+    test_transaction_columns();
+    test_chain_export();
+    test_background_log();
+
+    if (metrics_enabled()) {
+        printf("\nMetrics: ");
+        metrics_write_json(stdout);
+    }
     return 0;
 } 
\ No newline at end of file
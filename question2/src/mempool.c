@@ -0,0 +1,277 @@
+#include "mempool.h"
+#include <stdlib.h>
+#include <limits.h>
+
+#define MEMPOOL_MIN_CAPACITY 64
+#define DEFAULT_BLOCK_CAPACITY 1000
+#define DEFAULT_BATCH_SIZE 256
+// Fee order picks from up to this many blocks' worth of drained entries
+#define FEE_WINDOW_BLOCKS 4
+
+Mempool* mempool_create(size_t capacity) {
+    size_t rounded = MEMPOOL_MIN_CAPACITY;
+    while (rounded < capacity) {
+        if (rounded > SIZE_MAX / 2 / sizeof(MempoolSlot)) return NULL;
+        rounded *= 2;
+    }
+
+    Mempool* pool = (Mempool*)aligned_alloc(64, sizeof(Mempool));
+    if (!pool) return NULL;
+
+    pool->slots = (MempoolSlot*)malloc(rounded * sizeof(MempoolSlot));
+    if (!pool->slots) {
+        free(pool);
+        return NULL;
+    }
+
+    // Slot i is free for the producer whose position is i
+    for (size_t i = 0; i < rounded; i++)
+        atomic_init(&pool->slots[i].sequence, i);
+    pool->mask = rounded - 1;
+    atomic_init(&pool->enqueue_pos, 0);
+    atomic_init(&pool->dequeue_pos, 0);
+    return pool;
+}
+
+// Returns 0 if the pool is full, so producers can back off, or if the
+// amount could never be valid or a name could not be interned
+int mempool_submit(Mempool* pool, const char* sender, const char* receiver, double amount, double fee) {
+    if (!pool || !sender || !receiver || !(amount > 0)) return 0;
+
+    AccountId from = account_intern(sender);
+    AccountId to = account_intern(receiver);
+    if (from == ACCOUNT_NONE || to == ACCOUNT_NONE) return 0;
+
+    size_t pos = atomic_load_explicit(&pool->enqueue_pos, memory_order_relaxed);
+    for (;;) {
+        MempoolSlot* slot = &pool->slots[pos & pool->mask];
+        size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+
+        if (diff == 0) {
+            // Free for this position; claim it, or learn the new position
+            if (atomic_compare_exchange_weak_explicit(&pool->enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                slot->entry.tx.sender = from;
+                slot->entry.tx.receiver = to;
+                slot->entry.tx.amount = amount;
+                slot->entry.tx.timestamp = 0;
+                slot->entry.fee = fee;
+                slot->entry.arrival = pos;
+                atomic_store_explicit(&slot->sequence, pos + 1, memory_order_release);
+                return 1;
+            }
+        } else if (diff < 0) {
+            return 0;  // still holds an entry from one lap ago: full
+        } else {
+            pos = atomic_load_explicit(&pool->enqueue_pos, memory_order_relaxed);
+        }
+    }
+}
+
+// Moves up to max entries into out in submission order; safe to call from
+// several consumers at once
+size_t mempool_drain(Mempool* pool, MempoolEntry* out, size_t max) {
+    if (!pool || !out) return 0;
+
+    size_t n = 0;
+    size_t pos = atomic_load_explicit(&pool->dequeue_pos, memory_order_relaxed);
+    while (n < max) {
+        MempoolSlot* slot = &pool->slots[pos & pool->mask];
+        size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)(pos + 1);
+
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&pool->dequeue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                out[n++] = slot->entry;
+                // Free the slot for the producer one lap ahead
+                atomic_store_explicit(&slot->sequence, pos + pool->mask + 1, memory_order_release);
+                pos++;
+            }
+        } else if (diff < 0) {
+            break;  // not yet published: empty from here
+        } else {
+            pos = atomic_load_explicit(&pool->dequeue_pos, memory_order_relaxed);
+        }
+    }
+    return n;
+}
+
+// Approximate while producers or consumers are running
+size_t mempool_size(const Mempool* pool) {
+    if (!pool) return 0;
+
+    size_t tail = atomic_load_explicit(&pool->dequeue_pos, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&pool->enqueue_pos, memory_order_relaxed);
+    return head > tail ? head - tail : 0;
+}
+
+void mempool_free(Mempool* pool) {
+    if (!pool) return;
+
+    free(pool->slots);
+    free(pool);
+}
+
+// Heap order for fee assembly: higher fee first, then earlier arrival
+static int entry_before(const MempoolEntry* a, const MempoolEntry* b) {
+    if (a->fee != b->fee) return a->fee > b->fee;
+    return a->arrival < b->arrival;
+}
+
+static void sift_up(MempoolEntry* heap, size_t i) {
+    MempoolEntry entry = heap[i];
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!entry_before(&entry, &heap[parent])) break;
+        heap[i] = heap[parent];
+        i = parent;
+    }
+    heap[i] = entry;
+}
+
+static void sift_down(MempoolEntry* heap, size_t count, size_t i) {
+    MempoolEntry entry = heap[i];
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= count) break;
+        if (child + 1 < count && entry_before(&heap[child + 1], &heap[child])) child++;
+        if (!entry_before(&heap[child], &entry)) break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = entry;
+}
+
+BlockAssembler* block_assembler_create(Mempool* pool, const AssemblerOptions* options) {
+    if (!pool) return NULL;
+
+    BlockAssembler* assembler = (BlockAssembler*)malloc(sizeof(BlockAssembler));
+    if (!assembler) return NULL;
+
+    assembler->pool = pool;
+    assembler->options.order = options ? options->order : ASSEMBLE_BY_ARRIVAL;
+    assembler->options.block_capacity = options && options->block_capacity ? options->block_capacity
+                                                                           : DEFAULT_BLOCK_CAPACITY;
+    assembler->options.batch_size = options && options->batch_size ? options->batch_size : DEFAULT_BATCH_SIZE;
+    if (assembler->options.block_capacity > INT_MAX) assembler->options.block_capacity = INT_MAX;
+    if (assembler->options.batch_size > assembler->options.block_capacity)
+        assembler->options.batch_size = assembler->options.block_capacity;
+
+    // Arrival order only ever holds one batch; fee order keeps a window
+    // of several blocks to choose from
+    size_t capacity = assembler->options.batch_size;
+    if (assembler->options.order == ASSEMBLE_BY_FEE &&
+        capacity < assembler->options.block_capacity * FEE_WINDOW_BLOCKS)
+        capacity = assembler->options.block_capacity * FEE_WINDOW_BLOCKS;
+
+    assembler->pending = (MempoolEntry*)malloc(capacity * sizeof(MempoolEntry));
+    assembler->batch = (Transaction*)malloc(assembler->options.batch_size * sizeof(Transaction));
+    if (!assembler->pending || !assembler->batch) {
+        block_assembler_free(assembler);
+        return NULL;
+    }
+    assembler->pending_count = 0;
+    assembler->pending_capacity = capacity;
+    assembler->included = 0;
+    assembler->rejected = 0;
+    assembler->blocks = 0;
+    assembler->tip = NULL;
+    assembler->unsealed = 0;
+    return assembler;
+}
+
+// Entries still go through the ledger, so any that overspend are dropped.
+// The rest are only counted as included once their block is sealed.
+static void include_batch(BlockAssembler* assembler, Blockchain* chain, size_t count) {
+    int before = chain->latest->transaction_count;
+    submit_transactions(chain, assembler->batch, (int)count);
+    size_t added = (size_t)(chain->latest->transaction_count - before);
+    assembler->unsealed += added;
+    assembler->rejected += count - added;
+}
+
+// Tops the heap up from the pool, a batch at a time
+static void refill_pending(BlockAssembler* assembler) {
+    while (assembler->pending_count < assembler->pending_capacity) {
+        size_t room = assembler->pending_capacity - assembler->pending_count;
+        if (room > assembler->options.batch_size) room = assembler->options.batch_size;
+
+        size_t start = assembler->pending_count;
+        size_t n = mempool_drain(assembler->pool, assembler->pending + start, room);
+        for (size_t i = start; i < start + n; i++)
+            sift_up(assembler->pending, i);
+        assembler->pending_count += n;
+        if (n < room) break;
+    }
+}
+
+// Fills the chain's tip from the pool up to block_capacity transactions,
+// mines it once and seals it with add_block. Returns how many of the
+// assembler's transactions the sealed block holds; 0 if the pool had
+// nothing usable, or if the block could not be sealed. Transactions drained
+// by then stay on the tip, uncounted, and the next call seals them.
+size_t assemble_block(BlockAssembler* assembler, Blockchain* chain) {
+    if (!assembler || !chain || !chain->latest) return 0;
+
+    Block* tip = chain->latest;
+    // A tip left unsealed here that was sealed some other way still counts
+    if (assembler->tip != tip) {
+        assembler->included += assembler->unsealed;
+        assembler->tip = tip;
+        assembler->unsealed = 0;
+    }
+    size_t capacity = assembler->options.block_capacity;
+    size_t have = (size_t)tip->transaction_count;
+    if (have < capacity && !reserve_transactions(tip, (int)capacity)) return 0;
+
+    // Fee order tops up its window first so newer, richer entries compete
+    if (assembler->options.order == ASSEMBLE_BY_FEE) refill_pending(assembler);
+
+    for (;;) {
+        size_t want = (size_t)tip->transaction_count < capacity ? capacity - (size_t)tip->transaction_count : 0;
+        if (want > assembler->options.batch_size) want = assembler->options.batch_size;
+        if (want == 0) break;
+
+        size_t n = 0;
+        if (assembler->options.order == ASSEMBLE_BY_FEE) {
+            if (assembler->pending_count == 0) refill_pending(assembler);
+            for (; n < want && assembler->pending_count > 0; n++) {
+                assembler->batch[n] = assembler->pending[0].tx;
+                assembler->pending[0] = assembler->pending[--assembler->pending_count];
+                if (assembler->pending_count > 0) sift_down(assembler->pending, assembler->pending_count, 0);
+            }
+        } else {
+            n = mempool_drain(assembler->pool, assembler->pending, want);
+            for (size_t i = 0; i < n; i++)
+                assembler->batch[i] = assembler->pending[i].tx;
+        }
+
+        if (n == 0) break;
+        include_batch(assembler, chain, n);
+        if (n < want && assembler->options.order == ASSEMBLE_BY_ARRIVAL) break;
+    }
+
+    if (assembler->unsealed == 0) return 0;
+
+    // Batches fold the Merkle root once each; the header is hashed only here
+    if (!mine_tip(chain)) return 0;
+    add_block(chain);
+    if (chain->latest == tip) return 0;
+
+    size_t sealed = assembler->unsealed;
+    assembler->included += sealed;
+    assembler->tip = NULL;
+    assembler->unsealed = 0;
+    assembler->blocks++;
+    return sealed;
+}
+
+void block_assembler_free(BlockAssembler* assembler) {
+    if (!assembler) return;
+
+    free(assembler->pending);
+    free(assembler->batch);
+    free(assembler);
+}
@@ -0,0 +1,76 @@
+#ifndef MEMPOOL_H
+#define MEMPOOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include "blockchain.h"
+
+// Pending transactions waiting for a block. Any number of threads submit
+// into a bounded lock-free ring (Vyukov's MPMC queue: each slot carries a
+// sequence number, so producers and consumers claim slots with one CAS on
+// their own position and never take a lock). A block assembler drains it
+// in batches and fills the chain's tip. Names are interned before a slot
+// is claimed; only a name never seen before locks the accounts table.
+
+// A submitted transaction. The fee only orders the pool; it is not part
+// of the transaction that goes into the block, whose timestamp is set when
+// it is included.
+typedef struct {
+    Transaction tx;
+    double fee;
+    uint64_t arrival;  // position in the pool's submission order
+} MempoolEntry;
+
+typedef struct {
+    atomic_size_t sequence;
+    MempoolEntry entry;
+} MempoolSlot;
+
+typedef struct {
+    MempoolSlot* slots;
+    size_t mask;  // capacity - 1; capacity is a power of two
+    // Producers and consumers each get a cache line for their position
+    _Alignas(64) atomic_size_t enqueue_pos;
+    _Alignas(64) atomic_size_t dequeue_pos;
+} Mempool;
+
+typedef enum {
+    ASSEMBLE_BY_ARRIVAL,  // first submitted, first included
+    ASSEMBLE_BY_FEE       // highest fee first, ties by arrival
+} AssemblyOrder;
+
+typedef struct {
+    AssemblyOrder order;
+    size_t block_capacity;  // most transactions per block
+    size_t batch_size;      // entries drained from the pool at a time
+} AssemblerOptions;
+
+// Builds blocks from a mempool on one chain. Only the thread calling
+// assemble_block may touch the chain; producers only touch the pool.
+typedef struct {
+    Mempool* pool;
+    AssemblerOptions options;
+    MempoolEntry* pending;  // drained but not yet in a block; a max-heap by fee
+    size_t pending_count;
+    size_t pending_capacity;
+    Transaction* batch;     // next transactions for the tip, batch_size of them
+    uint64_t included;  // transactions placed in sealed blocks
+    uint64_t rejected;  // dropped because the ledger refused them
+    uint64_t blocks;
+    const Block* tip;   // the tip the assembler last added to
+    size_t unsealed;    // transactions it added there, counted once the tip is sealed
+} BlockAssembler;
+
+// Function declarations
+Mempool* mempool_create(size_t capacity);
+int mempool_submit(Mempool* pool, const char* sender, const char* receiver, double amount, double fee);
+size_t mempool_drain(Mempool* pool, MempoolEntry* out, size_t max);
+size_t mempool_size(const Mempool* pool);
+void mempool_free(Mempool* pool);
+
+BlockAssembler* block_assembler_create(Mempool* pool, const AssemblerOptions* options);
+size_t assemble_block(BlockAssembler* assembler, Blockchain* chain);
+void block_assembler_free(BlockAssembler* assembler);
+
+#endif // MEMPOOL_H
@@ -0,0 +1,268 @@
+#include "merkle.h"
+#include <stdlib.h>
+#include <string.h>
+
+void merkle_hash_leaf(const uint8_t* data, size_t len, uint8_t hash[]) {
+    const uint8_t prefix = MERKLE_LEAF_PREFIX;
+    SHA256_CTX ctx;
+
+    sha256_init(&ctx);
+    sha256_update(&ctx, &prefix, 1);
+    sha256_update(&ctx, data, len);
+    sha256_final(&ctx, hash);
+}
+
+void merkle_hash_node(const uint8_t left[], const uint8_t right[], uint8_t hash[]) {
+    uint8_t buf[1 + 2 * SHA256_DIGEST_SIZE];
+
+    buf[0] = MERKLE_NODE_PREFIX;
+    memcpy(buf + 1, left, SHA256_DIGEST_SIZE);
+    memcpy(buf + 1 + SHA256_DIGEST_SIZE, right, SHA256_DIGEST_SIZE);
+    sha256(buf, sizeof(buf), hash);
+}
+
+// Root of the empty tree: SHA-256 of the empty string
+static const uint8_t empty_root[SHA256_DIGEST_SIZE] = {
+    0xe3, 0xb0, 0xc4, 0x42, 0x98, 0xfc, 0x1c, 0x14, 0x9a, 0xfb, 0xf4, 0xc8, 0x99, 0x6f, 0xb9, 0x24,
+    0x27, 0xae, 0x41, 0xe4, 0x64, 0x9b, 0x93, 0x4c, 0xa4, 0x95, 0x99, 0x1b, 0x78, 0x52, 0xb8, 0x55
+};
+
+// Largest power of two strictly below size (size >= 2)
+static size_t split_point(size_t size) {
+    size_t k = 1;
+    while ((k << 1) < size) k <<= 1;
+    return k;
+}
+
+static int level_push(MerkleTree* tree, int k, const uint8_t node[]) {
+    if (k == tree->level_count) {
+        MerkleLevel* levels = (MerkleLevel*)realloc(tree->levels, (size_t)(k + 1) * sizeof(MerkleLevel));
+        if (!levels) return 0;
+        tree->levels = levels;
+        memset(&levels[k], 0, sizeof(MerkleLevel));
+        tree->level_count++;
+    }
+
+    MerkleLevel* level = &tree->levels[k];
+    if (level->count == level->capacity) {
+        size_t capacity = level->capacity ? level->capacity * 2 : 4;
+        uint8_t (*nodes)[SHA256_DIGEST_SIZE] = realloc(level->nodes, capacity * SHA256_DIGEST_SIZE);
+        if (!nodes) return 0;
+        level->nodes = nodes;
+        level->capacity = capacity;
+    }
+
+    memcpy(level->nodes[level->count++], node, SHA256_DIGEST_SIZE);
+    return 1;
+}
+
+// The root folds the peaks (the last node of every level with an odd
+// count) from the smallest subtree up
+static void update_root(MerkleTree* tree) {
+    int have_root = 0;
+
+    if (tree->leaf_count == 0) {
+        memcpy(tree->root, empty_root, SHA256_DIGEST_SIZE);
+        return;
+    }
+
+    for (int k = 0; k < tree->level_count; k++) {
+        const MerkleLevel* level = &tree->levels[k];
+        if (level->count % 2 == 0) continue;
+        if (have_root) {
+            merkle_hash_node(level->nodes[level->count - 1], tree->root, tree->root);
+        } else {
+            memcpy(tree->root, level->nodes[level->count - 1], SHA256_DIGEST_SIZE);
+            have_root = 1;
+        }
+    }
+}
+
+void merkle_init(MerkleTree* tree) {
+    tree->levels = NULL;
+    tree->level_count = 0;
+    tree->leaf_count = 0;
+    update_root(tree);
+}
+
+// Adds a leaf and every subtree it completes, leaving the root stale
+static int push_leaf(MerkleTree* tree, const uint8_t leaf_hash[]) {
+    uint8_t node[SHA256_DIGEST_SIZE];
+    if (!merkle_has_levels(tree)) return 0;
+    memcpy(node, leaf_hash, SHA256_DIGEST_SIZE);
+
+    // Every time a level gains a pair, their parent moves one level up
+    for (int k = 0; ; k++) {
+        if (!level_push(tree, k, node)) return 0;
+        const MerkleLevel* level = &tree->levels[k];
+        if (level->count % 2 != 0) break;
+        merkle_hash_node(level->nodes[level->count - 2], level->nodes[level->count - 1], node);
+    }
+
+    tree->leaf_count++;
+    return 1;
+}
+
+int merkle_append(MerkleTree* tree, const uint8_t leaf_hash[]) {
+    if (!tree || !leaf_hash) return 0;
+
+    if (!push_leaf(tree, leaf_hash)) return 0;
+    update_root(tree);
+    return 1;
+}
+
+// Appends count leaves but folds the root only once, saving the O(log n)
+// peak hashes each single append pays. On failure the leaves before the
+// one that failed stay in the tree and the root covers them.
+int merkle_append_many(MerkleTree* tree, const uint8_t (*leaf_hashes)[SHA256_DIGEST_SIZE], size_t count) {
+    if (!tree || (!leaf_hashes && count > 0)) return 0;
+
+    int ok = 1;
+    for (size_t i = 0; i < count && ok; i++)
+        ok = push_leaf(tree, leaf_hashes[i]);
+    update_root(tree);
+    return ok;
+}
+
+// Hash of the size leaves starting at start, as a subtree of the RFC 6962 shape
+static void subtree_hash(const MerkleTree* tree, size_t start, size_t size, uint8_t hash[]) {
+    if ((size & (size - 1)) == 0) {
+        int k = __builtin_ctzll(size);
+        memcpy(hash, tree->levels[k].nodes[start >> k], SHA256_DIGEST_SIZE);
+        return;
+    }
+
+    uint8_t left[SHA256_DIGEST_SIZE], right[SHA256_DIGEST_SIZE];
+    size_t split = split_point(size);
+    subtree_hash(tree, start, split, left);
+    subtree_hash(tree, start + split, size - split, right);
+    merkle_hash_node(left, right, hash);
+}
+
+int merkle_get_proof(const MerkleTree* tree, size_t leaf_index, MerkleProof* proof) {
+    if (!tree || !proof || leaf_index >= tree->leaf_count || !merkle_has_levels(tree)) return 0;
+
+    size_t start = 0, size = tree->leaf_count, m = leaf_index;
+    int depth = 0;
+
+    // Walk down from the root; siblings come out root first
+    while (size > 1) {
+        size_t split = split_point(size);
+        if (m < split) {
+            subtree_hash(tree, start + split, size - split, proof->path[depth++]);
+            size = split;
+        } else {
+            subtree_hash(tree, start, split, proof->path[depth++]);
+            start += split;
+            m -= split;
+            size -= split;
+        }
+    }
+
+    for (int i = 0; i < depth / 2; i++) {
+        uint8_t tmp[SHA256_DIGEST_SIZE];
+        memcpy(tmp, proof->path[i], SHA256_DIGEST_SIZE);
+        memcpy(proof->path[i], proof->path[depth - 1 - i], SHA256_DIGEST_SIZE);
+        memcpy(proof->path[depth - 1 - i], tmp, SHA256_DIGEST_SIZE);
+    }
+
+    proof->leaf_index = leaf_index;
+    proof->tree_size = tree->leaf_count;
+    proof->length = depth;
+    return 1;
+}
+
+// Audit path verification from RFC 9162, section 2.1.3.2
+int merkle_verify_proof(const uint8_t root[], const uint8_t leaf_hash[], const MerkleProof* proof) {
+    if (!root || !leaf_hash || !proof) return 0;
+    if (proof->leaf_index >= proof->tree_size || proof->length > MERKLE_MAX_DEPTH) return 0;
+
+    size_t fn = proof->leaf_index;
+    size_t sn = proof->tree_size - 1;
+    uint8_t r[SHA256_DIGEST_SIZE];
+    memcpy(r, leaf_hash, SHA256_DIGEST_SIZE);
+
+    for (int i = 0; i < proof->length; i++) {
+        if (sn == 0) return 0;
+        if ((fn & 1) || fn == sn) {
+            merkle_hash_node(proof->path[i], r, r);
+            while (!(fn & 1) && fn != 0) {
+                fn >>= 1;
+                sn >>= 1;
+            }
+        } else {
+            merkle_hash_node(r, proof->path[i], r);
+        }
+        fn >>= 1;
+        sn >>= 1;
+    }
+
+    return sn == 0 && memcmp(r, root, SHA256_DIGEST_SIZE) == 0;
+}
+
+// Frees the nodes of a tree that will not grow again, keeping its root
+// and leaf count; from then on it gives no proofs and takes no leaves
+void merkle_drop_levels(MerkleTree* tree) {
+    if (!tree) return;
+
+    for (int k = 0; k < tree->level_count; k++)
+        free(tree->levels[k].nodes);
+    free(tree->levels);
+    tree->levels = NULL;
+    tree->level_count = 0;
+}
+
+// Makes tree one that holds only a root, as merkle_drop_levels leaves it,
+// for blocks whose root is computed without building the tree
+void merkle_set_root(MerkleTree* tree, const uint8_t root[], size_t leaf_count) {
+    merkle_free(tree);
+    memcpy(tree->root, root, SHA256_DIGEST_SIZE);
+    tree->leaf_count = leaf_count;
+}
+
+int merkle_has_levels(const MerkleTree* tree) {
+    return tree && (tree->level_count > 0 || tree->leaf_count == 0);
+}
+
+void merkle_free(MerkleTree* tree) {
+    if (!tree) return;
+
+    merkle_drop_levels(tree);
+    merkle_init(tree);
+}
+
+void merkle_accumulator_init(MerkleAccumulator* acc) {
+    acc->leaf_count = 0;
+}
+
+void merkle_accumulator_append(MerkleAccumulator* acc, const uint8_t leaf_hash[]) {
+    uint8_t node[SHA256_DIGEST_SIZE];
+    int h = 0;
+
+    memcpy(node, leaf_hash, SHA256_DIGEST_SIZE);
+    while ((acc->leaf_count >> h) & 1) {
+        merkle_hash_node(acc->peaks[h], node, node);
+        h++;
+    }
+    memcpy(acc->peaks[h], node, SHA256_DIGEST_SIZE);
+    acc->leaf_count++;
+}
+
+void merkle_accumulator_root(const MerkleAccumulator* acc, uint8_t root[]) {
+    int have_root = 0;
+
+    if (acc->leaf_count == 0) {
+        memcpy(root, empty_root, SHA256_DIGEST_SIZE);
+        return;
+    }
+
+    for (int h = 0; h < MERKLE_MAX_DEPTH; h++) {
+        if (!((acc->leaf_count >> h) & 1)) continue;
+        if (have_root) {
+            merkle_hash_node(acc->peaks[h], root, root);
+        } else {
+            memcpy(root, acc->peaks[h], SHA256_DIGEST_SIZE);
+            have_root = 1;
+        }
+    }
+}
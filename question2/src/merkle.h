@@ -0,0 +1,64 @@
+#ifndef MERKLE_H
+#define MERKLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sha256.h"
+
+// Trees follow the RFC 6962 shape: a tree of n leaves splits at the largest
+// power of two below n, and leaves and interior nodes are hashed with
+// different prefixes so one can never be passed off as the other.
+#define MERKLE_LEAF_PREFIX 0x00
+#define MERKLE_NODE_PREFIX 0x01
+#define MERKLE_MAX_DEPTH 64
+
+// One level of the tree: the roots of every complete 2^k-leaf subtree
+typedef struct {
+    uint8_t (*nodes)[SHA256_DIGEST_SIZE];
+    size_t count;
+    size_t capacity;
+} MerkleLevel;
+
+// Append-only Merkle tree. Every complete subtree is kept, so an append
+// touches O(log n) nodes and any leaf's inclusion proof can be produced.
+// Once a tree stops growing its levels can be dropped, leaving the root.
+typedef struct {
+    MerkleLevel* levels;
+    int level_count;
+    size_t leaf_count;
+    uint8_t root[SHA256_DIGEST_SIZE];
+} MerkleTree;
+
+// Streaming root computation that keeps only the current peaks
+typedef struct {
+    uint8_t peaks[MERKLE_MAX_DEPTH][SHA256_DIGEST_SIZE];
+    uint64_t leaf_count;
+} MerkleAccumulator;
+
+// Audit path from a leaf up to the root, nearest sibling first
+typedef struct {
+    size_t leaf_index;
+    size_t tree_size;
+    int length;
+    uint8_t path[MERKLE_MAX_DEPTH][SHA256_DIGEST_SIZE];
+} MerkleProof;
+
+// Function declarations
+void merkle_hash_leaf(const uint8_t* data, size_t len, uint8_t hash[]);
+void merkle_hash_node(const uint8_t left[], const uint8_t right[], uint8_t hash[]);
+
+void merkle_init(MerkleTree* tree);
+int merkle_append(MerkleTree* tree, const uint8_t leaf_hash[]);
+int merkle_append_many(MerkleTree* tree, const uint8_t (*leaf_hashes)[SHA256_DIGEST_SIZE], size_t count);
+int merkle_get_proof(const MerkleTree* tree, size_t leaf_index, MerkleProof* proof);
+int merkle_verify_proof(const uint8_t root[], const uint8_t leaf_hash[], const MerkleProof* proof);
+void merkle_drop_levels(MerkleTree* tree);
+void merkle_set_root(MerkleTree* tree, const uint8_t root[], size_t leaf_count);
+int merkle_has_levels(const MerkleTree* tree);
+void merkle_free(MerkleTree* tree);
+
+void merkle_accumulator_init(MerkleAccumulator* acc);
+void merkle_accumulator_append(MerkleAccumulator* acc, const uint8_t leaf_hash[]);
+void merkle_accumulator_root(const MerkleAccumulator* acc, uint8_t root[]);
+
+#endif // MERKLE_H
@@ -0,0 +1,238 @@
+#include "metrics.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+static const char* counter_names[METRIC_COUNTER_COUNT] = {
+    "sha256_hashes", "sha256_bytes", "sha256_compressions", "block_hashes",
+    "nonces_tried", "blocks_validated", "save_bytes", "load_bytes"
+};
+
+static const char* counter_help[METRIC_COUNTER_COUNT] = {
+    "SHA-256 messages hashed",
+    "Bytes of SHA-256 input",
+    "SHA-256 compression function calls",
+    "Block header hashes computed",
+    "Nonces tried while mining",
+    "Blocks verified against their contents",
+    "Bytes written by save_blockchain",
+    "Bytes read by load_blockchain"
+};
+
+static const char* histogram_names[METRIC_HISTOGRAM_COUNT] = {
+    "validate_latency", "save_latency", "load_latency"
+};
+
+static const char* histogram_help[METRIC_HISTOGRAM_COUNT] = {
+    "Time spent validating a chain",
+    "Time spent in save_blockchain",
+    "Time spent in load_blockchain"
+};
+
+#ifdef BLOCKCHAIN_METRICS
+
+_Thread_local MetricsShard* metrics_thread_shard = NULL;
+
+// Shards of live threads. When a thread exits, its counts are added into
+// retired and its shard goes on the free list for the next new thread, so
+// memory and snapshot cost follow the threads alive at once, not every
+// thread that ever recorded anything.
+static MetricsShard* shards = NULL;
+static MetricsShard* free_shards = NULL;
+static MetricsSnapshot retired;
+static pthread_mutex_t shards_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t shard_key;
+static pthread_once_t shard_key_once = PTHREAD_ONCE_INIT;
+static int shard_key_ok = 0;
+
+// Adds a shard's counts into a snapshot; with clear set, zeroes them
+static void collect_shard(MetricsShard* shard, MetricsSnapshot* snapshot, int clear) {
+    for (int c = 0; c < METRIC_COUNTER_COUNT; c++) {
+        if (snapshot) snapshot->counters[c] += atomic_load_explicit(&shard->counters[c], memory_order_relaxed);
+        if (clear) atomic_store_explicit(&shard->counters[c], 0, memory_order_relaxed);
+    }
+    for (int h = 0; h < METRIC_HISTOGRAM_COUNT; h++) {
+        for (int b = 0; b < METRICS_BUCKETS; b++) {
+            if (snapshot) snapshot->buckets[h][b] += atomic_load_explicit(&shard->buckets[h][b], memory_order_relaxed);
+            if (clear) atomic_store_explicit(&shard->buckets[h][b], 0, memory_order_relaxed);
+        }
+        if (snapshot) {
+            snapshot->count[h] += atomic_load_explicit(&shard->count[h], memory_order_relaxed);
+            snapshot->sum_ns[h] += atomic_load_explicit(&shard->sum_ns[h], memory_order_relaxed);
+        }
+        if (clear) {
+            atomic_store_explicit(&shard->count[h], 0, memory_order_relaxed);
+            atomic_store_explicit(&shard->sum_ns[h], 0, memory_order_relaxed);
+        }
+    }
+}
+
+// Runs on the exiting thread, so nothing else writes the shard any more
+static void retire_shard(void* value) {
+    MetricsShard* shard = (MetricsShard*)value;
+
+    pthread_mutex_lock(&shards_lock);
+    MetricsShard** link = &shards;
+    while (*link && *link != shard) link = &(*link)->next;
+    if (*link) *link = shard->next;
+    collect_shard(shard, &retired, 1);
+    shard->next = free_shards;
+    free_shards = shard;
+    pthread_mutex_unlock(&shards_lock);
+
+    // Anything the thread records after this takes a fresh shard
+    metrics_thread_shard = NULL;
+}
+
+static void create_shard_key(void) {
+    shard_key_ok = pthread_key_create(&shard_key, retire_shard) == 0;
+}
+
+MetricsShard* metrics_register_thread(void) {
+    pthread_once(&shard_key_once, create_shard_key);
+
+    pthread_mutex_lock(&shards_lock);
+    MetricsShard* shard = free_shards;
+    if (shard) free_shards = shard->next;
+    else shard = (MetricsShard*)calloc(1, sizeof(MetricsShard));
+    if (shard) {
+        shard->next = shards;
+        shards = shard;
+    }
+    pthread_mutex_unlock(&shards_lock);
+    if (!shard) return NULL;
+
+    // Without the key the shard is never retired, as before
+    if (shard_key_ok) pthread_setspecific(shard_key, shard);
+    metrics_thread_shard = shard;
+    return shard;
+}
+
+uint64_t metrics_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void shard_add(atomic_uint_least64_t* slot, uint64_t n) {
+    atomic_store_explicit(slot, atomic_load_explicit(slot, memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+void metrics_observe(MetricHistogram histogram, uint64_t ns) {
+    MetricsShard* shard = metrics_thread_shard;
+    if (!shard && !(shard = metrics_register_thread())) return;
+
+    int bucket = ns < 2 ? 0 : 63 - __builtin_clzll(ns);
+    if (bucket >= METRICS_BUCKETS) bucket = METRICS_BUCKETS - 1;
+
+    shard_add(&shard->buckets[histogram][bucket], 1);
+    shard_add(&shard->count[histogram], 1);
+    shard_add(&shard->sum_ns[histogram], ns);
+}
+
+int metrics_enabled(void) {
+    return 1;
+}
+
+void metrics_snapshot(MetricsSnapshot* snapshot) {
+    pthread_mutex_lock(&shards_lock);
+    *snapshot = retired;
+    for (MetricsShard* shard = shards; shard; shard = shard->next)
+        collect_shard(shard, snapshot, 0);
+    pthread_mutex_unlock(&shards_lock);
+}
+
+// Owners keep writing while this runs, so a reset racing a busy thread may
+// lose that thread's in-flight increment; it is meant for quiet moments
+// such as between benchmark cases
+void metrics_reset(void) {
+    pthread_mutex_lock(&shards_lock);
+    memset(&retired, 0, sizeof(retired));
+    for (MetricsShard* shard = shards; shard; shard = shard->next)
+        collect_shard(shard, NULL, 1);
+    pthread_mutex_unlock(&shards_lock);
+}
+
+#else
+
+int metrics_enabled(void) {
+    return 0;
+}
+
+void metrics_snapshot(MetricsSnapshot* snapshot) {
+    memset(snapshot, 0, sizeof(MetricsSnapshot));
+}
+
+void metrics_reset(void) {
+}
+
+#endif // BLOCKCHAIN_METRICS
+
+// Upper bound of a bucket in nanoseconds; the last one is open-ended
+static uint64_t bucket_bound_ns(int bucket) {
+    return 2ull << bucket;
+}
+
+int metrics_write_json(FILE* out) {
+    MetricsSnapshot snapshot;
+    metrics_snapshot(&snapshot);
+
+    fprintf(out, "{\"enabled\":%s,\"counters\":{", metrics_enabled() ? "true" : "false");
+    for (int c = 0; c < METRIC_COUNTER_COUNT; c++)
+        fprintf(out, "%s\"%s\":%llu", c ? "," : "", counter_names[c],
+                (unsigned long long)snapshot.counters[c]);
+
+    fprintf(out, "},\"histograms\":{");
+    for (int h = 0; h < METRIC_HISTOGRAM_COUNT; h++) {
+        fprintf(out, "%s\"%s_ns\":{\"count\":%llu,\"sum\":%llu,\"buckets\":[", h ? "," : "",
+                histogram_names[h], (unsigned long long)snapshot.count[h],
+                (unsigned long long)snapshot.sum_ns[h]);
+
+        // Only non-empty buckets, each keyed by its upper bound
+        int first = 1;
+        for (int b = 0; b < METRICS_BUCKETS; b++) {
+            if (!snapshot.buckets[h][b]) continue;
+            if (b == METRICS_BUCKETS - 1)
+                fprintf(out, "%s{\"le\":null", first ? "" : ",");
+            else
+                fprintf(out, "%s{\"le\":%llu", first ? "" : ",", (unsigned long long)bucket_bound_ns(b));
+            fprintf(out, ",\"count\":%llu}", (unsigned long long)snapshot.buckets[h][b]);
+            first = 0;
+        }
+        fprintf(out, "]}");
+    }
+    fprintf(out, "}}\n");
+    return !ferror(out);
+}
+
+// Prometheus text exposition format: counters get a _total suffix and
+// histograms are cumulative, in seconds
+int metrics_write_prometheus(FILE* out) {
+    MetricsSnapshot snapshot;
+    metrics_snapshot(&snapshot);
+
+    for (int c = 0; c < METRIC_COUNTER_COUNT; c++) {
+        fprintf(out, "# HELP blockchain_%s_total %s\n", counter_names[c], counter_help[c]);
+        fprintf(out, "# TYPE blockchain_%s_total counter\n", counter_names[c]);
+        fprintf(out, "blockchain_%s_total %llu\n", counter_names[c], (unsigned long long)snapshot.counters[c]);
+    }
+
+    for (int h = 0; h < METRIC_HISTOGRAM_COUNT; h++) {
+        const char* name = histogram_names[h];
+        uint64_t cumulative = 0;
+
+        fprintf(out, "# HELP blockchain_%s_seconds %s\n", name, histogram_help[h]);
+        fprintf(out, "# TYPE blockchain_%s_seconds histogram\n", name);
+        for (int b = 0; b < METRICS_BUCKETS - 1; b++) {
+            cumulative += snapshot.buckets[h][b];
+            fprintf(out, "blockchain_%s_seconds_bucket{le=\"%.9g\"} %llu\n", name,
+                    bucket_bound_ns(b) * 1e-9, (unsigned long long)cumulative);
+        }
+        fprintf(out, "blockchain_%s_seconds_bucket{le=\"+Inf\"} %llu\n", name,
+                (unsigned long long)snapshot.count[h]);
+        fprintf(out, "blockchain_%s_seconds_sum %.9f\n", name, snapshot.sum_ns[h] * 1e-9);
+        fprintf(out, "blockchain_%s_seconds_count %llu\n", name, (unsigned long long)snapshot.count[h]);
+    }
+    return !ferror(out);
+}
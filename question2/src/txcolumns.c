@@ -0,0 +1,497 @@
+#include "txcolumns.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define MIN_CAPACITY 1024
+#define MIN_BLOCK_CAPACITY 64
+#define LANES 16  // partial sums per scan
+
+// One backend's scan loops. Each works on rows 0 to n - 1 of the columns
+// it is given; the public functions offset them to the caller's range.
+typedef struct {
+    double (*sum)(const double* amounts, size_t n);
+    double (*sum_between)(const double* amounts, const int64_t* timestamps, size_t n, int64_t from, int64_t to,
+                          size_t* matched);
+    double (*sum_matching)(const double* amounts, const AccountId* ids, size_t n, AccountId id, size_t* matched);
+    size_t (*select)(const AccountId* senders, const AccountId* receivers, size_t n, AccountId id,
+                     size_t first_row, size_t* rows, size_t max_rows);
+    void (*count_at_least)(const double* amounts, size_t n, const double* edges, int edge_count, uint64_t* counts);
+} ColumnKernels;
+
+// The partial sums in a fixed order, whichever backend filled them
+static double combine(const double partial[LANES]) {
+    double quarter[4];
+    for (int j = 0; j < 4; j++)
+        quarter[j] = (partial[j] + partial[j + 4]) + (partial[j + 8] + partial[j + 12]);
+    return (quarter[0] + quarter[1]) + (quarter[2] + quarter[3]);
+}
+
+static double sum_scalar(const double* amounts, size_t n) {
+    double partial[LANES] = { 0 };
+    size_t i = 0;
+
+    for (; i + LANES <= n; i += LANES)
+        for (int j = 0; j < LANES; j++) partial[j] += amounts[i + j];
+    for (; i < n; i++) partial[i % LANES] += amounts[i];
+    return combine(partial);
+}
+
+// Rows outside the window add 0, as the vector masks do
+static double sum_between_scalar(const double* amounts, const int64_t* timestamps, size_t n, int64_t from,
+                                 int64_t to, size_t* matched) {
+    double partial[LANES] = { 0 };
+    size_t count = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        int in = timestamps[i] >= from && timestamps[i] < to;
+        partial[i % LANES] += in ? amounts[i] : 0.0;
+        count += (size_t)in;
+    }
+    *matched = count;
+    return combine(partial);
+}
+
+static double sum_matching_scalar(const double* amounts, const AccountId* ids, size_t n, AccountId id,
+                                  size_t* matched) {
+    double partial[LANES] = { 0 };
+    size_t count = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        int in = ids[i] == id;
+        partial[i % LANES] += in ? amounts[i] : 0.0;
+        count += (size_t)in;
+    }
+    *matched = count;
+    return combine(partial);
+}
+
+static size_t select_scalar(const AccountId* senders, const AccountId* receivers, size_t n, AccountId id,
+                            size_t first_row, size_t* rows, size_t max_rows) {
+    size_t count = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        if (senders[i] != id && receivers[i] != id) continue;
+        if (count < max_rows) rows[count] = first_row + i;
+        count++;
+    }
+    return count;
+}
+
+// counts[k] += how many amounts are at least edges[k]; the edges ascend,
+// so each amount is placed with a binary search and the counts are
+// accumulated from the top
+static void count_at_least_scalar(const double* amounts, size_t n, const double* edges, int edge_count,
+                                  uint64_t* counts) {
+    uint64_t placed[TXCOLUMNS_MAX_BUCKETS + 2] = { 0 };
+
+    for (size_t i = 0; i < n; i++) {
+        // Edges up to lo are at most the amount; NaN is below every edge
+        int lo = 0, hi = edge_count;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (amounts[i] >= edges[mid]) lo = mid + 1;
+            else hi = mid;
+        }
+        placed[lo]++;
+    }
+
+    uint64_t above = 0;
+    for (int k = edge_count - 1; k >= 0; k--) {
+        above += placed[k + 1];
+        counts[k] += above;
+    }
+}
+
+static const ColumnKernels scalar_kernels = {
+    sum_scalar, sum_between_scalar, sum_matching_scalar, select_scalar, count_at_least_scalar
+};
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+#define TXCOLUMNS_HAVE_AVX2 1
+
+// Four vectors of four lanes hold partial sums 0 to 15
+__attribute__((target("avx2")))
+static void spill(__m256d acc0, __m256d acc1, __m256d acc2, __m256d acc3, double partial[LANES]) {
+    _mm256_storeu_pd(partial, acc0);
+    _mm256_storeu_pd(partial + 4, acc1);
+    _mm256_storeu_pd(partial + 8, acc2);
+    _mm256_storeu_pd(partial + 12, acc3);
+}
+
+__attribute__((target("avx2")))
+static uint64_t lane_total(__m256i v) {
+    uint64_t lanes[4];
+    _mm256_storeu_si256((__m256i*)lanes, v);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+__attribute__((target("avx2")))
+static double sum_avx2(const double* amounts, size_t n) {
+    __m256d acc0 = _mm256_setzero_pd(), acc1 = acc0, acc2 = acc0, acc3 = acc0;
+    double partial[LANES];
+    size_t i = 0;
+
+    for (; i + LANES <= n; i += LANES) {
+        acc0 = _mm256_add_pd(acc0, _mm256_loadu_pd(amounts + i));
+        acc1 = _mm256_add_pd(acc1, _mm256_loadu_pd(amounts + i + 4));
+        acc2 = _mm256_add_pd(acc2, _mm256_loadu_pd(amounts + i + 8));
+        acc3 = _mm256_add_pd(acc3, _mm256_loadu_pd(amounts + i + 12));
+    }
+    spill(acc0, acc1, acc2, acc3, partial);
+    for (; i < n; i++) partial[i % LANES] += amounts[i];
+    return combine(partial);
+}
+
+// Lanes with from <= timestamp < to, as all ones
+#define WINDOW_MASK(p) \
+    _mm256_andnot_si256(_mm256_cmpgt_epi64(lo, _mm256_loadu_si256((const __m256i*)(p))), \
+                        _mm256_cmpgt_epi64(hi, _mm256_loadu_si256((const __m256i*)(p))))
+
+__attribute__((target("avx2")))
+static double sum_between_avx2(const double* amounts, const int64_t* timestamps, size_t n, int64_t from,
+                               int64_t to, size_t* matched) {
+    const __m256i lo = _mm256_set1_epi64x(from), hi = _mm256_set1_epi64x(to);
+    __m256d acc0 = _mm256_setzero_pd(), acc1 = acc0, acc2 = acc0, acc3 = acc0;
+    __m256i count = _mm256_setzero_si256();
+    double partial[LANES];
+    size_t i = 0;
+
+    for (; i + LANES <= n; i += LANES) {
+        __m256i m0 = WINDOW_MASK(timestamps + i), m1 = WINDOW_MASK(timestamps + i + 4);
+        __m256i m2 = WINDOW_MASK(timestamps + i + 8), m3 = WINDOW_MASK(timestamps + i + 12);
+        acc0 = _mm256_add_pd(acc0, _mm256_and_pd(_mm256_castsi256_pd(m0), _mm256_loadu_pd(amounts + i)));
+        acc1 = _mm256_add_pd(acc1, _mm256_and_pd(_mm256_castsi256_pd(m1), _mm256_loadu_pd(amounts + i + 4)));
+        acc2 = _mm256_add_pd(acc2, _mm256_and_pd(_mm256_castsi256_pd(m2), _mm256_loadu_pd(amounts + i + 8)));
+        acc3 = _mm256_add_pd(acc3, _mm256_and_pd(_mm256_castsi256_pd(m3), _mm256_loadu_pd(amounts + i + 12)));
+        // Each matching lane is -1
+        count = _mm256_sub_epi64(count, _mm256_add_epi64(_mm256_add_epi64(m0, m1), _mm256_add_epi64(m2, m3)));
+    }
+    spill(acc0, acc1, acc2, acc3, partial);
+
+    size_t total = (size_t)lane_total(count);
+    for (; i < n; i++) {
+        int in = timestamps[i] >= from && timestamps[i] < to;
+        partial[i % LANES] += in ? amounts[i] : 0.0;
+        total += (size_t)in;
+    }
+    *matched = total;
+    return combine(partial);
+}
+
+// Four 32-bit IDs compared and widened to 64-bit lane masks
+#define ID_MASK(p) \
+    _mm256_cvtepi32_epi64(_mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(p)), key))
+
+__attribute__((target("avx2")))
+static double sum_matching_avx2(const double* amounts, const AccountId* ids, size_t n, AccountId id,
+                                size_t* matched) {
+    const __m128i key = _mm_set1_epi32((int)id);
+    __m256d acc0 = _mm256_setzero_pd(), acc1 = acc0, acc2 = acc0, acc3 = acc0;
+    __m256i count = _mm256_setzero_si256();
+    double partial[LANES];
+    size_t i = 0;
+
+    for (; i + LANES <= n; i += LANES) {
+        __m256i m0 = ID_MASK(ids + i), m1 = ID_MASK(ids + i + 4);
+        __m256i m2 = ID_MASK(ids + i + 8), m3 = ID_MASK(ids + i + 12);
+        acc0 = _mm256_add_pd(acc0, _mm256_and_pd(_mm256_castsi256_pd(m0), _mm256_loadu_pd(amounts + i)));
+        acc1 = _mm256_add_pd(acc1, _mm256_and_pd(_mm256_castsi256_pd(m1), _mm256_loadu_pd(amounts + i + 4)));
+        acc2 = _mm256_add_pd(acc2, _mm256_and_pd(_mm256_castsi256_pd(m2), _mm256_loadu_pd(amounts + i + 8)));
+        acc3 = _mm256_add_pd(acc3, _mm256_and_pd(_mm256_castsi256_pd(m3), _mm256_loadu_pd(amounts + i + 12)));
+        count = _mm256_sub_epi64(count, _mm256_add_epi64(_mm256_add_epi64(m0, m1), _mm256_add_epi64(m2, m3)));
+    }
+    spill(acc0, acc1, acc2, acc3, partial);
+
+    size_t total = (size_t)lane_total(count);
+    for (; i < n; i++) {
+        int in = ids[i] == id;
+        partial[i % LANES] += in ? amounts[i] : 0.0;
+        total += (size_t)in;
+    }
+    *matched = total;
+    return combine(partial);
+}
+
+// Eight rows per compare; matches are rare, so the mask is usually 0
+__attribute__((target("avx2")))
+static size_t select_avx2(const AccountId* senders, const AccountId* receivers, size_t n, AccountId id,
+                          size_t first_row, size_t* rows, size_t max_rows) {
+    const __m256i key = _mm256_set1_epi32((int)id);
+    size_t count = 0;
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m256i s = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(senders + i)), key);
+        __m256i r = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(receivers + i)), key);
+        unsigned mask = (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_or_si256(s, r)));
+        while (mask) {
+            if (count < max_rows) rows[count] = first_row + i + (size_t)__builtin_ctz(mask);
+            count++;
+            mask &= mask - 1;
+        }
+    }
+    return count + select_scalar(senders + i, receivers + i, n - i, id, first_row + i,
+                                 count < max_rows ? rows + count : NULL, count < max_rows ? max_rows - count : 0);
+}
+
+// Every amount is compared with every edge; the all-ones lanes of a
+// compare subtract -1 from that edge's counters
+__attribute__((target("avx2")))
+static void count_at_least_avx2(const double* amounts, size_t n, const double* edges, int edge_count,
+                                uint64_t* counts) {
+    __m256d edge[TXCOLUMNS_MAX_BUCKETS + 1];
+    __m256i at_least[TXCOLUMNS_MAX_BUCKETS + 1];
+    size_t i = 0;
+
+    for (int k = 0; k < edge_count; k++) {
+        edge[k] = _mm256_set1_pd(edges[k]);
+        at_least[k] = _mm256_setzero_si256();
+    }
+    for (; i + 8 <= n; i += 8) {
+        __m256d a0 = _mm256_loadu_pd(amounts + i), a1 = _mm256_loadu_pd(amounts + i + 4);
+        for (int k = 0; k < edge_count; k++) {
+            __m256i m0 = _mm256_castpd_si256(_mm256_cmp_pd(a0, edge[k], _CMP_GE_OQ));
+            __m256i m1 = _mm256_castpd_si256(_mm256_cmp_pd(a1, edge[k], _CMP_GE_OQ));
+            at_least[k] = _mm256_sub_epi64(at_least[k], _mm256_add_epi64(m0, m1));
+        }
+    }
+    for (int k = 0; k < edge_count; k++) counts[k] += lane_total(at_least[k]);
+    count_at_least_scalar(amounts + i, n - i, edges, edge_count, counts);
+}
+
+static const ColumnKernels avx2_kernels = {
+    sum_avx2, sum_between_avx2, sum_matching_avx2, select_avx2, count_at_least_avx2
+};
+#endif
+
+static const ColumnKernels* kernels = &scalar_kernels;
+static TXCOLUMNS_BACKEND columns_backend = TXCOLUMNS_BACKEND_SCALAR;
+
+int txcolumns_backend_supported(TXCOLUMNS_BACKEND backend) {
+    switch (backend) {
+    case TXCOLUMNS_BACKEND_SCALAR:
+        return 1;
+    case TXCOLUMNS_BACKEND_AVX2:
+#ifdef TXCOLUMNS_HAVE_AVX2
+        return __builtin_cpu_supports("avx2");
+#else
+        return 0;
+#endif
+    }
+    return 0;
+}
+
+int txcolumns_set_backend(TXCOLUMNS_BACKEND backend) {
+    if (!txcolumns_backend_supported(backend)) return 0;
+
+    switch (backend) {
+    case TXCOLUMNS_BACKEND_SCALAR:
+        kernels = &scalar_kernels;
+        break;
+    case TXCOLUMNS_BACKEND_AVX2:
+#ifdef TXCOLUMNS_HAVE_AVX2
+        kernels = &avx2_kernels;
+#endif
+        break;
+    }
+    columns_backend = backend;
+    return 1;
+}
+
+TXCOLUMNS_BACKEND txcolumns_get_backend(void) {
+    return columns_backend;
+}
+
+const char* txcolumns_backend_name(TXCOLUMNS_BACKEND backend) {
+    switch (backend) {
+    case TXCOLUMNS_BACKEND_SCALAR:
+        return "scalar";
+    case TXCOLUMNS_BACKEND_AVX2:
+        return "avx2";
+    }
+    return "unknown";
+}
+
+// Pick the widest supported kernels before main() runs
+__attribute__((constructor))
+static void txcolumns_select_backend(void) {
+    if (!txcolumns_set_backend(TXCOLUMNS_BACKEND_AVX2))
+        txcolumns_set_backend(TXCOLUMNS_BACKEND_SCALAR);
+}
+
+void txcolumns_init(TxColumns* columns) {
+    memset(columns, 0, sizeof(TxColumns));
+}
+
+// Grows every column to hold count rows. A column that grew before
+// another failed to is kept; capacity only counts what all of them hold.
+int txcolumns_reserve(TxColumns* columns, size_t count) {
+    if (!columns) return 0;
+    if (count <= columns->capacity) return 1;
+
+    size_t capacity = columns->capacity ? columns->capacity : MIN_CAPACITY;
+    while (capacity < count) {
+        if (capacity > SIZE_MAX / 2 / sizeof(double)) return 0;
+        capacity *= 2;
+    }
+
+    double* amounts = (double*)realloc(columns->amounts, capacity * sizeof(double));
+    if (!amounts) return 0;
+    columns->amounts = amounts;
+    int64_t* timestamps = (int64_t*)realloc(columns->timestamps, capacity * sizeof(int64_t));
+    if (!timestamps) return 0;
+    columns->timestamps = timestamps;
+    AccountId* senders = (AccountId*)realloc(columns->senders, capacity * sizeof(AccountId));
+    if (!senders) return 0;
+    columns->senders = senders;
+    AccountId* receivers = (AccountId*)realloc(columns->receivers, capacity * sizeof(AccountId));
+    if (!receivers) return 0;
+    columns->receivers = receivers;
+
+    columns->capacity = capacity;
+    return 1;
+}
+
+// Splits count transactions across the columns as new rows
+int txcolumns_append(TxColumns* columns, const Transaction* txs, size_t count) {
+    if (!columns || (!txs && count > 0)) return 0;
+    if (count > SIZE_MAX - columns->count || !txcolumns_reserve(columns, columns->count + count)) return 0;
+
+    size_t row = columns->count;
+    for (size_t i = 0; i < count; i++) {
+        columns->amounts[row + i] = txs[i].amount;
+        columns->timestamps[row + i] = (int64_t)txs[i].timestamp;
+        columns->senders[row + i] = txs[i].sender;
+        columns->receivers[row + i] = txs[i].receiver;
+    }
+    columns->count += count;
+    return 1;
+}
+
+static int start_block(TxColumns* columns) {
+    if (columns->block_count == columns->block_capacity) {
+        size_t capacity = columns->block_capacity ? columns->block_capacity * 2 : MIN_BLOCK_CAPACITY;
+        size_t* starts = (size_t*)realloc(columns->block_starts, capacity * sizeof(size_t));
+        if (!starts) return 0;
+        columns->block_starts = starts;
+        columns->block_capacity = capacity;
+    }
+    columns->block_starts[columns->block_count++] = columns->count;
+    return 1;
+}
+
+// Appends whatever blocks[0] to blocks[block_count - 1] hold that the
+// columns do not: rows the last mirrored block gained since, then every
+// later block. Blocks already mirrored must not have changed.
+int txcolumns_sync(TxColumns* columns, Block* const* blocks, size_t block_count) {
+    if (!columns || (!blocks && block_count > 0)) return 0;
+
+    for (size_t h = columns->block_count ? columns->block_count - 1 : 0; h < block_count; h++) {
+        const Block* block = blocks[h];
+        if (h == columns->block_count && !start_block(columns)) return 0;
+
+        size_t mirrored = columns->count - columns->block_starts[h];
+        size_t total = block->transaction_count > 0 ? (size_t)block->transaction_count : 0;
+        if (total > mirrored && !txcolumns_append(columns, block->transactions + mirrored, total - mirrored))
+            return 0;
+    }
+    return 1;
+}
+
+// The rows of the blocks at heights first_height to end_height - 1
+int txcolumns_block_rows(const TxColumns* columns, size_t first_height, size_t end_height, size_t* begin,
+                         size_t* end) {
+    if (!columns || first_height > end_height || end_height > columns->block_count) return 0;
+
+    *begin = first_height < columns->block_count ? columns->block_starts[first_height] : columns->count;
+    *end = end_height < columns->block_count ? columns->block_starts[end_height] : columns->count;
+    return 1;
+}
+
+void txcolumns_free(TxColumns* columns) {
+    if (!columns) return;
+
+    free(columns->amounts);
+    free(columns->timestamps);
+    free(columns->senders);
+    free(columns->receivers);
+    free(columns->block_starts);
+    txcolumns_init(columns);
+}
+
+static int valid_range(const TxColumns* columns, size_t begin, size_t end) {
+    return columns && begin <= end && end <= columns->count;
+}
+
+// Total of every amount in the range
+double txcolumns_sum(const TxColumns* columns, size_t begin, size_t end) {
+    if (!valid_range(columns, begin, end)) return 0;
+    return kernels->sum(columns->amounts + begin, end - begin);
+}
+
+// Total of the amounts with from <= timestamp < to, and how many there are
+double txcolumns_sum_between(const TxColumns* columns, size_t begin, size_t end, int64_t from, int64_t to,
+                             size_t* matched) {
+    size_t count = 0;
+    double total = 0;
+
+    if (valid_range(columns, begin, end))
+        total = kernels->sum_between(columns->amounts + begin, columns->timestamps + begin, end - begin, from, to,
+                                     &count);
+    if (matched) *matched = count;
+    return total;
+}
+
+void txcolumns_account_flow(const TxColumns* columns, size_t begin, size_t end, AccountId id, AccountFlow* flow) {
+    if (!flow) return;
+    memset(flow, 0, sizeof(AccountFlow));
+    if (!valid_range(columns, begin, end)) return;
+
+    size_t n = end - begin;
+    flow->received = kernels->sum_matching(columns->amounts + begin, columns->receivers + begin, n, id,
+                                           &flow->receipts);
+    flow->sent = kernels->sum_matching(columns->amounts + begin, columns->senders + begin, n, id, &flow->payments);
+}
+
+// Rows where id sends or receives, in order. Writes at most max_rows of
+// them and returns how many there are in all.
+size_t txcolumns_select_account(const TxColumns* columns, size_t begin, size_t end, AccountId id, size_t* rows,
+                                size_t max_rows) {
+    if (!valid_range(columns, begin, end) || (!rows && max_rows > 0)) return 0;
+    return kernels->select(columns->senders + begin, columns->receivers + begin, end - begin, id, begin, rows,
+                           max_rows);
+}
+
+// counts[i] is how many amounts fall in [edges[i], edges[i + 1]); edges
+// holds bucket_count + 1 strictly ascending values. Amounts outside
+// every bucket are not counted. Returns 0 if the edges are unusable.
+int txcolumns_histogram(const TxColumns* columns, size_t begin, size_t end, const double* edges, int bucket_count,
+                        uint64_t* counts) {
+    if (!valid_range(columns, begin, end) || !edges || !counts || bucket_count < 1 ||
+        bucket_count > TXCOLUMNS_MAX_BUCKETS)
+        return 0;
+    for (int k = 0; k < bucket_count; k++)
+        if (!(edges[k] < edges[k + 1])) return 0;
+
+    uint64_t at_least[TXCOLUMNS_MAX_BUCKETS + 1] = { 0 };
+    kernels->count_at_least(columns->amounts + begin, end - begin, edges, bucket_count + 1, at_least);
+    for (int k = 0; k < bucket_count; k++) counts[k] = at_least[k] - at_least[k + 1];
+    return 1;
+}
+
+// Adds each row's amount to sent[sender] and received[receiver], for IDs
+// below account_capacity (account_count() covers every ID). Either array
+// may be NULL. Scattered adds have no AVX2 form, so this loop is scalar;
+// it reads each column once, in order.
+void txcolumns_group_by_account(const TxColumns* columns, size_t begin, size_t end, double* sent, double* received,
+                                size_t account_capacity) {
+    if (!valid_range(columns, begin, end)) return;
+
+    for (size_t i = begin; i < end; i++) {
+        double amount = columns->amounts[i];
+        if (sent && columns->senders[i] < account_capacity) sent[columns->senders[i]] += amount;
+        if (received && columns->receivers[i] < account_capacity) received[columns->receivers[i]] += amount;
+    }
+}
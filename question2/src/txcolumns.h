@@ -0,0 +1,70 @@
+#ifndef TXCOLUMNS_H
+#define TXCOLUMNS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "blockchain.h"
+
+// Column-oriented copy of a chain's transactions for analytics: amounts,
+// timestamps, senders and receivers each in their own contiguous array,
+// so a scan reads only the columns it needs. Rows are in chain order and
+// block_starts gives the first row of every block. The mirror only ever
+// appends; txcolumns_sync catches it up with blocks added since.
+//
+// Scans take a row range [begin, end). Sums add row i into partial sum
+// (i - begin) % 16 and combine the partials in a fixed order, so every
+// backend returns the same bits for the same rows.
+#define TXCOLUMNS_MAX_BUCKETS 64
+
+// Scan backends, selected once at startup via CPUID
+typedef enum {
+    TXCOLUMNS_BACKEND_SCALAR = 0,
+    TXCOLUMNS_BACKEND_AVX2
+} TXCOLUMNS_BACKEND;
+
+typedef struct TxColumns {
+    double* amounts;
+    int64_t* timestamps;
+    AccountId* senders;
+    AccountId* receivers;
+    size_t count;
+    size_t capacity;
+    size_t* block_starts;  // first row of the block at each height
+    size_t block_count;    // blocks mirrored; the last may still gain rows
+    size_t block_capacity;
+} TxColumns;
+
+// What one account sent and received over a range of rows
+typedef struct {
+    double received;
+    double sent;
+    size_t receipts;
+    size_t payments;
+} AccountFlow;
+
+// Function declarations
+void txcolumns_init(TxColumns* columns);
+int txcolumns_reserve(TxColumns* columns, size_t count);
+int txcolumns_append(TxColumns* columns, const Transaction* txs, size_t count);
+int txcolumns_sync(TxColumns* columns, Block* const* blocks, size_t block_count);
+int txcolumns_block_rows(const TxColumns* columns, size_t first_height, size_t end_height, size_t* begin,
+                         size_t* end);
+void txcolumns_free(TxColumns* columns);
+
+double txcolumns_sum(const TxColumns* columns, size_t begin, size_t end);
+double txcolumns_sum_between(const TxColumns* columns, size_t begin, size_t end, int64_t from, int64_t to,
+                             size_t* matched);
+void txcolumns_account_flow(const TxColumns* columns, size_t begin, size_t end, AccountId id, AccountFlow* flow);
+size_t txcolumns_select_account(const TxColumns* columns, size_t begin, size_t end, AccountId id, size_t* rows,
+                                size_t max_rows);
+int txcolumns_histogram(const TxColumns* columns, size_t begin, size_t end, const double* edges, int bucket_count,
+                        uint64_t* counts);
+void txcolumns_group_by_account(const TxColumns* columns, size_t begin, size_t end, double* sent, double* received,
+                                size_t account_capacity);
+
+int txcolumns_backend_supported(TXCOLUMNS_BACKEND backend);
+int txcolumns_set_backend(TXCOLUMNS_BACKEND backend);
+TXCOLUMNS_BACKEND txcolumns_get_backend(void);
+const char* txcolumns_backend_name(TXCOLUMNS_BACKEND backend);
+
+#endif // TXCOLUMNS_H